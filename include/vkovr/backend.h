@@ -0,0 +1,103 @@
+#ifndef VKOVR_BACKEND_H_
+#define VKOVR_BACKEND_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include <vulkan/vulkan.hpp>
+
+#include <OVR_CAPI_Vk.h>
+
+namespace vkovr
+{
+// Every runtime call made by Session and Swapchain goes through a backend, so that the VR frame path can run
+// against LibOVR or against a software implementation without a headset.
+class Backend
+{
+public:
+  Backend() = default;
+  virtual ~Backend() = default;
+
+  // True if a headset is available to create a session with, waiting up to the timeout. Cheaper than a failing create()
+  virtual bool detect(int timeoutMilliseconds) = 0;
+
+  // Session lifetime. A backend may be created again after destroy(), e.g. on session reconnect
+  virtual void create() = 0;
+  virtual void destroy() = 0;
+
+  virtual ovrSession getSession() const = 0;
+  virtual ovrHmdDesc getHmdDesc() = 0;
+
+  // Vulkan interop
+  virtual std::vector<std::string> getInstanceExtensions() = 0;
+  virtual std::vector<std::string> getDeviceExtensions() = 0;
+  virtual vk::PhysicalDevice getPhysicalDevice(vk::Instance instance) = 0;
+  virtual void setSynchronizationQueue(vk::Queue queue) = 0;
+
+  // Status and tracking. Tracking and input may be queried from any thread
+  virtual double getTimeInSeconds() = 0;
+  virtual ovrSessionStatus getStatus() = 0;
+  virtual ovrInputState getInputState() = 0;
+  virtual ovrTrackingState getTrackingState(double absTime) = 0;
+  virtual ovrPerfStats getPerfStats() = 0;
+  virtual void recenter() = 0;
+
+  // Eye description
+  virtual ovrSizei getFovTextureSize(ovrEyeType eye, const ovrFovPort& fov, float pixelsPerDisplayPixel) = 0;
+  virtual ovrEyeRenderDesc getRenderDesc(ovrEyeType eye, const ovrFovPort& fov) = 0;
+  virtual ovrMatrix4f getProjection(const ovrFovPort& fov, float near, float far) = 0;
+  virtual ovrTimewarpProjectionDesc getTimewarpProjectionDesc(const ovrMatrix4f& projection) = 0;
+
+  // Frame
+  virtual void waitToBeginFrame(int64_t frameIndex) = 0;
+  virtual void beginFrame(int64_t frameIndex) = 0;
+  virtual double getPredictedDisplayTime(int64_t frameIndex) = 0;
+  virtual void getEyePoses(int64_t frameIndex, const ovrPosef hmdToEyePoses[ovrEye_Count], ovrPosef eyePoses[ovrEye_Count], double* sensorSampleTime) = 0;
+  virtual void endFrame(int64_t frameIndex, ovrLayerHeader const* const* layers, unsigned int layerCount) = 0;
+
+  // Texture swapchains
+  virtual ovrTextureSwapChain createTextureSwapChain(vk::Device device, const ovrTextureSwapChainDesc& desc) = 0;
+  virtual int getTextureSwapChainLength(ovrTextureSwapChain swapchain) = 0;
+  virtual vk::Image getTextureSwapChainImage(ovrTextureSwapChain swapchain, int index) = 0;
+  virtual int getTextureSwapChainCurrentIndex(ovrTextureSwapChain swapchain) = 0;
+  virtual void commitTextureSwapChain(ovrTextureSwapChain swapchain) = 0;
+  virtual void destroyTextureSwapChain(ovrTextureSwapChain swapchain) = 0;
+
+  // Compositor output for a desktop window. Null if the runtime has none
+  virtual ovrMirrorTexture createMirrorTexture(vk::Device device, const ovrMirrorTextureDesc& desc) = 0;
+  virtual vk::Image getMirrorTextureImage(ovrMirrorTexture mirrorTexture) = 0;
+  virtual void destroyMirrorTexture(ovrMirrorTexture mirrorTexture) = 0;
+};
+
+// Backend forwarding to the LibOVR runtime. Throws when built with VKOVR_NO_RUNTIME, which links without LibOVR
+// and needs only its headers, e.g. for mock backend runs on platforms without the runtime
+std::shared_ptr<Backend> createOvrBackend();
+
+class MockBackendCreateInfo
+{
+public:
+  MockBackendCreateInfo() = default;
+
+public:
+  // Display refresh rate, used for frame pacing and predicted display times
+  double refreshRate = 90.;
+
+  // Per-eye render target size at pixel density 1
+  uint32_t eyeWidth = 1344;
+  uint32_t eyeHeight = 1600;
+
+  float ipd = 0.064f;
+  float headHeight = 1.6f;
+
+  // Amplitude in radians of the synthesized head yaw motion. Zero keeps the head still
+  float headYawAmplitude = 0.3f;
+
+  int swapchainLength = 3;
+};
+
+// Software backend handing out real Vulkan images, synthesized poses and compositor timing
+std::shared_ptr<Backend> createMockBackend(const MockBackendCreateInfo& createInfo);
+}
+
+#endif // VKOVR_BACKEND_H_
@@ -0,0 +1,45 @@
+#ifndef VKOVR_LAYER_H_
+#define VKOVR_LAYER_H_
+
+#include <OVR_CAPI.h>
+
+namespace vkovr
+{
+class Swapchain;
+
+enum class LayerType
+{
+  Quad,
+  Cylinder,
+};
+
+// Compositor layer over the eye layer, e.g. a HUD or a UI panel.
+// The compositor samples the swapchain image last committed, so static content costs nothing per frame
+class Layer
+{
+public:
+  Layer() = default;
+
+public:
+  LayerType type = LayerType::Quad;
+
+  // Color swapchain created with a layer extent and without depth. Must stay valid while the layer is set
+  const Swapchain* pSwapchain = nullptr;
+
+  // Pose relative to the head instead of the tracking origin
+  bool headLocked = false;
+
+  // Center of the quad facing +Z, or of the cylinder around its Y axis
+  ovrPosef pose{ { 0.f, 0.f, 0.f, 1.f }, { 0.f, 0.f, 0.f } };
+
+  // Quad, in meters
+  ovrVector2f quadSize{ 1.f, 1.f };
+
+  // Cylinder, the image covers an arc of the angle in radians, and the arc length divided by the aspect ratio in height
+  float cylinderRadius = 1.f;
+  float cylinderAngle = 1.f;
+  float cylinderAspectRatio = 2.f;
+};
+}
+
+#endif // VKOVR_LAYER_H_
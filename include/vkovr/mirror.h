@@ -0,0 +1,54 @@
+#ifndef VKOVR_MIRROR_H_
+#define VKOVR_MIRROR_H_
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <OVR_CAPI.h>
+
+#include <vkovr/session.h>
+
+namespace vkovr
+{
+class Session;
+class Swapchain;
+
+// Headset view for a desktop window, so that the desktop needs no scene render of its own
+class Mirror
+{
+  friend class Session;
+
+public:
+  Mirror();
+  ~Mirror();
+
+  // False if the runtime has no mirror texture, e.g. the mock backend. Eye images are blitted instead
+  auto hasMirrorTexture() const { return mirrorTexture_ != nullptr; }
+
+  // Records a blit of the headset view over the extent of an image in transfer dst or general layout.
+  // From the compositor's mirror texture, or side by side from the eye images rendered this frame at the viewport scale
+  void blit(vk::CommandBuffer commandBuffer, const std::vector<Swapchain>& swapchains, float viewportScale,
+    vk::Image dstImage, vk::ImageLayout dstLayout, const vk::Extent2D& dstExtent) const;
+
+  void destroy();
+
+private:
+  Session session_;
+  vk::Extent2D extent_;
+  ovrMirrorTexture mirrorTexture_ = nullptr;
+  vk::Image image_;
+};
+
+class MirrorCreateInfo
+{
+public:
+  vk::Device device;
+
+  // Extent of the compositor's mirror texture, e.g. of the desktop window
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+}
+
+#endif // VKOVR_MIRROR_H_
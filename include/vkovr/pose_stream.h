@@ -0,0 +1,74 @@
+#ifndef VKOVR_POSE_STREAM_H_
+#define VKOVR_POSE_STREAM_H_
+
+#include <memory>
+
+#include <OVR_CAPI.h>
+
+namespace vkovr
+{
+class Session;
+class Backend;
+class PoseStreamCreateInfo;
+
+// Tracked devices and input at a time, in tracking origin space
+class PoseSample
+{
+public:
+  PoseSample() = default;
+
+public:
+  // Seconds, in the runtime's clock of predicted display times
+  double time = 0.;
+
+  ovrPoseStatef headPose{};
+  ovrPoseStatef handPoses[ovrHand_Count]{};
+  unsigned int statusFlags = 0;
+  unsigned int handStatusFlags[ovrHand_Count]{};
+  ovrInputState inputState{};
+};
+
+// Samples tracking and input on a thread of its own at sensor rate into a ring buffer.
+// Any thread may query the stream without locks and without calls into the runtime
+class PoseStream
+{
+  friend class Session;
+
+public:
+  PoseStream();
+  ~PoseStream();
+
+  // False before the first sample
+  bool getLatestSample(PoseSample& sample) const;
+
+  // Poses interpolated between the samples around the time, or extrapolated with velocities from the latest sample.
+  // Input of the sample at or before the time. False before the first sample
+  bool getSample(double time, PoseSample& sample) const;
+
+  void destroy();
+
+private:
+  void start(std::shared_ptr<Backend> backend, const PoseStreamCreateInfo& createInfo);
+
+  class Impl;
+  std::shared_ptr<Impl> impl_;
+};
+
+class PoseStreamCreateInfo
+{
+public:
+  PoseStreamCreateInfo() = default;
+
+public:
+  // Samples per second
+  double frequency = 500.;
+
+  // Samples kept, the history queries may reach back into
+  uint32_t capacity = 256;
+
+  // Seconds past the latest sample that poses are extrapolated, later queries are clamped
+  double maxExtrapolation = 0.05;
+};
+}
+
+#endif // VKOVR_POSE_STREAM_H_
@@ -2,6 +2,7 @@
 #define VKOVR_SESSION_H_
 
 #include <vector>
+#include <array>
 #include <string>
 #include <memory>
 
@@ -9,10 +10,17 @@
 
 #include <OVR_CAPI_Vk.h>
 
+#include <vkovr/backend.h>
+#include <vkovr/layer.h>
+
 namespace vkovr
 {
 class Swapchain;
 class SwapchainCreateInfo;
+class Mirror;
+class MirrorCreateInfo;
+class PoseStream;
+class PoseStreamCreateInfo;
 
 class SessionCreateInfo;
 
@@ -25,12 +33,17 @@ public:
   ~Session();
 
   Swapchain createSwapchain(const SwapchainCreateInfo& createInfo);
+  Mirror createMirror(const MirrorCreateInfo& createInfo);
+
+  // Destroy before the session
+  PoseStream createPoseStream(const PoseStreamCreateInfo& createInfo);
 
   bool opened();
 
   auto getFrameIndex() const { return frameIndex_; }
 
-  operator ovrSession() const { return session_; }
+  operator ovrSession() const { return backend_ ? backend_->getSession() : nullptr; }
+  const auto& getBackend() const { return backend_; }
   const auto& getOculusProperties() const { return hmdDesc_; }
 
   std::vector<std::string> getInstanceExtensions();
@@ -38,31 +51,53 @@ public:
   std::vector<std::string> getDeviceExtensions();
   ovrSessionStatus getStatus() const;
   ovrInputState getInputState() const;
+  ovrPerfStats getPerfStats() const;
 
   void synchronizeWithQueue(vk::Queue queue);
 
-  std::vector<ovrPosef> getEyePoses();
-  void getTouchPoses();
+  std::array<ovrPosef, ovrEye_Count> getEyePoses() const;
+
+  // Samples eye poses again for the display time of the frame begun, right before submission.
+  // endFrame() reports these poses and their sensor sample time
+  std::array<ovrPosef, ovrEye_Count> latchEyePoses();
   ovrMatrix4f getEyeProjection(ovrEyeType eye, float near, float far);
 
+  // Blocks until the runtime is ready for the next frame, pacing the frame loop.
+  // Work independent of eye poses may run on other threads meanwhile
+  void waitFrame();
+
+  // Begins the frame and predicts eye poses at its display time. Waits for the frame first unless waitFrame() was called
   void beginFrame();
-  void endFrame(const std::vector<Swapchain>& swapchains);
+
+  // Seconds, of the frame begun
+  auto getPredictedDisplayTime() const { return hmdFrameTiming_; }
+
+  // Quad and cylinder layers submitted over the eye layer by every endFrame(), in order, at most ovrMaxLayerCount - 1.
+  // Their swapchains need to be rendered and committed only when the content changes
+  void setLayers(const std::vector<Layer>& layers);
+  const auto& getLayers() const { return layers_; }
+
+  // Swapchains of the left and right eye. Viewports cover the fraction of the swapchain extent rendered this frame
+  void endFrame(const std::vector<Swapchain>& swapchains, float viewportScale = 1.f);
 
   void recenter();
 
   void destroy();
 
 private:
-  ovrSession session_ = nullptr;
-  ovrGraphicsLuid luid_{};
+  std::shared_ptr<Backend> backend_;
   ovrHmdDesc hmdDesc_{};
 
   int64_t frameIndex_ = 0;
+  bool frameWaited_ = false;
 
-  std::vector<ovrPosef> eyeRenderPoses_;
+  std::array<ovrPosef, ovrEye_Count> eyeRenderPoses_{};
+  ovrPosef hmdToEyePoses_[ovrEye_Count]{};
   ovrTimewarpProjectionDesc posTimewarpProjectionDesc_;
   double sensorSampleTime_ = 0.f;
   double hmdFrameTiming_ = 0.f;
+
+  std::vector<Layer> layers_;
 };
 
 class SessionCreateInfo
@@ -71,6 +106,8 @@ public:
   SessionCreateInfo() = default;
 
 public:
+  // LibOVR runtime if null
+  std::shared_ptr<Backend> backend;
 };
 
 Session createSession(const SessionCreateInfo& createInfo);
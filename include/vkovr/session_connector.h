@@ -0,0 +1,54 @@
+#ifndef VKOVR_SESSION_CONNECTOR_H_
+#define VKOVR_SESSION_CONNECTOR_H_
+
+#include <memory>
+#include <future>
+#include <chrono>
+
+#include <vkovr/backend.h>
+#include <vkovr/session.h>
+
+namespace vkovr
+{
+class SessionConnector;
+class SessionConnectorCreateInfo;
+
+SessionConnector createSessionConnector(const SessionConnectorCreateInfo& createInfo);
+
+// Creates sessions on a thread of its own, so that the caller's frame loop never blocks on the runtime.
+// Probes the runtime until a headset is available, then creates the session
+class SessionConnector
+{
+  friend SessionConnector createSessionConnector(const SessionConnectorCreateInfo& createInfo);
+
+public:
+  SessionConnector();
+  ~SessionConnector();
+
+  // Starts connecting unless a connection is pending. The future becomes ready with the session, which the caller then owns.
+  // Ready with an exception if the connector is destroyed first
+  std::future<Session> connect();
+
+  // Cancels the pending connection. Waits for a session creation in progress, which is then destroyed
+  void destroy();
+
+private:
+  class Impl;
+  std::shared_ptr<Impl> impl_;
+};
+
+class SessionConnectorCreateInfo
+{
+public:
+  SessionConnectorCreateInfo() = default;
+
+public:
+  // LibOVR runtime if null
+  std::shared_ptr<Backend> backend;
+
+  // Between failed probes or session creations
+  std::chrono::milliseconds retryInterval{ 100 };
+};
+}
+
+#endif // VKOVR_SESSION_CONNECTOR_H_
@@ -27,7 +27,14 @@ public:
   const auto& getDepthImageViews() const { return depthImageViews_; }
   const auto& getExtent() const { return extent_; }
 
-  int acquireNextImageIndex();
+  // Optical axis of the eye, in normalized image coordinates. Foveation centers on it.
+  // The image center for layer swapchains created with an extent, which have no optical axis
+  auto getLensCenter() const { return lensCenter_; }
+
+  // Extent of the viewport rendered at a fraction of the swapchain extent
+  vk::Extent2D getViewportExtent(float viewportScale) const;
+
+  int acquireNextImageIndex() const;
   void commit();
 
   void destroy();
@@ -36,6 +43,7 @@ private:
   Session session_;
   vk::Device device_;
   vk::Extent2D extent_;
+  ovrVector2f lensCenter_{ 0.5f, 0.5f };
   ovrTextureSwapChain colorSwapchain_ = nullptr;
   ovrTextureSwapChain depthSwapchain_ = nullptr;
   std::vector<vk::Image> colorImages_;
@@ -48,7 +56,19 @@ class SwapchainCreateInfo
 {
 public:
   vk::Device device;
-  ovrEyeType eye;
+  ovrEyeType eye = ovrEye_Left;
+
+  // Pixels per display pixel at the center of the view. Sized for the maximum density rendered,
+  // frames may use less of it through the viewport scale in Session::endFrame()
+  float pixelDensity = 1.f;
+
+  // Extent of a quad or cylinder layer swapchain. Sized for the eye fov if zero
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  // The compositor reprojects eye layers with depth, other layers need none.
+  // Eye layers without depth are submitted as ovrLayerType_EyeFov
+  bool depth = true;
 };
 }
 
@@ -1,12 +1,28 @@
 #ifndef VKOVR_VKOVR_HPP_
 #define VKOVR_VKOVR_HPP_
 
+#include <vkovr/backend.h>
+#include <vkovr/layer.h>
 #include <vkovr/session.h>
+#include <vkovr/session_connector.h>
 #include <vkovr/swapchain.h>
+#include <vkovr/mirror.h>
+#include <vkovr/pose_stream.h>
 
 namespace vkovr
 {
-void initialize();
+class InitializeInfo
+{
+public:
+  InitializeInfo() = default;
+
+public:
+  // Skip loading the LibOVR runtime. Sessions must then be created with a mock backend.
+  // Required when built with VKOVR_NO_RUNTIME
+  bool headless = false;
+};
+
+void initialize(const InitializeInfo& initializeInfo = {});
 void terminate();
 }
 
@@ -1,6 +1,5 @@
 #include <vkovr-demo/application.h>
 
-#include <thread>
 #include <chrono>
 #include <queue>
 #include <iostream>
@@ -11,6 +10,7 @@
 
 #include <vkovr-demo/engine/ubo/camera_ubo.h>
 #include <vkovr-demo/engine/ubo/light_ubo.h>
+#include <vkovr-demo/engine/allocation_counter.h>
 #include <vkovr-demo/scene/light.h>
 #include <vkovr-demo/scene/camera.h>
 #include <vkovr-demo/scene/camera_control.h>
@@ -52,32 +52,42 @@ void resize_callback(GLFWwindow* window, int width, int height)
 }
 }
 
-Application::Application()
+Application::Application(const ApplicationCreateInfo& createInfo)
 {
-  if (!glfwInit())
-    throw std::runtime_error("Failed to initialize GLFW");
+  if (createInfo.headless)
+    headlessFrameCount_ = createInfo.frameCount;
+  else
+  {
+    if (!glfwInit())
+      throw std::runtime_error("Failed to initialize GLFW");
 
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
-  window_ = glfwCreateWindow(width_, height_, "Vkovr Demo", NULL, NULL);
+    window_ = glfwCreateWindow(width_, height_, "Vkovr Demo", NULL, NULL);
 
-  constexpr int maxWidth = 1920;
-  constexpr int maxHeight = 1080;
-  glfwSetWindowSizeLimits(window_, 100, 100, maxWidth, maxHeight);
+    constexpr int maxWidth = 1920;
+    constexpr int maxHeight = 1080;
+    glfwSetWindowSizeLimits(window_, 100, 100, maxWidth, maxHeight);
 
-  glfwSetWindowUserPointer(window_, this);
-  glfwSetMouseButtonCallback(window_, mouse_button_callback);
-  glfwSetCursorPosCallback(window_, cursor_pos_callback);
-  glfwSetKeyCallback(window_, key_callback);
-  glfwSetScrollCallback(window_, scroll_callback);
-  glfwSetWindowSizeCallback(window_, resize_callback);
+    glfwSetWindowUserPointer(window_, this);
+    glfwSetMouseButtonCallback(window_, mouse_button_callback);
+    glfwSetCursorPosCallback(window_, cursor_pos_callback);
+    glfwSetKeyCallback(window_, key_callback);
+    glfwSetScrollCallback(window_, scroll_callback);
+    glfwSetWindowSizeCallback(window_, resize_callback);
 
-  glfwSetWindowPos(window_, 1000, 500);
+    glfwSetWindowPos(window_, 1000, 500);
+  }
 
   // Initialize ovr
-  vkovr::initialize();
+  vkovr::InitializeInfo initializeInfo;
+  initializeInfo.headless = createInfo.mockHmd;
+  vkovr::initialize(initializeInfo);
 
-  engine_ = std::make_unique<engine::Engine>(window_, width_, height_);
+  if (createInfo.mockHmd)
+    vrBackend_ = vkovr::createMockBackend({});
+
+  engine_ = std::make_unique<engine::Engine>(window_, width_, height_, createInfo.shaderDirectory, createInfo.framesInFlight);
 
   // Camera
   const auto camera = std::make_shared<scene::Camera>();
@@ -113,9 +123,10 @@ Application::~Application()
   engine_ = nullptr;
 
   if (window_)
+  {
     glfwDestroyWindow(window_);
-
-  glfwTerminate();
+    glfwTerminate();
+  }
 
   vkovr::terminate();
 }
@@ -130,15 +141,20 @@ void Application::run()
   std::deque<Timestamp> deque;
 
   // Start vr worker
-  engine_->startVr();
+  engine_->startVr(vrBackend_);
 
   int64_t recentSeconds = 0;
   const auto startTime = Clock::now();
   Timestamp previousTime = startTime;
   double animationTime = 0.;
-  while (!glfwWindowShouldClose(window_))
+  uint64_t frameCount = 0;
+  while (window_ ? !glfwWindowShouldClose(window_) : frameCount < headlessFrameCount_)
   {
-    glfwPollEvents();
+    if (window_)
+      glfwPollEvents();
+
+    // Jobs with main thread affinity, e.g. GLFW calls requested by other threads
+    engine_->getJobSystem().runMainThreadJobs();
 
     const auto currentTime = Clock::now();
 
@@ -153,6 +169,7 @@ void Application::run()
     updateLight();
     updateCamera();
     engine_->drawFrame();
+    frameCount++;
 
     while (!deque.empty() && deque.front() < currentTime - 1s)
       deque.pop_front();
@@ -166,15 +183,18 @@ void Application::run()
     if (seconds > recentSeconds)
     {
       const auto fps = deque.size();
-      std::cout << "Application: " << fps << std::endl;
+      const auto frameTimings = engine_->getFrameTimings();
+      std::cout << "Application: " << fps
+        << " (record " << frameTimings.recordTime * 1000. << "ms"
+        << ", gpu " << frameTimings.gpuTime * 1000. << "ms";
+      if (engine::isAllocationCounterEnabled())
+        std::cout << ", heap allocations " << frameTimings.heapAllocations;
+      std::cout << ")" << std::endl;
 
       recentSeconds = seconds;
     }
 
     previousTime = currentTime;
-
-    // TODO: need a short delay to remove flickering with two rendering thread. What is the best sleep duration?
-    std::this_thread::sleep_for(0.005s);
   }
 
   engine_->terminateVr();
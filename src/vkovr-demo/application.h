@@ -2,6 +2,7 @@
 #define VKOVR_DEMO_APPLICATION_H_
 
 #include <cstdint>
+#include <string>
 
 #include <vkovr/session.h>
 
@@ -18,10 +19,13 @@ class Camera;
 class CameraControl;
 }
 
+class ApplicationCreateInfo;
+
 class Application
 {
 public:
-  Application();
+  Application() = delete;
+  explicit Application(const ApplicationCreateInfo& createInfo);
   ~Application();
 
   void run();
@@ -41,6 +45,9 @@ private:
   uint32_t height_ = 450;
   GLFWwindow* window_ = nullptr;
 
+  // Headless
+  uint64_t headlessFrameCount_ = 0;
+
   std::unique_ptr<engine::Engine> engine_;
   std::unique_ptr<scene::CameraControl> cameraControl_;
 
@@ -55,6 +62,26 @@ private:
 
   // Animation
   bool isAnimated_ = false;
+
+  // VR
+  std::shared_ptr<vkovr::Backend> vrBackend_;
+};
+
+class ApplicationCreateInfo
+{
+public:
+  // Run the VR path against the software HMD instead of the LibOVR runtime
+  bool mockHmd = false;
+
+  // Render offscreen without a window for a fixed number of frames, e.g. for benchmarks on CI machines
+  bool headless = false;
+  uint64_t frameCount = 1000;
+
+  // Load SPIR-V files from this directory instead of the shaders compiled into the binary
+  std::string shaderDirectory;
+
+  // Frames the CPU may record ahead of the GPU, 1 to 4
+  uint32_t framesInFlight = 3;
 };
 }
 
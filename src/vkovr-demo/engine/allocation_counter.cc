@@ -0,0 +1,50 @@
+#include <vkovr-demo/engine/allocation_counter.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+thread_local uint64_t threadAllocationCount = 0;
+}
+
+#ifndef NDEBUG
+// Array and nothrow forms forward to these by default. Over-aligned allocations are not counted
+void* operator new(std::size_t size)
+{
+  threadAllocationCount++;
+  if (auto pointer = std::malloc(size > 0 ? size : 1))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+#endif
+
+namespace demo
+{
+namespace engine
+{
+bool isAllocationCounterEnabled()
+{
+#ifndef NDEBUG
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint64_t getThreadAllocationCount()
+{
+  return threadAllocationCount;
+}
+}
+}
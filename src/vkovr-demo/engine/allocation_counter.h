@@ -0,0 +1,18 @@
+#ifndef VKOVR_DEMO_ENGINE_ALLOCATION_COUNTER_H_
+#define VKOVR_DEMO_ENGINE_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+namespace demo
+{
+namespace engine
+{
+// Global heap allocations are counted per thread by the replaced operator new in builds without NDEBUG.
+// Frame loops compare counts before and after a steady-state frame, which should allocate nothing
+bool isAllocationCounterEnabled();
+
+uint64_t getThreadAllocationCount();
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_ALLOCATION_COUNTER_H_
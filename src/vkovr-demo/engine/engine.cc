@@ -3,12 +3,15 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <algorithm>
 
 #include <GLFW/glfw3.h>
 
 #include <glm/gtc/type_ptr.hpp>
 
 #include <vkovr-demo/engine/ubo/camera_ubo.h>
+#include <vkovr-demo/engine/allocation_counter.h>
 
 namespace demo
 {
@@ -40,6 +43,16 @@ const std::vector<std::string> vrExpectedDeviceExtensions = {
   "VK_KHR_external_semaphore_win32",
 };
 
+bool isExtensionAvailable(const std::vector<vk::ExtensionProperties>& extensions, const std::string& extensionName)
+{
+  for (const auto& extension : extensions)
+  {
+    if (std::strcmp(extension.extensionName, extensionName.c_str()) == 0)
+      return true;
+  }
+  return false;
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
   VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
   VkDebugUtilsMessageTypeFlagsEXT message_type,
@@ -53,10 +66,12 @@ VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 }
 }
 
-Engine::Engine(GLFWwindow* window, uint32_t width, uint32_t height)
+Engine::Engine(GLFWwindow* window, uint32_t width, uint32_t height, const std::string& shaderDirectory, uint32_t framesInFlight)
   : vrWorker_{ this }
   , width_{ width }
   , height_{ height }
+  , shaderDirectory_{ shaderDirectory }
+  , framesInFlight_{ framesInFlight }
 {
   createInstance(window);
   createDevice();
@@ -68,6 +83,7 @@ Engine::Engine(GLFWwindow* window, uint32_t width, uint32_t height)
   createRenderer();
   createCommandBuffers();
   createSynchronizationObjects();
+  createQueryPool();
 }
 
 Engine::~Engine()
@@ -78,6 +94,7 @@ Engine::~Engine()
 
   vrWorker_.join();
 
+  destroyQueryPool();
   destroySynchronizationObjects();
   destroyCommandBuffers();
   destroyRenderer();
@@ -110,21 +127,32 @@ void Engine::createInstance(GLFWwindow* window)
     .setEngineVersion(VK_MAKE_VERSION(1, 0, 0))
     .setApiVersion(VK_API_VERSION_1_2);
 
-  std::vector<const char*> layers = {
-    "VK_LAYER_KHRONOS_validation",
-  };
+  // Validation layer may not be installed, e.g. on CI machines
+  std::vector<const char*> layers;
+  for (const auto& instanceLayer : instanceLayers)
+  {
+    if (std::strcmp(instanceLayer.layerName, "VK_LAYER_KHRONOS_validation") == 0)
+      layers.push_back("VK_LAYER_KHRONOS_validation");
+  }
 
   std::vector<std::string> extensions = {
     VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
   };
 
-  uint32_t numGlfwExtensions = 0;
-  const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&numGlfwExtensions);
-  for (uint32_t i = 0; i < numGlfwExtensions; i++)
-    extensions.push_back(glfwExtensions[i]);
+  if (window)
+  {
+    uint32_t numGlfwExtensions = 0;
+    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&numGlfwExtensions);
+    for (uint32_t i = 0; i < numGlfwExtensions; i++)
+      extensions.push_back(glfwExtensions[i]);
+  }
 
+  // Platform specific extensions, e.g. win32 surface, are skipped where unavailable
   for (const auto& ovrExtension : vrExpectedInstanceExtensions)
-    extensions.push_back(ovrExtension);
+  {
+    if (isExtensionAvailable(instanceExtensions, ovrExtension))
+      extensions.push_back(ovrExtension);
+  }
 
   // Create instance
   std::vector<const char*> extensionCstr;
@@ -155,14 +183,18 @@ void Engine::createInstance(GLFWwindow* window)
   messenger_ = instance_.createDebugUtilsMessengerEXT(chain.get<vk::DebugUtilsMessengerCreateInfoEXT>(), nullptr, dld);
 
   // Create surface
-  VkSurfaceKHR surfaceHandle;
-  glfwCreateWindowSurface(instance_, window, nullptr, &surfaceHandle);
-  surface_ = surfaceHandle;
+  if (window)
+  {
+    VkSurfaceKHR surfaceHandle;
+    glfwCreateWindowSurface(instance_, window, nullptr, &surfaceHandle);
+    surface_ = surfaceHandle;
+  }
 }
 
 void Engine::destroyInstance()
 {
-  instance_.destroySurfaceKHR(surface_);
+  if (surface_)
+    instance_.destroySurfaceKHR(surface_);
 
   vk::DynamicLoader dl;
   PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
@@ -187,40 +219,116 @@ void Engine::createDevice()
   uboAlignment_ = physicalDevice_.getProperties().limits.minUniformBufferOffsetAlignment;
   ssboAlignment_ = physicalDevice_.getProperties().limits.minStorageBufferOffsetAlignment;
 
-  // Find general queue capable of graphics, compute and present
+  // Find general queue capable of graphics, compute and present.
+  // Prefer a family with separate queues for desktop, vr and present submissions
   constexpr auto queueFlag = vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute;
   const auto queueFamilyProperties = physicalDevice_.getQueueFamilyProperties();
+  uint32_t queueCount = 0;
   for (int i = 0; i < queueFamilyProperties.size(); i++)
   {
     if ((queueFamilyProperties[i].queueFlags & queueFlag) == queueFlag &&
-      physicalDevice_.getSurfaceSupportKHR(i, surface_) &&
-      queueFamilyProperties[i].queueCount >= 3)
+      (!surface_ || physicalDevice_.getSurfaceSupportKHR(i, surface_)) &&
+      queueFamilyProperties[i].queueCount > queueCount)
     {
       queueIndex_ = i;
+      queueCount = queueFamilyProperties[i].queueCount;
+      if (queueCount >= 3)
+        break;
+    }
+  }
+
+  if (queueCount == 0)
+    throw std::runtime_error("Failed to find a graphics queue");
+
+  // Software devices may expose a single queue, which is then shared by the desktop and vr threads
+  queueCount = std::min(queueCount, 3u);
+  if (queueCount < 3)
+    std::cout << "Device has " << queueCount << " queue(s), desktop and VR submissions share a queue" << std::endl;
+
+  std::vector<float> queuePriorities(queueCount, 1.f);
+  std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+  queueCreateInfos.push_back({ {}, queueIndex_, queuePriorities });
+
+  // Dedicated transfer queue family for uploads, otherwise uploads go to the desktop queue
+  transferQueueIndex_ = queueIndex_;
+  for (int i = 0; i < queueFamilyProperties.size(); i++)
+  {
+    const auto flags = queueFamilyProperties[i].queueFlags;
+    if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+    {
+      transferQueueIndex_ = i;
       break;
     }
   }
 
-  std::vector<float> queuePriorities = {
-    1.f, 1.f, 1.f,
-  };
-  vk::DeviceQueueCreateInfo queueCreateInfo{ {},
-    queueIndex_, queuePriorities
-  };
+  const float transferQueuePriority = 1.f;
+  if (transferQueueIndex_ != queueIndex_)
+    queueCreateInfos.push_back({ {}, transferQueueIndex_, 1, &transferQueuePriority });
 
   // Device extensions
-  std::vector<std::string> extensions = {
-    VK_KHR_SWAPCHAIN_EXTENSION_NAME
-  };
+  std::vector<std::string> extensions;
+  if (surface_)
+    extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
   for (const auto& ovrExtension : vrExpectedDeviceExtensions)
-    extensions.push_back(ovrExtension);
+  {
+    if (isExtensionAvailable(deviceExtensions, ovrExtension) &&
+      std::find(extensions.begin(), extensions.end(), ovrExtension) == extensions.end())
+      extensions.push_back(ovrExtension);
+  }
+
+  // Heap budget and usage for the memory pool
+  memoryBudget_ = isExtensionAvailable(deviceExtensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  if (memoryBudget_)
+    extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
   // Device features
   auto features = physicalDevice_.getFeatures();
   features
     .setSamplerAnisotropy(true);
 
+  // Multiview for single-pass stereo rendering
+  const auto featureChain = physicalDevice_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMultiviewFeatures,
+    vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+  multiview_ = featureChain.get<vk::PhysicalDeviceMultiviewFeatures>().multiview;
+
+  vk::PhysicalDeviceMultiviewFeatures multiviewFeatures;
+  multiviewFeatures
+    .setMultiview(multiview_);
+
+  // Fragment density map for foveated VR rendering. Its feature struct is chained only when the extension is available
+  fragmentDensityMap_ = false;
+  if (isExtensionAvailable(deviceExtensions, VK_EXT_FRAGMENT_DENSITY_MAP_EXTENSION_NAME))
+  {
+    const auto fragmentDensityMapChain = physicalDevice_.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceFragmentDensityMapFeaturesEXT>();
+    fragmentDensityMap_ = fragmentDensityMapChain.get<vk::PhysicalDeviceFragmentDensityMapFeaturesEXT>().fragmentDensityMap;
+  }
+  if (fragmentDensityMap_)
+    extensions.push_back(VK_EXT_FRAGMENT_DENSITY_MAP_EXTENSION_NAME);
+
+  vk::PhysicalDeviceFragmentDensityMapFeaturesEXT fragmentDensityMapFeatures;
+  fragmentDensityMapFeatures
+    .setFragmentDensityMap(fragmentDensityMap_);
+
+  if (fragmentDensityMap_)
+    multiviewFeatures.setPNext(&fragmentDensityMapFeatures);
+
+  // Timeline semaphores for frame scheduling, core in Vulkan 1.2
+  if (!featureChain.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>().timelineSemaphore)
+    throw std::runtime_error("Failed to find timeline semaphore support, requires Vulkan 1.2");
+
+  vk::PhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures;
+  timelineSemaphoreFeatures
+    .setTimelineSemaphore(true)
+    .setPNext(multiviewFeatures.pNext);
+  multiviewFeatures.setPNext(&timelineSemaphoreFeatures);
+
+  // Depth resolve of multisampled VR frames for the compositor's reprojection, with the sample zero modes the render pass uses
+  const auto depthStencilResolveProperties = physicalDevice_.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDepthStencilResolveProperties>()
+    .get<vk::PhysicalDeviceDepthStencilResolveProperties>();
+  depthResolve_ = (depthStencilResolveProperties.supportedDepthResolveModes & vk::ResolveModeFlagBits::eSampleZero)
+    && (depthStencilResolveProperties.supportedStencilResolveModes & vk::ResolveModeFlagBits::eSampleZero);
+
   // Create device
   std::vector<const char*> extensionCstr;
   for (const auto& extension : extensions)
@@ -228,14 +336,17 @@ void Engine::createDevice()
 
   vk::DeviceCreateInfo deviceCreateInfo;
   deviceCreateInfo
-    .setQueueCreateInfos(queueCreateInfo)
+    .setQueueCreateInfos(queueCreateInfos)
     .setPEnabledExtensionNames(extensionCstr)
-    .setPEnabledFeatures(&features);
+    .setPEnabledFeatures(&features)
+    .setPNext(&multiviewFeatures);
   device_ = physicalDevice_.createDevice(deviceCreateInfo);
 
   queue_ = device_.getQueue(queueIndex_, 0);
-  vrQueue_ = device_.getQueue(queueIndex_, 1);
-  presentQueue_ = device_.getQueue(queueIndex_, 2);
+  vrQueue_ = device_.getQueue(queueIndex_, std::min(1u, queueCount - 1));
+  // Presentation shares the desktop queue and its lock unless it has a queue of its own, never the VR queue
+  presentQueue_ = queueCount >= 3 ? device_.getQueue(queueIndex_, 2) : queue_;
+  transferQueue_ = transferQueueIndex_ != queueIndex_ ? device_.getQueue(transferQueueIndex_, 0) : queue_;
 }
 
 void Engine::destroyDevice()
@@ -245,6 +356,10 @@ void Engine::destroyDevice()
 
 void Engine::createResourcePools()
 {
+  // Job system
+  JobSystemCreateInfo jobSystemCreateInfo;
+  jobSystem_ = createJobSystem(jobSystemCreateInfo);
+
   // Command pool
   vk::CommandPoolCreateInfo commandPoolCreateInfo;
   commandPoolCreateInfo
@@ -257,7 +372,9 @@ void Engine::createResourcePools()
   constexpr auto setCount = 1000;
   std::vector<vk::DescriptorPoolSize> poolSizes = {
     {vk::DescriptorType::eUniformBuffer, descriptorCount},
+    {vk::DescriptorType::eUniformBufferDynamic, descriptorCount},
     {vk::DescriptorType::eStorageBuffer, descriptorCount},
+    {vk::DescriptorType::eStorageBufferDynamic, descriptorCount},
     {vk::DescriptorType::eCombinedImageSampler, descriptorCount},
   };
 
@@ -267,21 +384,66 @@ void Engine::createResourcePools()
     .setPoolSizes(poolSizes);
   descriptorPool_ = device_.createDescriptorPool(descriptorPoolCreateInfo);
 
-  // Memory pool
-  constexpr vk::DeviceSize memorySize = 1024 * 1024 * 1024; // 1GB
+  // Memory pool, growing on demand within heap budgets
   MemoryPoolCreateInfo memoryPoolCreateInfo;
   memoryPoolCreateInfo.device = device_;
   memoryPoolCreateInfo.physicalDevice = physicalDevice_;
-  memoryPoolCreateInfo.deviceMemorySize = memorySize;
-  memoryPoolCreateInfo.hostMemorySize = memorySize;
+  memoryPoolCreateInfo.blockSize = 64 * 1024 * 1024; // 64MB
+  memoryPoolCreateInfo.memoryBudget = memoryBudget_;
   memoryPool_ = createMemoryPool(memoryPoolCreateInfo);
+
+  // Uploader
+  UploaderCreateInfo uploaderCreateInfo;
+  uploaderCreateInfo.device = device_;
+  uploaderCreateInfo.pMemoryPool = &memoryPool_;
+  uploaderCreateInfo.queue = transferQueue_;
+  uploaderCreateInfo.queueIndex = transferQueueIndex_;
+  uploaderCreateInfo.graphicsQueueIndex = queueIndex_;
+  uploaderCreateInfo.pQueueMutex = transferQueue_ == queue_ && vrQueue_ == queue_ ? &queueMutex_ : nullptr;
+  uploader_ = createUploader(uploaderCreateInfo);
+
+  // Uniform allocator, a region per frame in flight as indexed in drawFrame()
+  UniformAllocatorCreateInfo uniformAllocatorCreateInfo;
+  uniformAllocatorCreateInfo.device = device_;
+  uniformAllocatorCreateInfo.physicalDevice = physicalDevice_;
+  uniformAllocatorCreateInfo.pMemoryPool = &memoryPool_;
+  uniformAllocatorCreateInfo.frameCount = framesInFlight_;
+  uniformAllocator_ = createUniformAllocator(uniformAllocatorCreateInfo);
+
+  // Parallel recorder of secondary command buffers, with the same frames in flight
+  ParallelRecorderCreateInfo parallelRecorderCreateInfo;
+  parallelRecorderCreateInfo.device = device_;
+  parallelRecorderCreateInfo.queueIndex = queueIndex_;
+  parallelRecorderCreateInfo.pJobSystem = &jobSystem_;
+  parallelRecorderCreateInfo.frameCount = framesInFlight_;
+  parallelRecorder_ = createParallelRecorder(parallelRecorderCreateInfo);
+
+  // Pipeline cache shared with vr worker, saved on shutdown
+  PipelineCacheCreateInfo pipelineCacheCreateInfo;
+  pipelineCacheCreateInfo.device = device_;
+  pipelineCacheCreateInfo.physicalDevice = physicalDevice_;
+  pipelineCacheCreateInfo.filepath = "pipeline_cache.bin";
+  pipelineCache_ = createPipelineCache(pipelineCacheCreateInfo);
+
+  const auto heapBudgets = memoryPool_.getHeapBudgets();
+  for (int i = 0; i < heapBudgets.size(); i++)
+  {
+    std::cout << "Memory heap " << i << ": budget " << heapBudgets[i].budget / 1024 / 1024 << "MB"
+      << ", usage " << heapBudgets[i].usage / 1024 / 1024 << "MB" << std::endl;
+  }
 }
 
 void Engine::destroyResourcePools()
 {
   device_.destroyCommandPool(commandPool_);
   device_.destroyDescriptorPool(descriptorPool_);
+  pipelineCache_.save();
+  pipelineCache_.destroy();
+  uploader_.destroy();
+  uniformAllocator_.destroy();
+  parallelRecorder_.destroy();
   memoryPool_.destroy();
+  jobSystem_.destroy();
 }
 
 void Engine::createSwapchain()
@@ -292,6 +454,8 @@ void Engine::createSwapchain()
   swapchainCreateInfo.surface = surface_;
   swapchainCreateInfo.width = width_;
   swapchainCreateInfo.height = height_;
+  swapchainCreateInfo.queue = queue_;
+  swapchainCreateInfo.pMemoryPool = &memoryPool_;
   swapchain_ = engine::createSwapchain(swapchainCreateInfo);
 }
 
@@ -306,7 +470,7 @@ void Engine::createRenderPass()
   renderPassCreateInfo.device = device_;
   renderPassCreateInfo.format = swapchain_.getImageFormat();
   renderPassCreateInfo.samples = vk::SampleCountFlagBits::e4;
-  renderPassCreateInfo.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+  renderPassCreateInfo.finalLayout = swapchain_.getFinalLayout();
   renderPass_ = engine::createRenderPass(renderPassCreateInfo);
 }
 
@@ -341,10 +505,11 @@ void Engine::createRenderer()
   rendererCreateInfo.physicalDevice = physicalDevice_;
   rendererCreateInfo.pRenderPass = &renderPass_;
   rendererCreateInfo.descriptorPool = descriptorPool_;
-  rendererCreateInfo.imageCount = swapchain_.getImageCount();
+  rendererCreateInfo.pipelineCache = pipelineCache_;
   rendererCreateInfo.textureImageView = texture_.getImageView();
   rendererCreateInfo.sampler = sampler_;
-  rendererCreateInfo.pMemoryPool = &memoryPool_;
+  rendererCreateInfo.pUniformAllocator = &uniformAllocator_;
+  rendererCreateInfo.shaderDirectory = shaderDirectory_;
   renderer_ = engine::createRenderer(rendererCreateInfo);
 }
 
@@ -355,158 +520,191 @@ void Engine::destroyRenderer()
 
 void Engine::prepareResources()
 {
-  mesh_ = std::make_unique<scene::Mesh>();
-  mesh_->setHasNormal();
-  mesh_->setHasTexture();
-
-  scene::Mesh::Vertex vertex;
-
-  constexpr float pi = 3.141592f;
-  constexpr int segment = 16;
-  for (int i = 0; i <= segment * 2; i++)
+  // Mesh and texture are generated in parallel, and each is uploaded once generated
+  const auto meshJob = jobSystem_.submit([this]
   {
-    const auto theta = static_cast<float>(i) / (segment * 2.f) * pi * 2.f;
-    const auto cosTheta = std::cos(theta);
-    const auto sinTheta = std::sin(theta);
+    mesh_ = std::make_unique<scene::Mesh>();
+    mesh_->setHasNormal();
+    mesh_->setHasTexture();
 
-    vertex.position = { 0.f, 0.f, 1.f };
-    vertex.normal = vertex.position;
-    vertex.tex_coord = glm::vec2{ (static_cast<float>(i) + 0.5f) / (segment * 2.f), 1.f } * 8.f;
-    mesh_->addVertex(vertex);
+    scene::Mesh::Vertex vertex;
 
-    for (int j = 1; j < segment; j++)
+    constexpr float pi = 3.141592f;
+    constexpr int segment = 16;
+    for (int i = 0; i <= segment * 2; i++)
     {
-      const auto phi = static_cast<float>(j) / segment * pi;
-      const auto cosPhi = std::cos(phi);
-      const auto sinPhi = std::sin(phi);
+      const auto theta = static_cast<float>(i) / (segment * 2.f) * pi * 2.f;
+      const auto cosTheta = std::cos(theta);
+      const auto sinTheta = std::sin(theta);
 
-      vertex.position = { cosTheta * sinPhi, sinTheta * sinPhi, cosPhi };
+      vertex.position = { 0.f, 0.f, 1.f };
       vertex.normal = vertex.position;
-      vertex.tex_coord = glm::vec2{ static_cast<float>(i) / (segment * 2.f), 1.f - static_cast<float>(j) / segment } * 8.f;
+      vertex.tex_coord = glm::vec2{ (static_cast<float>(i) + 0.5f) / (segment * 2.f), 1.f } * 8.f;
+      mesh_->addVertex(vertex);
+
+      for (int j = 1; j < segment; j++)
+      {
+        const auto phi = static_cast<float>(j) / segment * pi;
+        const auto cosPhi = std::cos(phi);
+        const auto sinPhi = std::sin(phi);
+
+        vertex.position = { cosTheta * sinPhi, sinTheta * sinPhi, cosPhi };
+        vertex.normal = vertex.position;
+        vertex.tex_coord = glm::vec2{ static_cast<float>(i) / (segment * 2.f), 1.f - static_cast<float>(j) / segment } * 8.f;
 
+        mesh_->addVertex(vertex);
+      }
+
+      vertex.position = { 0.f, 0.f, -1.f };
+      vertex.normal = vertex.position;
+      vertex.tex_coord = glm::vec2{ (static_cast<float>(i) + 0.5f) / (segment * 2.f), 0.f } * 8.f;
       mesh_->addVertex(vertex);
     }
 
-    vertex.position = { 0.f, 0.f, -1.f };
-    vertex.normal = vertex.position;
-    vertex.tex_coord = glm::vec2{ (static_cast<float>(i) + 0.5f) / (segment * 2.f), 0.f } * 8.f;
-    mesh_->addVertex(vertex);
-  }
+    for (int i = 0; i < segment * 2; i++)
+    {
+      mesh_->addFace({ i * (segment + 1), i * (segment + 1) + 1, (i + 1) * (segment + 1) + 1 });
 
-  for (int i = 0; i < segment * 2; i++)
-  {
-    mesh_->addFace({ i * (segment + 1), i * (segment + 1) + 1, (i + 1) * (segment + 1) + 1 });
+      for (int j = 1; j < segment - 1; j++)
+      {
+        const auto f0 = i * (segment + 1) + j;
+        const auto f1 = i * (segment + 1) + j + 1;
+        const auto f2 = (i + 1) * (segment + 1) + j;
+        const auto f3 = (i + 1) * (segment + 1) + j + 1;
 
-    for (int j = 1; j < segment - 1; j++)
-    {
-      const auto f0 = i * (segment + 1) + j;
-      const auto f1 = i * (segment + 1) + j + 1;
-      const auto f2 = (i + 1) * (segment + 1) + j;
-      const auto f3 = (i + 1) * (segment + 1) + j + 1;
+        mesh_->addFace({ f0, f1, f2 });
+        mesh_->addFace({ f1, f3, f2 });
+      }
 
-      mesh_->addFace({ f0, f1, f2 });
-      mesh_->addFace({ f1, f3, f2 });
+      mesh_->addFace({ i * (segment + 1) + segment, (i + 1) * (segment + 1) + segment - 1, i * (segment + 1) + segment - 1 });
     }
-
-    mesh_->addFace({ i * (segment + 1) + segment, (i + 1) * (segment + 1) + segment - 1, i * (segment + 1) + segment - 1 });
-  }
+  });
 
   // Checkerboard texture
   constexpr int checkerboardTextureLength = 128;
   std::vector<uint8_t> checkerboardTexture(checkerboardTextureLength * checkerboardTextureLength * 4);
-  for (int u = 0; u < checkerboardTextureLength; u++)
+  const auto textureJob = jobSystem_.submit([&checkerboardTexture]
   {
-    for (int v = 0; v < checkerboardTextureLength; v++)
+    for (int u = 0; u < checkerboardTextureLength; u++)
     {
-      uint8_t color = (255 - 64) + 64 * !((u < checkerboardTextureLength / 2) ^ (v < checkerboardTextureLength / 2));
-      checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 0] = color;
-      checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 1] = color;
-      checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 2] = color;
-      checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 3] = 255;
+      for (int v = 0; v < checkerboardTextureLength; v++)
+      {
+        uint8_t color = (255 - 64) + 64 * !((u < checkerboardTextureLength / 2) ^ (v < checkerboardTextureLength / 2));
+        checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 0] = color;
+        checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 1] = color;
+        checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 2] = color;
+        checkerboardTexture[(v * checkerboardTextureLength + u) * 4 + 3] = 255;
+      }
     }
-  }
-  constexpr int checkerboardTextureSize = checkerboardTextureLength * checkerboardTextureLength * sizeof(uint8_t) * 4;
-
-  // Buffer
-  const auto& vertices = mesh_->vertices();
-  const auto& faces = mesh_->faces();
-
-  const auto vertexBufferSize = sizeof(vertices[0]) * vertices.size();
-  const auto indexBufferSize = sizeof(faces[0]) * faces.size();
-
-  const auto meshBufferSize = vertexBufferSize + indexBufferSize;
-  const auto bufferSize = meshBufferSize + checkerboardTextureSize;
-  const auto checkerboardTextureOffset = meshBufferSize;
-
-  vk::BufferCreateInfo bufferCreateInfo;
-  bufferCreateInfo
-    .setUsage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer)
-    .setSize(bufferSize);
-  meshBuffer_ = device_.createBuffer(bufferCreateInfo);
-  meshIndexOffset_ = vertexBufferSize;
-  meshIndexCount_ = faces.size() * 3;
-
-  const auto meshMemory = memoryPool_.allocateDeviceMemory(meshBuffer_);
-  device_.bindBufferMemory(meshBuffer_, meshMemory.memory, meshMemory.offset);
-
-  // Staging buffer for mesh
-  bufferCreateInfo
-    .setUsage(vk::BufferUsageFlagBits::eTransferSrc)
-    .setSize(bufferSize);
-  stagingBuffer_ = device_.createBuffer(bufferCreateInfo);
+  });
 
-  const auto stagingMemory = memoryPool_.allocatePersistentlyMappedMemory(stagingBuffer_);
-  device_.bindBufferMemory(stagingBuffer_, stagingMemory.memory, stagingMemory.offset);
-
-  memcpy(stagingMemory.map, vertices.data(), vertexBufferSize);
-  memcpy(stagingMemory.map + vertexBufferSize, faces.data(), indexBufferSize);
-  memcpy(stagingMemory.map + meshBufferSize, checkerboardTexture.data(), checkerboardTextureSize);
+  const auto meshUploadJob = jobSystem_.submit([this]
+  {
+    // Buffer
+    const auto& vertices = mesh_->vertices();
+    const auto& faces = mesh_->faces();
+
+    const auto vertexBufferSize = sizeof(vertices[0]) * vertices.size();
+    const auto indexBufferSize = sizeof(faces[0]) * faces.size();
+
+    const auto meshBufferSize = vertexBufferSize + indexBufferSize;
+
+    vk::BufferCreateInfo bufferCreateInfo;
+    bufferCreateInfo
+      .setUsage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer)
+      .setSize(meshBufferSize);
+    meshBuffer_ = device_.createBuffer(bufferCreateInfo);
+    meshIndexOffset_ = vertexBufferSize;
+    meshIndexCount_ = faces.size() * 3;
+
+    meshMemory_ = memoryPool_.allocateDeviceMemory(meshBuffer_);
+    device_.bindBufferMemory(meshBuffer_, meshMemory_.memory, meshMemory_.offset);
+
+    // Upload through the staging ring
+    uploader_.uploadBuffer(meshBuffer_, 0, vertices.data(), vertexBufferSize,
+      vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
+    uploader_.uploadBuffer(meshBuffer_, meshIndexOffset_, faces.data(), indexBufferSize,
+      vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
+  }, { meshJob });
+
+  const auto textureUploadJob = jobSystem_.submit([this, &checkerboardTexture]
+  {
+    // Generate texture
+    TextureCreateInfo textureCreateInfo;
+    textureCreateInfo.device = device_;
+    textureCreateInfo.width = checkerboardTextureLength;
+    textureCreateInfo.height = checkerboardTextureLength;
+    textureCreateInfo.pixels = checkerboardTexture.data();
+    textureCreateInfo.mipLevel = mipLevel_;
+    textureCreateInfo.pMemoryPool = &memoryPool_;
+    textureCreateInfo.pUploader = &uploader_;
+    texture_ = engine::createTexture(textureCreateInfo);
+  }, { textureJob });
+
+  jobSystem_.wait({ meshUploadJob, textureUploadJob });
+
+  // The scene is drawn from the first frame, so wait for the uploads here.
+  // Acquire and mipmap generation run on the desktop queue
+  uploader_.wait(uploader_.flush());
 
-  // Copy to device memory
   vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
   commandBufferAllocateInfo
     .setLevel(vk::CommandBufferLevel::ePrimary)
     .setCommandPool(commandPool_)
     .setCommandBufferCount(1);
-  const auto copyCommandBuffer = device_.allocateCommandBuffers(commandBufferAllocateInfo)[0];
-  copyCommandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
-
-  vk::BufferCopy copyRegion;
-  copyRegion
-    .setSrcOffset(0)
-    .setDstOffset(0)
-    .setSize(meshBufferSize);
-  copyCommandBuffer.copyBuffer(stagingBuffer_, meshBuffer_, copyRegion);
-
-  vk::BufferMemoryBarrier bufferMemoryBarrier;
-  bufferMemoryBarrier
-    .setBuffer(meshBuffer_)
-    .setOffset(0)
-    .setSize(bufferSize)
-    .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
-    .setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead)
-    .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
-  copyCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput, {},
-    {}, bufferMemoryBarrier, {});
-
-  // Generate texture
-  TextureCreateInfo textureCreateInfo;
-  textureCreateInfo.device = device_;
-  textureCreateInfo.width = checkerboardTextureLength;
-  textureCreateInfo.height = checkerboardTextureLength;
-  textureCreateInfo.mipLevel = mipLevel_;
-  textureCreateInfo.pMemoryPool = &memoryPool_;
-  textureCreateInfo.srcBuffer = stagingBuffer_;
-  textureCreateInfo.srcOffset = checkerboardTextureOffset;
-  textureCreateInfo.commandBuffer = copyCommandBuffer;
-  texture_ = engine::createTexture(textureCreateInfo);
-
-  copyCommandBuffer.end();
+  const auto commandBuffer = device_.allocateCommandBuffers(commandBufferAllocateInfo)[0];
+  commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+  uploader_.acquire(commandBuffer);
+  texture_.generateMipmaps(commandBuffer);
+
+  // Mirror images, in general layout for the lifetime of the engine as the vr thread writes one while the desktop reads another
+  vk::ImageCreateInfo mirrorImageCreateInfo;
+  mirrorImageCreateInfo
+    .setImageType(vk::ImageType::e2D)
+    .setFormat(swapchain_.getImageFormat())
+    .setExtent({ width_, height_, 1 })
+    .setMipLevels(1)
+    .setArrayLayers(1)
+    .setSamples(vk::SampleCountFlagBits::e1)
+    .setTiling(vk::ImageTiling::eOptimal)
+    .setUsage(vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst)
+    .setSharingMode(vk::SharingMode::eExclusive)
+    .setInitialLayout(vk::ImageLayout::eUndefined);
+  std::array<vk::ImageMemoryBarrier, 3> mirrorBarriers;
+  for (int i = 0; i < mirrorImages_.size(); i++)
+  {
+    mirrorImages_[i] = device_.createImage(mirrorImageCreateInfo);
+    mirrorMemories_[i] = memoryPool_.allocateDeviceMemory(mirrorImages_[i]);
+    device_.bindImageMemory(mirrorImages_[i], mirrorMemories_[i].memory, mirrorMemories_[i].offset);
+
+    mirrorBarriers[i]
+      .setImage(mirrorImages_[i])
+      .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+      .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+      .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 })
+      .setOldLayout(vk::ImageLayout::eUndefined)
+      .setNewLayout(vk::ImageLayout::eGeneral)
+      .setSrcAccessMask({})
+      .setDstAccessMask(vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+  }
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+    {}, {}, {}, mirrorBarriers);
+  commandBuffer.end();
 
+  const auto fence = device_.createFence({});
   vk::SubmitInfo submitInfo;
-  submitInfo.setCommandBuffers(copyCommandBuffer);
-  queue_.submit(submitInfo);
+  submitInfo.setCommandBuffers(commandBuffer);
+  {
+    const auto queueLock = lockSharedQueue();
+    queue_.submit(submitInfo, fence);
+  }
+
+  const auto result = device_.waitForFences(fence, true, UINT64_MAX);
+  if (result != vk::Result::eSuccess)
+    throw std::runtime_error("Failed to wait for resource upload");
+
+  device_.destroyFence(fence);
+  device_.freeCommandBuffers(commandPool_, commandBuffer);
 
   // Create sampler
   SamplerCreateInfo samplerCreateInfo;
@@ -520,25 +718,26 @@ void Engine::destroyResources()
   mesh_ = nullptr;
 
   device_.destroyBuffer(meshBuffer_);
-  device_.destroyBuffer(stagingBuffer_);
+  memoryPool_.free(meshMemory_);
   texture_.destroy();
   sampler_.destroy();
+
+  for (int i = 0; i < mirrorImages_.size(); i++)
+  {
+    device_.destroyImage(mirrorImages_[i]);
+    memoryPool_.free(mirrorMemories_[i]);
+  }
 }
 
 void Engine::createCommandBuffers()
 {
-  const auto imageCount = swapchain_.getImageCount();
-
+  // Per frame in flight
   vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
   commandBufferAllocateInfo
     .setLevel(vk::CommandBufferLevel::ePrimary)
     .setCommandPool(commandPool_)
-    .setCommandBufferCount(imageCount);
+    .setCommandBufferCount(framesInFlight_);
   drawCommandBuffers_ = device_.allocateCommandBuffers(commandBufferAllocateInfo);
-
-  // Transfer command buffer
-  commandBufferAllocateInfo.setCommandBufferCount(1);
-  transferCommandBuffer_ = device_.allocateCommandBuffers(commandBufferAllocateInfo)[0];
 }
 
 void Engine::destroyCommandBuffers()
@@ -550,14 +749,17 @@ void Engine::createSynchronizationObjects()
 {
   const auto imageCount = swapchain_.getImageCount();
 
-  for (int i = 0; i < imageCount; i++)
+  FrameSchedulerCreateInfo frameSchedulerCreateInfo;
+  frameSchedulerCreateInfo.device = device_;
+  frameSchedulerCreateInfo.frameCount = framesInFlight_;
+  frameScheduler_ = createFrameScheduler(frameSchedulerCreateInfo);
+
+  // Acquired per frame in flight, presented per swapchain image
+  for (uint32_t i = 0; i < framesInFlight_; i++)
     imageAvailableSemaphores_.emplace_back(device_.createSemaphore({}));
 
-  for (int i = 0; i < imageCount; i++)
+  for (uint32_t i = 0; i < imageCount; i++)
     renderFinishedSemaphores_.emplace_back(device_.createSemaphore({}));
-
-  for (int i = 0; i < imageCount; i++)
-    renderFinishedFences_.emplace_back(device_.createFence({ vk::FenceCreateFlagBits::eSignaled }));
 }
 
 void Engine::destroySynchronizationObjects()
@@ -570,9 +772,41 @@ void Engine::destroySynchronizationObjects()
     device_.destroySemaphore(semaphore);
   renderFinishedSemaphores_.clear();
 
-  for (auto fence : renderFinishedFences_)
-    device_.destroyFence(fence);
-  renderFinishedFences_.clear();
+  frameScheduler_.destroy();
+}
+
+void Engine::createQueryPool()
+{
+  // Timestamps at the beginning and the end of each frame in flight
+  const auto timestampValidBits = physicalDevice_.getQueueFamilyProperties()[queueIndex_].timestampValidBits;
+  if (timestampValidBits == 0)
+    return;
+
+  timestampPeriod_ = physicalDevice_.getProperties().limits.timestampPeriod;
+
+  const auto frameCount = framesInFlight_;
+
+  vk::QueryPoolCreateInfo queryPoolCreateInfo;
+  queryPoolCreateInfo
+    .setQueryType(vk::QueryType::eTimestamp)
+    .setQueryCount(frameCount * 2);
+  timestampQueryPool_ = device_.createQueryPool(queryPoolCreateInfo);
+
+  timestampWritten_.resize(frameCount, false);
+}
+
+void Engine::destroyQueryPool()
+{
+  if (timestampQueryPool_)
+    device_.destroyQueryPool(timestampQueryPool_);
+  timestampWritten_.clear();
+}
+
+std::unique_lock<std::mutex> Engine::lockSharedQueue()
+{
+  if (vrQueue_ == queue_)
+    return std::unique_lock<std::mutex>{ queueMutex_ };
+  return {};
 }
 
 void Engine::recreateSwapchain()
@@ -599,20 +833,32 @@ void Engine::updateLight(const LightUbo& light)
   renderer_.updateLight(light);
 }
 
-void Engine::startVr()
+void Engine::startVr(std::shared_ptr<vkovr::Backend> backend)
 {
   VrWorkerRunInfo runInfo;
+  runInfo.backend = backend;
   runInfo.instance = instance_;
   runInfo.physicalDevice = physicalDevice_;
   runInfo.device = device_;
   runInfo.queue = vrQueue_;
   runInfo.queueIndex = queueIndex_;
+  runInfo.pQueueMutex = vrQueue_ == queue_ ? &queueMutex_ : nullptr;
   runInfo.pMemoryPool = &memoryPool_;
+  runInfo.pJobSystem = &jobSystem_;
+  runInfo.pipelineCache = pipelineCache_;
+  runInfo.shaderDirectory = shaderDirectory_;
+  runInfo.multiview = multiview_;
+  runInfo.fragmentDensityMap = fragmentDensityMap_;
+  runInfo.depthResolve = depthResolve_;
+  runInfo.framesInFlight = framesInFlight_;
   runInfo.meshBuffer = meshBuffer_;
   runInfo.meshIndexCount = meshIndexCount_;
   runInfo.meshIndexOffset = meshIndexOffset_;
   runInfo.pTexture = &texture_;
   runInfo.pSampler = &sampler_;
+  runInfo.mirrorImages = mirrorImages_;
+  runInfo.mirrorExtent = vk::Extent2D{ width_, height_ };
+  runInfo.mirrorReadSemaphore = frameScheduler_.getSemaphore();
   vrWorker_.run(runInfo);
 }
 
@@ -636,18 +882,29 @@ void Engine::drawFrame()
   const glm::vec3 cameraPosition = (glm::vec3{ eyePoses[0][3] } + glm::vec3{ eyePoses[1][3] }) / 2.f;
   objectModel[3] = glm::vec4{ cameraPosition.x, cameraPosition.y + 1.f, cameraPosition.z, 1.f };
 
-  // Draw on window surface
-  const auto frameIndex = frameIndex_ % 3;
-  const auto result = device_.waitForFences(renderFinishedFences_[frameIndex], true, 0);
-  if (result == vk::Result::eTimeout)
+  // Draw on window surface. Skipped if no frame slot retires in time, so that window events stay responsive
+  const auto frameIndex = frameScheduler_.getFrameIndex();
+  if (!frameScheduler_.waitForFrameUntil(FrameScheduler::Clock::now() + frameWaitTimeout_))
     return;
-  if (result != vk::Result::eSuccess)
-    throw std::runtime_error("Failed to wait for fence in drawFrame()");
 
-  device_.resetFences(renderFinishedFences_[frameIndex]);
+  // GPU time of the frame previously submitted in this slot
+  if (timestampQueryPool_ && timestampWritten_[frameIndex])
+  {
+    std::array<uint64_t, 2> timestamps;
+    const auto queryResult = device_.getQueryPoolResults(timestampQueryPool_, frameIndex * 2, 2,
+      sizeof(timestamps), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (queryResult == vk::Result::eSuccess)
+      frameTimings_.gpuTime = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod_ * 1e-9;
+  }
+
+  const auto allocationCount = getThreadAllocationCount();
+
+  // Uniform region and secondary command buffers of this frame are no longer used by the device
+  uniformAllocator_.beginFrame(frameIndex);
+  parallelRecorder_.beginFrame(frameIndex);
 
-  const auto swapchain = swapchain_.getSwapchain();
-  const auto acquireNextImageResult = device_.acquireNextImageKHR(swapchain, UINT64_MAX, imageAvailableSemaphores_[frameIndex]);
+  auto queueLock = lockSharedQueue();
+  const auto acquireNextImageResult = swapchain_.acquireNextImage(imageAvailableSemaphores_[frameIndex]);
   if (acquireNextImageResult.result == vk::Result::eErrorOutOfDateKHR)
   {
     recreateSwapchain();
@@ -657,21 +914,48 @@ void Engine::drawFrame()
     throw std::runtime_error("Failed to acquire next swapchain image");
 
   const auto imageIndex = acquireNextImageResult.value;
+  if (queueLock)
+    queueLock.unlock();
+
+  // Headset view of the latest vr frame, copied after the vr submission writing it. Released after this frame's submission
+  MirrorView mirrorView;
+  const auto mirrored = desktopMirror_ && vrWorker_.acquireMirror(mirrorView);
+
+  const auto recordStartTime = std::chrono::high_resolution_clock::now();
+
+  // Object and eyes, eyes scaled by sphere size
+  std::array<glm::mat4, 3> models = { objectModel };
+  for (int i = 0; i < 2; i++)
+  {
+    constexpr float scaleLong = 0.05f;
+    constexpr float scaleShort = 0.025f;
+    glm::mat4 scaledModel{ 1.f };
+    scaledModel[0][0] = scaleLong;
+    scaledModel[1][1] = scaleLong;
+    scaledModel[2][2] = scaleShort;
+    models[1 + i] = eyePoses[i] * scaledModel;
+  }
 
   // Update uniform
-  renderer_.updateDescriptorSet(imageIndex);
+  const auto dynamicOffsets = renderer_.updateUniforms(models);
 
   // Draw command
-  auto drawCommandBuffer = drawCommandBuffers_[imageIndex];
+  auto drawCommandBuffer = drawCommandBuffers_[frameIndex];
   drawCommandBuffer.reset();
   drawCommandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
 
+  if (timestampQueryPool_)
+  {
+    drawCommandBuffer.resetQueryPool(timestampQueryPool_, frameIndex * 2, 2);
+    drawCommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool_, frameIndex * 2);
+  }
+
   const auto framebuffer = framebuffer_.getFramebuffers()[imageIndex];
 
   vk::Rect2D renderArea{ {0u, 0u}, {width_, height_} };
 
   std::array<float, 4> clearColor = { 0.75f, 0.75f, 0.75f, 1.f };
-  std::vector<vk::ClearValue> clearValues = {
+  const std::array<vk::ClearValue, 2> clearValues = {
     vk::ClearColorValue{clearColor},
     vk::ClearDepthStencilValue{1.f, 0u},
   };
@@ -682,98 +966,157 @@ void Engine::drawFrame()
     .setRenderArea(renderArea)
     .setRenderPass(renderPass_)
     .setFramebuffer(framebuffer);
-  drawCommandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-
-  // TODO: bind pipeline via renderer
-  drawCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderer_.getPipeline());
-
-  vk::Viewport viewport{ 0.f, 0.f, static_cast<float>(width_), static_cast<float>(height_), 0.f, 1.f };
-
-  drawCommandBuffer.setViewport(0, viewport);
-  drawCommandBuffer.setScissor(0, renderArea);
-
-  drawCommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-    renderer_.getPipelineLayout(), 0,
-    renderer_.getDescriptorSets()[imageIndex], {});
-
-  drawMesh(drawCommandBuffer, renderer_.getPipelineLayout(), objectModel);
-
-  // Eyes: scale by sphere size
-  for (int i = 0; i < 2; i++)
+  if (mirrored)
+    recordMirror(drawCommandBuffer, mirrorView.image, imageIndex);
+  else
   {
-    constexpr float scaleLong = 0.05f;
-    constexpr float scaleShort = 0.025f;
-    glm::mat4 scaledModel{ 1.f };
-    scaledModel[0][0] = scaleLong;
-    scaledModel[1][1] = scaleLong;
-    scaledModel[2][2] = scaleShort;
-    scaledModel = eyePoses[i] * scaledModel;
-
-    drawMesh(drawCommandBuffer, renderer_.getPipelineLayout(), scaledModel);
+    drawCommandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+
+    vk::Viewport viewport{ 0.f, 0.f, static_cast<float>(width_), static_cast<float>(height_), 0.f, 1.f };
+
+    // Instances split into chunks, recorded in parallel to secondary command buffers
+    vk::CommandBufferInheritanceInfo inheritanceInfo;
+    inheritanceInfo
+      .setRenderPass(renderPass_)
+      .setSubpass(0)
+      .setFramebuffer(framebuffer);
+
+    const auto instanceCount = static_cast<uint32_t>(models.size());
+    const auto chunkCount = parallelRecorder_.getChunkCount(instanceCount);
+    const auto& secondaryCommandBuffers = parallelRecorder_.record(inheritanceInfo, chunkCount,
+      [&](vk::CommandBuffer commandBuffer, uint32_t chunkIndex)
+      {
+        // TODO: bind pipeline via renderer
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderer_.getPipeline());
+
+        commandBuffer.setViewport(0, viewport);
+        commandBuffer.setScissor(0, renderArea);
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+          renderer_.getPipelineLayout(), 0,
+          renderer_.getDescriptorSet(), dynamicOffsets);
+
+        const auto firstInstance = instanceCount * chunkIndex / chunkCount;
+        const auto lastInstance = instanceCount * (chunkIndex + 1) / chunkCount;
+        drawMesh(commandBuffer, lastInstance - firstInstance, firstInstance);
+      });
+    drawCommandBuffer.executeCommands(secondaryCommandBuffers);
+
+    drawCommandBuffer.endRenderPass();
   }
 
-  drawCommandBuffer.endRenderPass();
+  if (timestampQueryPool_)
+  {
+    drawCommandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool_, frameIndex * 2 + 1);
+    timestampWritten_[frameIndex] = true;
+  }
 
   drawCommandBuffer.end();
 
-  std::vector<vk::Semaphore> waitSemaphores = {
+  frameTimings_.recordTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - recordStartTime).count();
+
+  // The vr timeline semaphore only when mirrored
+  const auto waitSemaphoreCount = mirrored ? 2u : 1u;
+  const std::array<vk::Semaphore, 2> waitSemaphores = {
     imageAvailableSemaphores_[frameIndex],
+    mirrorView.semaphore,
   };
-  std::vector<vk::PipelineStageFlags> waitMasks = {
-    vk::PipelineStageFlagBits::eColorAttachmentOutput
+  const std::array<vk::PipelineStageFlags, 2> waitMasks = {
+    mirrored ? vk::PipelineStageFlagBits::eTransfer : vk::PipelineStageFlagBits::eColorAttachmentOutput,
+    vk::PipelineStageFlagBits::eTransfer,
+  };
+
+  // Binary semaphore for presentation, and the frame number on the timeline. Values of binary semaphores are ignored
+  const std::array<vk::Semaphore, 2> signalSemaphores = {
+    renderFinishedSemaphores_[imageIndex],
+    frameScheduler_.getSemaphore(),
   };
+  const auto frameNumber = frameScheduler_.getFrameNumber();
+  const std::array<uint64_t, 2> waitValues = { 0, mirrorView.value };
+  const std::array<uint64_t, 2> signalValues = { 0, frameNumber };
+
+  vk::TimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo;
+  timelineSemaphoreSubmitInfo
+    .setWaitSemaphoreValueCount(waitSemaphoreCount)
+    .setPWaitSemaphoreValues(waitValues.data())
+    .setSignalSemaphoreValues(signalValues);
 
   vk::SubmitInfo submitInfo;
   submitInfo
-    .setWaitSemaphores(waitSemaphores)
-    .setWaitDstStageMask(waitMasks)
+    .setWaitSemaphoreCount(waitSemaphoreCount)
+    .setPWaitSemaphores(waitSemaphores.data())
+    .setPWaitDstStageMask(waitMasks.data())
     .setCommandBuffers(drawCommandBuffer)
-    .setSignalSemaphores(renderFinishedSemaphores_[imageIndex]);
-  queue_.submit(submitInfo, renderFinishedFences_[frameIndex]);
+    .setSignalSemaphores(signalSemaphores)
+    .setPNext(&timelineSemaphoreSubmitInfo);
+
+  queueLock = lockSharedQueue();
+  queue_.submit(submitInfo);
+  frameScheduler_.endFrame();
+
+  if (mirrored)
+    vrWorker_.releaseMirror(frameNumber);
 
   // Present
-  vk::PresentInfoKHR presentInfo;
-  presentInfo
-    .setWaitSemaphores(renderFinishedSemaphores_[imageIndex])
-    .setSwapchains(swapchain)
-    .setImageIndices(imageIndex);
-  const auto presentResult = presentQueue_.presentKHR(presentInfo);
+  const auto presentResult = swapchain_.present(presentQueue_, renderFinishedSemaphores_[imageIndex], imageIndex);
 
   if (presentResult == vk::Result::eErrorOutOfDateKHR || presentResult == vk::Result::eSuboptimalKHR)
     recreateSwapchain();
   else if (presentResult != vk::Result::eSuccess)
     throw std::runtime_error("Failed to present swapchain image");
 
-  frameIndex_++;
+  frameTimings_.heapAllocations = getThreadAllocationCount() - allocationCount;
 }
 
 glm::quat Engine::getObjectOrientation()
 {
-  std::lock_guard<std::mutex> guard{ objectOrientationMutex_ };
-  return objectOrientation_;
+  return objectOrientation_.read();
 }
 
 void Engine::setObjectOrientation(const glm::quat& objectOrientation)
 {
-  std::lock_guard<std::mutex> guard{ objectOrientationMutex_ };
-  objectOrientation_ = objectOrientation;
+  objectOrientation_.write(objectOrientation);
 }
 
-void Engine::drawMesh(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, const glm::mat4& model)
+void Engine::recordMirror(vk::CommandBuffer commandBuffer, vk::Image mirrorImage, uint32_t imageIndex)
 {
-  std::array<float, 16> modelArray;
-  std::memcpy(&modelArray, glm::value_ptr(model), sizeof(modelArray));
-
-  glm::mat4 modelInverseTranspose = glm::transpose(glm::inverse(model));
-  std::array<float, 16> modelInverseTransposeArray;
-  std::memcpy(&modelInverseTransposeArray, glm::value_ptr(modelInverseTranspose), sizeof(modelInverseTransposeArray));
+  const auto image = swapchain_.getImages()[imageIndex];
 
-  commandBuffer.pushConstants<float>(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, modelArray);
-  commandBuffer.pushConstants<float>(pipelineLayout, vk::ShaderStageFlagBits::eVertex, sizeof(modelArray), modelInverseTransposeArray);
+  vk::ImageMemoryBarrier barrier;
+  barrier
+    .setImage(image)
+    .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 })
+    .setOldLayout(vk::ImageLayout::eUndefined)
+    .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+    .setSrcAccessMask({})
+    .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+    {}, {}, {}, barrier);
+
+  // Same extent, written by a vr submission the frame's submission waits for
+  vk::ImageCopy region;
+  region
+    .setSrcSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+    .setDstSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+    .setExtent({ width_, height_, 1 });
+  commandBuffer.copyImage(mirrorImage, vk::ImageLayout::eGeneral, image, vk::ImageLayout::eTransferDstOptimal, region);
+
+  barrier
+    .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+    .setNewLayout(swapchain_.getFinalLayout())
+    .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+    .setDstAccessMask({});
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+    {}, {}, {}, barrier);
+}
 
+void Engine::drawMesh(vk::CommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
+{
   commandBuffer.bindVertexBuffers(0, { meshBuffer_ }, { 0 });
   commandBuffer.bindIndexBuffer(meshBuffer_, meshIndexOffset_, vk::IndexType::eUint32);
-  commandBuffer.drawIndexed(meshIndexCount_, 1, 0, 0, 0);
+  commandBuffer.drawIndexed(meshIndexCount_, instanceCount, 0, 0, firstInstance);
 }
 }
 }
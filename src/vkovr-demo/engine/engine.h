@@ -7,13 +7,20 @@
 
 #include <vkovr/vkovr.hpp>
 
+#include <vkovr-demo/engine/job_system.h>
 #include <vkovr-demo/engine/memory_pool.h>
+#include <vkovr-demo/engine/uploader.h>
+#include <vkovr-demo/engine/uniform_allocator.h>
+#include <vkovr-demo/engine/pipeline_cache.h>
+#include <vkovr-demo/engine/parallel_recorder.h>
+#include <vkovr-demo/engine/frame_scheduler.h>
 #include <vkovr-demo/engine/swapchain.h>
 #include <vkovr-demo/engine/render_pass.h>
 #include <vkovr-demo/engine/framebuffer.h>
 #include <vkovr-demo/engine/renderer.h>
 #include <vkovr-demo/engine/texture.h>
 #include <vkovr-demo/engine/sampler.h>
+#include <vkovr-demo/engine/triple_buffer.h>
 #include <vkovr-demo/engine/ubo/light_ubo.h>
 #include <vkovr-demo/engine/vr_worker.h>
 #include <vkovr-demo/scene/mesh.h>
@@ -27,11 +34,26 @@ namespace engine
 struct CameraUbo;
 struct LightUbo;
 
+struct FrameTimings
+{
+  // Seconds spent recording the desktop command buffer
+  double recordTime = 0.;
+
+  // Seconds between the first and the last timestamp of the most recently completed desktop frame
+  double gpuTime = 0.;
+
+  // Global heap allocations of the last desktop frame, if the allocation counter is enabled
+  uint64_t heapAllocations = 0;
+};
+
 class Engine
 {
 public:
   Engine() = delete;
-  Engine(GLFWwindow* window, uint32_t width, uint32_t height);
+  // Null window renders to offscreen images without a surface.
+  // Shaders are loaded from shaderDirectory if not empty, otherwise the ones compiled into the binary are used.
+  // Desktop and VR frames in flight, 1 to 4
+  Engine(GLFWwindow* window, uint32_t width, uint32_t height, const std::string& shaderDirectory = "", uint32_t framesInFlight = 3);
   ~Engine();
 
   void resize(uint32_t width, uint32_t height);
@@ -39,14 +61,23 @@ public:
   void updateCamera(const CameraUbo& camera);
   void updateLight(const LightUbo& light);
 
+  // Read by the desktop thread, written by the vr thread
   glm::quat getObjectOrientation();
   void setObjectOrientation(const glm::quat& objectOrientation);
 
-  void startVr();
+  void startVr(std::shared_ptr<vkovr::Backend> backend = nullptr);
   void terminateVr();
 
+  // While VR renders, the desktop shows the headset view with a blit instead of drawing the scene again
+  void setDesktopMirror(bool desktopMirror) { desktopMirror_ = desktopMirror; }
+
   void drawFrame();
 
+  auto getFrameTimings() const { return frameTimings_; }
+
+  // Worker threads shared by desktop and vr rendering
+  auto getJobSystem() const { return jobSystem_; }
+
 private:
   void createInstance(GLFWwindow* window);
   void destroyInstance();
@@ -78,13 +109,24 @@ private:
   void createSynchronizationObjects();
   void destroySynchronizationObjects();
 
+  void createQueryPool();
+  void destroyQueryPool();
+
+  // Locks queue mutex only when the desktop and vr threads share a queue
+  std::unique_lock<std::mutex> lockSharedQueue();
+
   void recreateSwapchain();
 
-  void drawMesh(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, const glm::mat4& model);
+  // Copies the headset view to the swapchain image, left in its final layout
+  void recordMirror(vk::CommandBuffer commandBuffer, vk::Image mirrorImage, uint32_t imageIndex);
+
+  // Instances read model matrices written with Renderer::updateUniforms()
+  void drawMesh(vk::CommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance);
 
 private:
   uint32_t width_ = 0;
   uint32_t height_ = 0;
+  std::string shaderDirectory_;
 
   // Vr worker
   VrWorker vrWorker_;
@@ -101,14 +143,26 @@ private:
   vk::Queue queue_;
   vk::Queue vrQueue_;
   vk::Queue presentQueue_;
+  uint32_t transferQueueIndex_ = 0;
+  vk::Queue transferQueue_;
+  std::mutex queueMutex_;
+  bool multiview_ = false;
+  bool fragmentDensityMap_ = false;
+  bool depthResolve_ = false;
+  bool memoryBudget_ = false;
 
   vk::DeviceSize ssboAlignment_ = 0;
   vk::DeviceSize uboAlignment_ = 0;
 
   // Pools
+  JobSystem jobSystem_;
   vk::CommandPool commandPool_;
   vk::DescriptorPool descriptorPool_;
   MemoryPool memoryPool_;
+  Uploader uploader_;
+  UniformAllocator uniformAllocator_;
+  PipelineCache pipelineCache_;
+  ParallelRecorder parallelRecorder_;
 
   // Swapchain
   Swapchain swapchain_;
@@ -123,32 +177,38 @@ private:
   // Meshes
   std::unique_ptr<scene::Mesh> mesh_;
   vk::Buffer meshBuffer_;
+  MemoryPool::Memory meshMemory_;
   vk::DeviceSize meshIndexOffset_ = 0;
   uint32_t meshIndexCount_ = 0;
 
   // VR object orientation
-  std::mutex objectOrientationMutex_;
-  glm::quat objectOrientation_{ 1.f, 0.f, 0.f, 0.f };
+  TripleBuffer<glm::quat> objectOrientation_{ glm::quat{ 1.f, 0.f, 0.f, 0.f } };
 
   // Texture
   Texture texture_;
   uint32_t mipLevel_ = 3;
   Sampler sampler_;
 
-  // Staging buffer
-  vk::Buffer stagingBuffer_;
+  // Headset views written by the vr thread in general layout, of the window size
+  bool desktopMirror_ = true;
+  std::array<vk::Image, 3> mirrorImages_;
+  std::array<MemoryPool::Memory, 3> mirrorMemories_;
 
   // Command buffers
-  vk::CommandBuffer transferCommandBuffer_;
   std::vector<vk::CommandBuffer> drawCommandBuffers_;
 
   // Synchronization
+  uint32_t framesInFlight_ = 3;
+  FrameScheduler frameScheduler_;
+  std::chrono::milliseconds frameWaitTimeout_{ 10 };
   std::vector<vk::Semaphore> imageAvailableSemaphores_;
   std::vector<vk::Semaphore> renderFinishedSemaphores_;
-  std::vector<vk::Fence> renderFinishedFences_;
 
-  // Frame index
-  uint64_t frameIndex_ = 0;
+  // Frame timings
+  vk::QueryPool timestampQueryPool_;
+  float timestampPeriod_ = 0.f;
+  std::vector<bool> timestampWritten_;
+  FrameTimings frameTimings_;
 };
 }
 }
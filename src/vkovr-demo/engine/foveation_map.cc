@@ -0,0 +1,210 @@
+#include <vkovr-demo/engine/foveation_map.h>
+
+#include <array>
+#include <algorithm>
+
+namespace demo
+{
+namespace engine
+{
+namespace
+{
+// Horizontal and vertical fragment density as R8G8 unorm, 255 shades every pixel and 128 every other
+using Density = std::array<uint8_t, 2>;
+
+struct Ring
+{
+  // Distance from the center in normalized viewport coordinates
+  float radius;
+  Density density;
+};
+
+// Density at a distance from the center, outside of all rings the last ring's
+Density getDensity(FoveationLevel level, float distance)
+{
+  constexpr Density full{ 255, 255 };
+
+  static const std::vector<Ring> lowRings = {
+    { 0.35f, full },
+    { 0.f, { 128, 255 } },
+  };
+  static const std::vector<Ring> mediumRings = {
+    { 0.3f, full },
+    { 0.45f, { 128, 255 } },
+    { 0.f, { 128, 128 } },
+  };
+  static const std::vector<Ring> highRings = {
+    { 0.25f, full },
+    { 0.4f, { 128, 128 } },
+    { 0.f, { 64, 128 } },
+  };
+
+  const std::vector<Ring>* rings = nullptr;
+  switch (level)
+  {
+  case FoveationLevel::Low: rings = &lowRings; break;
+  case FoveationLevel::Medium: rings = &mediumRings; break;
+  case FoveationLevel::High: rings = &highRings; break;
+  default: return full;
+  }
+
+  for (int i = 0; i + 1 < rings->size(); i++)
+  {
+    if (distance < (*rings)[i].radius)
+      return (*rings)[i].density;
+  }
+  return rings->back().density;
+}
+}
+
+FoveationMap createFoveationMap(const FoveationMapCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  const auto physicalDevice = createInfo.physicalDevice;
+  const auto memoryPool = createInfo.pMemoryPool;
+  const auto layerCount = createInfo.layerCount;
+  const auto frameCount = createInfo.frameCount;
+
+  // The implementation picks a texel size up to the maximum, the smallest map covering the framebuffer with it
+  const auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceFragmentDensityMapPropertiesEXT>();
+  const auto maxTexelSize = properties.get<vk::PhysicalDeviceFragmentDensityMapPropertiesEXT>().maxFragmentDensityTexelSize;
+  const vk::Extent2D texelSize{ std::max(maxTexelSize.width, 1u), std::max(maxTexelSize.height, 1u) };
+  const vk::Extent2D extent{
+    (createInfo.width + texelSize.width - 1) / texelSize.width,
+    (createInfo.height + texelSize.height - 1) / texelSize.height,
+  };
+
+  constexpr auto format = vk::Format::eR8G8Unorm;
+
+  vk::ImageCreateInfo imageCreateInfo;
+  imageCreateInfo
+    .setImageType(vk::ImageType::e2D)
+    .setFormat(format)
+    .setExtent({ extent.width, extent.height, 1 })
+    .setMipLevels(1)
+    .setArrayLayers(layerCount)
+    .setSamples(vk::SampleCountFlagBits::e1)
+    .setTiling(vk::ImageTiling::eOptimal)
+    .setUsage(vk::ImageUsageFlagBits::eFragmentDensityMapEXT | vk::ImageUsageFlagBits::eTransferDst)
+    .setSharingMode(vk::SharingMode::eExclusive)
+    .setInitialLayout(vk::ImageLayout::eUndefined);
+  const auto image = device.createImage(imageCreateInfo);
+
+  const auto memory = memoryPool->allocateDeviceMemory(image);
+  device.bindImageMemory(image, memory.memory, memory.offset);
+
+  vk::ImageViewCreateInfo imageViewCreateInfo;
+  imageViewCreateInfo
+    .setViewType(layerCount == 1 ? vk::ImageViewType::e2D : vk::ImageViewType::e2DArray)
+    .setImage(image)
+    .setFormat(format)
+    .setComponents({})
+    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, layerCount });
+  const auto imageView = device.createImageView(imageViewCreateInfo);
+
+  vk::BufferCreateInfo bufferCreateInfo;
+  bufferCreateInfo
+    .setUsage(vk::BufferUsageFlagBits::eTransferSrc)
+    .setSize(static_cast<vk::DeviceSize>(extent.width) * extent.height * layerCount * sizeof(Density) * frameCount);
+  const auto stagingBuffer = device.createBuffer(bufferCreateInfo);
+
+  const auto stagingMemory = memoryPool->allocatePersistentlyMappedMemory(stagingBuffer);
+  device.bindBufferMemory(stagingBuffer, stagingMemory.memory, stagingMemory.offset);
+
+  FoveationMap foveationMap;
+  foveationMap.device_ = device;
+  foveationMap.pMemoryPool_ = memoryPool;
+  foveationMap.level_ = createInfo.level;
+  foveationMap.texelSize_ = texelSize;
+  foveationMap.extent_ = extent;
+  foveationMap.layerCount_ = layerCount;
+  foveationMap.image_ = image;
+  foveationMap.imageView_ = imageView;
+  foveationMap.memory_ = memory;
+  foveationMap.stagingBuffer_ = stagingBuffer;
+  foveationMap.stagingMemory_ = stagingMemory;
+  return foveationMap;
+}
+
+FoveationMap::FoveationMap()
+{
+}
+
+FoveationMap::~FoveationMap()
+{
+}
+
+void FoveationMap::update(vk::CommandBuffer commandBuffer, uint32_t frameIndex, vk::ArrayProxy<const glm::vec2> centers, float viewportScale)
+{
+  const auto centersWritten = std::equal(centers.begin(), centers.end(), writtenCenters_.begin(), writtenCenters_.end());
+  if (written_ && level_ == writtenLevel_ && centersWritten && viewportScale == writtenViewportScale_)
+    return;
+
+  // Region of the frame, whose previous copy has completed
+  const auto texelCount = static_cast<vk::DeviceSize>(extent_.width) * extent_.height;
+  const auto stagingOffset = texelCount * layerCount_ * sizeof(Density) * frameIndex;
+  auto texels = reinterpret_cast<Density*>(stagingMemory_.map + stagingOffset);
+
+  // Distance in normalized coordinates of the scaled viewport
+  const glm::vec2 viewportSize{ texelSize_.width * extent_.width * viewportScale, texelSize_.height * extent_.height * viewportScale };
+  for (uint32_t layer = 0; layer < layerCount_; layer++)
+  {
+    const auto center = layer < centers.size() ? centers.data()[layer] : glm::vec2{ 0.5f, 0.5f };
+    for (uint32_t y = 0; y < extent_.height; y++)
+    {
+      for (uint32_t x = 0; x < extent_.width; x++)
+      {
+        const glm::vec2 pixel{ (x + 0.5f) * texelSize_.width, (y + 0.5f) * texelSize_.height };
+        const auto distance = glm::length(pixel / viewportSize - center);
+        *texels++ = getDensity(level_, distance);
+      }
+    }
+  }
+
+  // The render pass of the previous frame only reads the map
+  vk::ImageMemoryBarrier barrier;
+  barrier
+    .setImage(image_)
+    .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, layerCount_ })
+    .setOldLayout(written_ ? vk::ImageLayout::eFragmentDensityMapOptimalEXT : vk::ImageLayout::eUndefined)
+    .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+    .setSrcAccessMask({})
+    .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+  commandBuffer.pipelineBarrier(
+    written_ ? vk::PipelineStageFlagBits::eFragmentDensityProcessEXT : vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+    {}, {}, {}, barrier);
+
+  vk::BufferImageCopy region;
+  region
+    .setBufferOffset(stagingOffset)
+    .setImageSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, layerCount_ })
+    .setImageExtent({ extent_.width, extent_.height, 1 });
+  commandBuffer.copyBufferToImage(stagingBuffer_, image_, vk::ImageLayout::eTransferDstOptimal, region);
+
+  barrier
+    .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+    .setNewLayout(vk::ImageLayout::eFragmentDensityMapOptimalEXT)
+    .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+    .setDstAccessMask(vk::AccessFlagBits::eFragmentDensityMapReadEXT);
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentDensityProcessEXT,
+    {}, {}, {}, barrier);
+
+  written_ = true;
+  writtenLevel_ = level_;
+  writtenCenters_.assign(centers.begin(), centers.end());
+  writtenViewportScale_ = viewportScale;
+}
+
+void FoveationMap::destroy()
+{
+  device_.destroyImageView(imageView_);
+  device_.destroyImage(image_);
+  pMemoryPool_->free(memory_);
+
+  device_.destroyBuffer(stagingBuffer_);
+  pMemoryPool_->free(stagingMemory_);
+}
+}
+}
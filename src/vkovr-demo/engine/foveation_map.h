@@ -0,0 +1,108 @@
+#ifndef VKOVR_DEMO_ENGINE_FOVEATION_MAP_H_
+#define VKOVR_DEMO_ENGINE_FOVEATION_MAP_H_
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <glm/glm.hpp>
+
+#include <vkovr-demo/engine/memory_pool.h>
+
+namespace demo
+{
+namespace engine
+{
+class FoveationMap;
+class FoveationMapCreateInfo;
+
+FoveationMap createFoveationMap(const FoveationMapCreateInfo& createInfo);
+
+// Fragment density away from the foveation center, lowest to highest savings
+enum class FoveationLevel
+{
+  Off,
+  Low,
+  Medium,
+  High,
+};
+
+// Gaze of an eye tracker. Called by the VR thread once per frame
+class GazeSource
+{
+public:
+  virtual ~GazeSource() = default;
+
+  // Normalized image coordinates of the eye's view. False while unknown, foveation then centers on the lens
+  virtual bool getGazePoint(uint32_t eye, glm::vec2& point) = 0;
+};
+
+// Fragment density map of a render pass, VK_EXT_fragment_density_map.
+// Full density around a center per view, in rings of lower density towards the edges of the lens
+class FoveationMap
+{
+  friend FoveationMap createFoveationMap(const FoveationMapCreateInfo& createInfo);
+
+public:
+  FoveationMap();
+  ~FoveationMap();
+
+  auto getImageView() const { return imageView_; }
+  auto getLevel() const { return level_; }
+
+  void setLevel(FoveationLevel level) { level_ = level; }
+
+  // Records the copy of the map to a command buffer outside of render passes if the level, centers or scale changed.
+  // Centers per layer in normalized coordinates of the viewport, which covers a scaled part of the framebuffer
+  void update(vk::CommandBuffer commandBuffer, uint32_t frameIndex, vk::ArrayProxy<const glm::vec2> centers, float viewportScale);
+
+  void destroy();
+
+private:
+  vk::Device device_;
+  MemoryPool* pMemoryPool_ = nullptr;
+
+  FoveationLevel level_ = FoveationLevel::Medium;
+
+  // Framebuffer pixels per density texel
+  vk::Extent2D texelSize_;
+  vk::Extent2D extent_;
+  uint32_t layerCount_ = 1;
+  vk::Image image_;
+  vk::ImageView imageView_;
+  MemoryPool::Memory memory_;
+
+  // Staging region per frame in flight
+  vk::Buffer stagingBuffer_;
+  MemoryPool::MappedMemory stagingMemory_;
+
+  // Inputs of the last written map
+  bool written_ = false;
+  FoveationLevel writtenLevel_ = FoveationLevel::Off;
+  std::vector<glm::vec2> writtenCenters_;
+  float writtenViewportScale_ = 0.f;
+};
+
+class FoveationMapCreateInfo
+{
+public:
+  vk::Device device;
+  vk::PhysicalDevice physicalDevice;
+  MemoryPool* pMemoryPool = nullptr;
+
+  // Framebuffer extent
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  // Views of the render pass, a layer each
+  uint32_t layerCount = 1;
+
+  // Frames in flight
+  uint32_t frameCount = 3;
+
+  FoveationLevel level = FoveationLevel::Medium;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_FOVEATION_MAP_H_
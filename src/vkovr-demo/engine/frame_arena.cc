@@ -0,0 +1,38 @@
+#include <vkovr-demo/engine/frame_arena.h>
+
+namespace demo
+{
+namespace engine
+{
+FrameArena createFrameArena(const FrameArenaCreateInfo& createInfo)
+{
+  auto buffer = std::make_unique<std::byte[]>(createInfo.size);
+  auto resource = std::make_unique<std::pmr::monotonic_buffer_resource>(buffer.get(), createInfo.size, std::pmr::new_delete_resource());
+
+  FrameArena frameArena;
+  frameArena.buffer_ = std::move(buffer);
+  frameArena.resource_ = std::move(resource);
+  return frameArena;
+}
+
+FrameArena::FrameArena()
+{
+}
+
+FrameArena::~FrameArena()
+{
+}
+
+void FrameArena::beginFrame()
+{
+  // Back to the start of the buffer, returning overflow to the heap
+  resource_->release();
+}
+
+void FrameArena::destroy()
+{
+  resource_ = nullptr;
+  buffer_ = nullptr;
+}
+}
+}
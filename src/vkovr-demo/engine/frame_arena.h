@@ -0,0 +1,49 @@
+#ifndef VKOVR_DEMO_ENGINE_FRAME_ARENA_H_
+#define VKOVR_DEMO_ENGINE_FRAME_ARENA_H_
+
+#include <memory>
+#include <memory_resource>
+
+namespace demo
+{
+namespace engine
+{
+class FrameArena;
+class FrameArenaCreateInfo;
+
+FrameArena createFrameArena(const FrameArenaCreateInfo& createInfo);
+
+// Linear allocator for temporaries of a frame on one thread, e.g. std::pmr::vector<glm::mat4>{ arena.getResource() }.
+// Allocations bump a pointer in a fixed buffer and are released all at once when the next frame begins
+class FrameArena
+{
+  friend FrameArena createFrameArena(const FrameArenaCreateInfo& createInfo);
+
+public:
+  FrameArena();
+  ~FrameArena();
+
+  // Temporaries of the previous frame must no longer be used
+  void beginFrame();
+
+  std::pmr::memory_resource* getResource() const { return resource_.get(); }
+
+  void destroy();
+
+private:
+  std::unique_ptr<std::byte[]> buffer_;
+
+  // Falls back to the heap when the buffer is exhausted, counted by the allocation counter
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> resource_;
+};
+
+class FrameArenaCreateInfo
+{
+public:
+  // Bytes
+  size_t size = 64 * 1024;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_FRAME_ARENA_H_
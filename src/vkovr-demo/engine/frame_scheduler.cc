@@ -0,0 +1,84 @@
+#include <vkovr-demo/engine/frame_scheduler.h>
+
+namespace demo
+{
+namespace engine
+{
+FrameScheduler createFrameScheduler(const FrameSchedulerCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  const auto frameCount = createInfo.frameCount;
+
+  if (frameCount < 1 || frameCount > 4)
+    throw std::runtime_error("Failed to create frame scheduler, frame count must be 1 to 4");
+
+  vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo;
+  semaphoreTypeCreateInfo
+    .setSemaphoreType(vk::SemaphoreType::eTimeline)
+    .setInitialValue(0);
+
+  vk::SemaphoreCreateInfo semaphoreCreateInfo;
+  semaphoreCreateInfo
+    .setPNext(&semaphoreTypeCreateInfo);
+  const auto semaphore = device.createSemaphore(semaphoreCreateInfo);
+
+  FrameScheduler frameScheduler;
+  frameScheduler.device_ = device;
+  frameScheduler.frameCount_ = frameCount;
+  frameScheduler.semaphore_ = semaphore;
+  return frameScheduler;
+}
+
+FrameScheduler::FrameScheduler()
+{
+}
+
+FrameScheduler::~FrameScheduler()
+{
+}
+
+bool FrameScheduler::waitForFrame(uint64_t timeout) const
+{
+  // The frame frameCount before the one being recorded used the same slot
+  if (frameNumber_ < frameCount_)
+    return true;
+  return wait(frameNumber_ + 1 - frameCount_, timeout);
+}
+
+bool FrameScheduler::waitForFrameUntil(Clock::time_point deadline) const
+{
+  const auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+  return waitForFrame(timeout > 0 ? static_cast<uint64_t>(timeout) : 0);
+}
+
+uint64_t FrameScheduler::getRetiredFrameNumber() const
+{
+  return device_.getSemaphoreCounterValue(semaphore_);
+}
+
+void FrameScheduler::waitIdle() const
+{
+  wait(frameNumber_, UINT64_MAX);
+}
+
+void FrameScheduler::destroy()
+{
+  device_.destroySemaphore(semaphore_);
+  semaphore_ = nullptr;
+}
+
+bool FrameScheduler::wait(uint64_t frameNumber, uint64_t timeout) const
+{
+  vk::SemaphoreWaitInfo waitInfo;
+  waitInfo
+    .setSemaphores(semaphore_)
+    .setValues(frameNumber);
+  const auto result = device_.waitSemaphores(waitInfo, timeout);
+  if (result == vk::Result::eTimeout)
+    return false;
+  if (result != vk::Result::eSuccess)
+    throw std::runtime_error("Failed to wait for frame");
+  return true;
+}
+}
+}
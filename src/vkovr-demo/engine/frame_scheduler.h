@@ -0,0 +1,79 @@
+#ifndef VKOVR_DEMO_ENGINE_FRAME_SCHEDULER_H_
+#define VKOVR_DEMO_ENGINE_FRAME_SCHEDULER_H_
+
+#include <chrono>
+
+#include <vulkan/vulkan.hpp>
+
+namespace demo
+{
+namespace engine
+{
+class FrameScheduler;
+class FrameSchedulerCreateInfo;
+
+FrameScheduler createFrameScheduler(const FrameSchedulerCreateInfo& createInfo);
+
+// Frames in flight of a render loop, tracked by a timeline semaphore the submission of each frame signals with its frame number.
+// A frame reuses the per-frame resources of the slot, e.g. command buffers and uniform regions, once the frame
+// frameCount before it has retired
+class FrameScheduler
+{
+  friend FrameScheduler createFrameScheduler(const FrameSchedulerCreateInfo& createInfo);
+
+public:
+  using Clock = std::chrono::steady_clock;
+
+public:
+  FrameScheduler();
+  ~FrameScheduler();
+
+  auto getFrameCount() const { return frameCount_; }
+  auto getSemaphore() const { return semaphore_; }
+
+  // Slot of per-frame resources of the frame being recorded
+  uint32_t getFrameIndex() const { return static_cast<uint32_t>(frameNumber_ % frameCount_); }
+
+  // Value the submission of the frame being recorded signals
+  uint64_t getFrameNumber() const { return frameNumber_ + 1; }
+
+  // Waits until the slot of the frame being recorded is retired. False on timeout, in nanoseconds
+  bool waitForFrame(uint64_t timeout = UINT64_MAX) const;
+  bool waitForFrameUntil(Clock::time_point deadline) const;
+
+  // Frame number of the latest frame completed by the device, any resource last used by it or before may be reused
+  uint64_t getRetiredFrameNumber() const;
+  bool isRetired(uint64_t frameNumber) const { return getRetiredFrameNumber() >= frameNumber; }
+
+  // After the frame's submission, or skipping a frame not submitted keeps its number and slot
+  void endFrame() { frameNumber_++; }
+
+  // Waits for all frames submitted
+  void waitIdle() const;
+
+  void destroy();
+
+private:
+  bool wait(uint64_t frameNumber, uint64_t timeout) const;
+
+  vk::Device device_;
+  uint32_t frameCount_ = 3;
+  vk::Semaphore semaphore_;
+
+  // Frames submitted
+  uint64_t frameNumber_ = 0;
+};
+
+class FrameSchedulerCreateInfo
+{
+public:
+  // Requires the timelineSemaphore device feature enabled
+  vk::Device device;
+
+  // Frames in flight, 1 to 4. More frames hide CPU spikes, fewer keep input latency low
+  uint32_t frameCount = 3;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_FRAME_SCHEDULER_H_
@@ -1,6 +1,5 @@
 #include <vkovr-demo/engine/framebuffer.h>
 
-#include <vkovr-demo/engine/memory_pool.h>
 #include <vkovr-demo/engine/render_pass.h>
 
 namespace demo
@@ -14,6 +13,8 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
   const auto imageFormat = renderPass.getFormat();
   const auto depthFormat = renderPass.getDepthFormat();
   const auto samples = renderPass.getSamples();
+  const auto viewCount = renderPass.getViewCount();
+  const auto viewType = viewCount == 1 ? vk::ImageViewType::e2D : vk::ImageViewType::e2DArray;
   const auto& colorImageViews = createInfo.colorImageViews;
   const auto& depthImageViews = createInfo.depthImageViews;
   const auto imageCount = colorImageViews.size();
@@ -28,8 +29,10 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
   // Transient render targets
   vk::Image colorImage;
   vk::ImageView colorImageView;
+  MemoryPool::Memory colorMemory;
   vk::Image depthImage;
   vk::ImageView depthImageView;
+  MemoryPool::Memory depthMemory;
   if (multisampling)
   {
     vk::ImageCreateInfo imageCreateInfo;
@@ -38,14 +41,14 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
       .setFormat(imageFormat)
       .setExtent(vk::Extent3D{ maxWidth, maxHeight, 1 })
       .setMipLevels(1)
-      .setArrayLayers(1)
+      .setArrayLayers(viewCount)
       .setSamples(samples)
       .setTiling(vk::ImageTiling::eOptimal)
       .setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransientAttachment)
       .setSharingMode(vk::SharingMode::eExclusive)
       .setInitialLayout(vk::ImageLayout::eUndefined);
     const auto tempColorImage = device.createImage(imageCreateInfo);
-    const auto colorMemory = memoryPool.allocateDeviceMemory(tempColorImage);
+    colorMemory = memoryPool.allocateDeviceMemory(tempColorImage);
     device.destroyImage(tempColorImage);
 
     imageCreateInfo
@@ -56,9 +59,9 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
     vk::ImageViewCreateInfo imageViewCreateInfo;
     imageViewCreateInfo
       .setImage(colorImage)
-      .setViewType(vk::ImageViewType::e2D)
+      .setViewType(viewType)
       .setFormat(imageFormat)
-      .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
+      .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, viewCount });
     colorImageView = device.createImageView(imageViewCreateInfo);
 
     imageCreateInfo
@@ -66,14 +69,14 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
       .setFormat(depthFormat)
       .setExtent(vk::Extent3D{ maxWidth, maxHeight, 1 })
       .setMipLevels(1)
-      .setArrayLayers(1)
+      .setArrayLayers(viewCount)
       .setSamples(samples)
       .setTiling(vk::ImageTiling::eOptimal)
       .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment)
       .setSharingMode(vk::SharingMode::eExclusive)
       .setInitialLayout(vk::ImageLayout::eUndefined);
     const auto tempDepthImage = device.createImage(imageCreateInfo);
-    const auto depthMemory = memoryPool.allocateDeviceMemory(tempDepthImage);
+    depthMemory = memoryPool.allocateDeviceMemory(tempDepthImage);
     device.destroyImage(tempDepthImage);
 
     imageCreateInfo
@@ -83,9 +86,9 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
 
     imageViewCreateInfo
       .setImage(depthImage)
-      .setViewType(vk::ImageViewType::e2D)
+      .setViewType(viewType)
       .setFormat(depthFormat)
-      .setSubresourceRange({ vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 });
+      .setSubresourceRange({ vk::ImageAspectFlagBits::eDepth, 0, 1, 0, viewCount });
     depthImageView = device.createImageView(imageViewCreateInfo);
   }
   
@@ -99,6 +102,9 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
       attachments.push_back(colorImageView);
       attachments.push_back(depthImageView);
       attachments.push_back(colorImageViews[i]);
+
+      if (renderPass.hasDepthResolve())
+        attachments.push_back(depthImageViews[i]);
     }
     else
     {
@@ -106,22 +112,28 @@ Framebuffer createFramebuffer(const FramebufferCreateInfo& createInfo)
       attachments.push_back(depthImageViews[i]);
     }
 
+    if (renderPass.hasFragmentDensityMap())
+      attachments.push_back(createInfo.fragmentDensityMapImageView);
+
     vk::FramebufferCreateInfo framebufferCreateInfo;
     framebufferCreateInfo
       .setRenderPass(renderPass)
       .setAttachments(attachments)
       .setWidth(width)
       .setHeight(height)
-      .setLayers(1);
+      .setLayers(1); // Multiview framebuffers have a single layer, views select the array layers
     framebuffers[i] = device.createFramebuffer(framebufferCreateInfo);
   }
 
   Framebuffer framebuffer;
   framebuffer.device_ = device;
+  framebuffer.pMemoryPool_ = &memoryPool;
   framebuffer.colorImage_ = colorImage;
   framebuffer.colorImageView_ = colorImageView;
+  framebuffer.colorMemory_ = colorMemory;
   framebuffer.depthImage_ = depthImage;
   framebuffer.depthImageView_ = depthImageView;
+  framebuffer.depthMemory_ = depthMemory;
   framebuffer.framebuffers_ = framebuffers;
   return framebuffer;
 }
@@ -140,12 +152,16 @@ void Framebuffer::destroy()
   {
     device_.destroyImage(colorImage_);
     device_.destroyImageView(colorImageView_);
+    pMemoryPool_->free(colorMemory_);
+    colorImage_ = nullptr;
   }
 
   if (depthImage_)
   {
     device_.destroyImage(depthImage_);
     device_.destroyImageView(depthImageView_);
+    pMemoryPool_->free(depthMemory_);
+    depthImage_ = nullptr;
   }
 
   for (auto framebuffer : framebuffers_)
@@ -3,11 +3,12 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <vkovr-demo/engine/memory_pool.h>
+
 namespace demo
 {
 namespace engine
 {
-class MemoryPool;
 class RenderPass;
 
 class Framebuffer;
@@ -29,13 +30,16 @@ public:
 
 private:
   vk::Device device_;
+  MemoryPool* pMemoryPool_ = nullptr;
 
   // Pipeline
   std::vector<vk::Framebuffer> framebuffers_;
   vk::Image colorImage_;
   vk::ImageView colorImageView_;
+  MemoryPool::Memory colorMemory_;
   vk::Image depthImage_;
   vk::ImageView depthImageView_;
+  MemoryPool::Memory depthMemory_;
 };
 
 class FramebufferCreateInfo
@@ -50,6 +54,9 @@ public:
   uint32_t maxHeight;
   RenderPass* pRenderPass = nullptr;
   MemoryPool* pMemoryPool = nullptr;
+
+  // Attached last if the render pass has a fragment density map
+  vk::ImageView fragmentDensityMapImageView;
 };
 }
 }
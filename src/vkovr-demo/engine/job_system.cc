@@ -0,0 +1,306 @@
+#include <vkovr-demo/engine/job_system.h>
+
+#include <algorithm>
+
+namespace demo
+{
+namespace engine
+{
+namespace
+{
+// Set on worker threads
+thread_local const void* currentState = nullptr;
+thread_local uint32_t currentThreadIndex = UINT32_MAX;
+}
+
+JobSystem createJobSystem(const JobSystemCreateInfo& createInfo)
+{
+  auto workerCount = createInfo.workerCount;
+  if (workerCount == 0)
+    workerCount = std::clamp(std::thread::hardware_concurrency(), 2u, 8u) - 1;
+
+  JobSystem jobSystem;
+  auto state = jobSystem.state_.get();
+  state->mainThreadId = std::this_thread::get_id();
+
+  for (uint32_t i = 0; i <= workerCount; i++)
+    state->workers.push_back(std::make_unique<JobSystem::Worker>());
+
+  // Thread 0 is the main thread
+  for (uint32_t i = 1; i <= workerCount; i++)
+    jobSystem.threads_->emplace_back(JobSystem::workerLoop, state, i);
+
+  return jobSystem;
+}
+
+JobSystem::JobSystem()
+{
+  state_ = std::make_shared<State>();
+  threads_ = std::make_shared<std::vector<std::thread>>();
+}
+
+JobSystem::~JobSystem()
+{
+}
+
+uint32_t JobSystem::getThreadCount() const
+{
+  return static_cast<uint32_t>(state_->workers.size());
+}
+
+uint32_t JobSystem::getThreadIndex() const
+{
+  if (currentState == state_.get())
+    return currentThreadIndex;
+  if (std::this_thread::get_id() == state_->mainThreadId)
+    return 0;
+  return UINT32_MAX;
+}
+
+JobSystem::JobHandle JobSystem::submit(JobFunction function, const std::vector<JobHandle>& dependencies, Affinity affinity)
+{
+  auto job = std::allocate_shared<Job>(std::pmr::polymorphic_allocator<Job>{ &state_->jobPool });
+  job->function = std::move(function);
+  job->affinity = affinity;
+
+  for (const auto& dependency : dependencies)
+  {
+    std::lock_guard<std::mutex> guard{ dependency->mutex };
+    if (!dependency->complete)
+    {
+      job->pendingCount++;
+      dependency->dependents.push_back(job);
+    }
+  }
+
+  // Dependencies may have completed in the meantime
+  if (--job->pendingCount == 0)
+    schedule(state_.get(), job, getThreadIndex());
+
+  return job;
+}
+
+bool JobSystem::isComplete(const JobHandle& job) const
+{
+  return job->complete;
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+  auto& state = *state_;
+  const auto threadIndex = getThreadIndex();
+  const auto canRunJobs = threadIndex != UINT32_MAX;
+
+  while (!job->complete)
+  {
+    if (canRunJobs)
+    {
+      if (const auto otherJob = findJob(&state, threadIndex))
+      {
+        execute(&state, otherJob, threadIndex);
+        continue;
+      }
+    }
+
+    std::unique_lock<std::mutex> lock{ state.mutex };
+    state.condition.wait(lock, [&state, &job, threadIndex, canRunJobs]
+      {
+        return job->complete
+          || (canRunJobs && state.queuedJobCount > 0)
+          || (threadIndex == 0 && state.mainThreadJobCount > 0);
+      });
+  }
+}
+
+void JobSystem::wait(const std::vector<JobHandle>& jobs)
+{
+  for (const auto& job : jobs)
+    wait(job);
+}
+
+void JobSystem::runMainThreadJobs()
+{
+  auto& state = *state_;
+  while (true)
+  {
+    JobHandle job;
+    {
+      std::lock_guard<std::mutex> guard{ state.mainThreadMutex };
+      if (state.mainThreadJobs.empty())
+        return;
+      job = state.mainThreadJobs.popFront();
+      state.mainThreadJobCount--;
+    }
+
+    execute(&state, job, 0);
+  }
+}
+
+void JobSystem::destroy()
+{
+  {
+    std::lock_guard<std::mutex> guard{ state_->mutex };
+    state_->shouldTerminate = true;
+  }
+  state_->condition.notify_all();
+
+  for (auto& thread : *threads_)
+    thread.join();
+  threads_->clear();
+
+  state_->workers.clear();
+  state_->mainThreadJobs.clear();
+}
+
+void JobSystem::workerLoop(State* state, uint32_t threadIndex)
+{
+  currentState = state;
+  currentThreadIndex = threadIndex;
+
+  while (true)
+  {
+    if (const auto job = findJob(state, threadIndex))
+    {
+      execute(state, job, threadIndex);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{ state->mutex };
+    state->condition.wait(lock, [state] { return state->shouldTerminate || state->queuedJobCount > 0; });
+    if (state->shouldTerminate)
+      return;
+  }
+}
+
+void JobSystem::schedule(State* state, const JobHandle& job, uint32_t threadIndex)
+{
+  if (job->affinity == Affinity::MainThread)
+  {
+    state->mainThreadJobCount++;
+    std::lock_guard<std::mutex> guard{ state->mainThreadMutex };
+    state->mainThreadJobs.pushBack(job);
+  }
+  else
+  {
+    // Other threads never pop their jobs, so push to a worker deque
+    const auto workerCount = static_cast<uint32_t>(state->workers.size());
+    if (threadIndex >= workerCount)
+      threadIndex = 1 + state->nextWorker++ % (workerCount - 1);
+
+    auto& worker = *state->workers[threadIndex];
+    state->queuedJobCount++;
+    std::lock_guard<std::mutex> guard{ worker.mutex };
+    worker.jobs.pushBack(job);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard{ state->mutex };
+  }
+  state->condition.notify_all();
+}
+
+JobSystem::JobHandle JobSystem::findJob(State* state, uint32_t threadIndex)
+{
+  const auto workerCount = static_cast<uint32_t>(state->workers.size());
+
+  // Own deque from the back, most recently pushed and likely still in cache
+  {
+    auto& worker = *state->workers[threadIndex];
+    std::lock_guard<std::mutex> guard{ worker.mutex };
+    if (!worker.jobs.empty())
+    {
+      state->queuedJobCount--;
+      return worker.jobs.popBack();
+    }
+  }
+
+  // Steal from the front of other deques
+  for (uint32_t i = 1; i < workerCount; i++)
+  {
+    auto& worker = *state->workers[(threadIndex + i) % workerCount];
+    std::lock_guard<std::mutex> guard{ worker.mutex };
+    if (!worker.jobs.empty())
+    {
+      state->queuedJobCount--;
+      return worker.jobs.popFront();
+    }
+  }
+
+  // Main thread affinity
+  if (threadIndex == 0)
+  {
+    std::lock_guard<std::mutex> guard{ state->mainThreadMutex };
+    if (!state->mainThreadJobs.empty())
+    {
+      state->mainThreadJobCount--;
+      return state->mainThreadJobs.popFront();
+    }
+  }
+
+  return nullptr;
+}
+
+void JobSystem::execute(State* state, const JobHandle& job, uint32_t threadIndex)
+{
+  job->function();
+  job->function = nullptr;
+
+  std::vector<JobHandle> dependents;
+  {
+    std::lock_guard<std::mutex> guard{ job->mutex };
+    job->complete = true;
+    dependents.swap(job->dependents);
+  }
+
+  for (const auto& dependent : dependents)
+  {
+    if (--dependent->pendingCount == 0)
+      schedule(state, dependent, threadIndex);
+  }
+
+  // Wake waiting threads
+  {
+    std::lock_guard<std::mutex> guard{ state->mutex };
+  }
+  state->condition.notify_all();
+}
+
+void JobSystem::JobQueue::pushBack(JobHandle job)
+{
+  if (size_ == jobs_.size())
+  {
+    // Unwrap into a larger buffer
+    std::vector<JobHandle> jobs(std::max<size_t>(jobs_.size() * 2, 64));
+    for (size_t i = 0; i < size_; i++)
+      jobs[i] = std::move(jobs_[(front_ + i) % jobs_.size()]);
+    jobs_.swap(jobs);
+    front_ = 0;
+  }
+
+  jobs_[(front_ + size_) % jobs_.size()] = std::move(job);
+  size_++;
+}
+
+JobSystem::JobHandle JobSystem::JobQueue::popBack()
+{
+  size_--;
+  return std::move(jobs_[(front_ + size_) % jobs_.size()]);
+}
+
+JobSystem::JobHandle JobSystem::JobQueue::popFront()
+{
+  auto job = std::move(jobs_[front_]);
+  front_ = (front_ + 1) % jobs_.size();
+  size_--;
+  return job;
+}
+
+void JobSystem::JobQueue::clear()
+{
+  for (auto& job : jobs_)
+    job = nullptr;
+  front_ = 0;
+  size_ = 0;
+}
+}
+}
@@ -0,0 +1,152 @@
+#ifndef VKOVR_DEMO_ENGINE_JOB_SYSTEM_H_
+#define VKOVR_DEMO_ENGINE_JOB_SYSTEM_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+
+namespace demo
+{
+namespace engine
+{
+class JobSystem;
+class JobSystemCreateInfo;
+
+JobSystem createJobSystem(const JobSystemCreateInfo& createInfo);
+
+// Work-stealing job scheduler shared by the engine.
+// Each thread pushes and pops jobs at the back of its own deque, and steals from the front of other deques when it runs out.
+// The thread creating the system is the main thread. Jobs with main thread affinity only run there, e.g. for GLFW calls.
+// Jobs come from a pool and queues are ring buffers, so once warmed up, submitting a job whose function fits in the
+// small buffer of std::function, e.g. capturing two pointers, does not allocate.
+class JobSystem
+{
+  friend JobSystem createJobSystem(const JobSystemCreateInfo& createInfo);
+
+public:
+  using JobFunction = std::function<void()>;
+
+  enum class Affinity
+  {
+    Any,
+    MainThread,
+  };
+
+  struct Job;
+  using JobHandle = std::shared_ptr<Job>;
+
+public:
+  JobSystem();
+  ~JobSystem();
+
+  // Main thread and worker threads
+  uint32_t getThreadCount() const;
+
+  // 0 on the main thread, 1 to getThreadCount() - 1 on worker threads, UINT32_MAX on other threads
+  uint32_t getThreadIndex() const;
+
+  // The job starts after all its dependencies complete
+  JobHandle submit(JobFunction function, const std::vector<JobHandle>& dependencies = {}, Affinity affinity = Affinity::Any);
+
+  bool isComplete(const JobHandle& job) const;
+
+  // The main thread and worker threads run other jobs while waiting. Other threads block
+  void wait(const JobHandle& job);
+  void wait(const std::vector<JobHandle>& jobs);
+
+  // Runs jobs with main thread affinity queued so far, called on the main thread once per frame
+  void runMainThreadJobs();
+
+  // Submitted jobs must have completed
+  void destroy();
+
+private:
+  // Ring buffer of jobs, grown only when full
+  class JobQueue
+  {
+  public:
+    bool empty() const { return size_ == 0; }
+
+    void pushBack(JobHandle job);
+    JobHandle popBack();
+    JobHandle popFront();
+    void clear();
+
+  private:
+    std::vector<JobHandle> jobs_;
+    size_t front_ = 0;
+    size_t size_ = 0;
+  };
+
+  struct Worker
+  {
+    std::mutex mutex;
+    JobQueue jobs;
+  };
+
+  // Shared with worker threads
+  struct State
+  {
+    std::thread::id mainThreadId;
+
+    // Deque per thread, the main thread first
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex mainThreadMutex;
+    JobQueue mainThreadJobs;
+
+    // Completed jobs return their memory here, reused by later submissions
+    std::pmr::synchronized_pool_resource jobPool;
+
+    // Incremented before a push, so never less than the number of jobs in deques
+    std::atomic_int32_t queuedJobCount = 0;
+    std::atomic_int32_t mainThreadJobCount = 0;
+
+    // Jobs pushed by other threads are spread over worker deques
+    std::atomic_uint32_t nextWorker = 0;
+
+    // Wakes threads on pushed or completed jobs
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool shouldTerminate = false;
+  };
+
+  static void workerLoop(State* state, uint32_t threadIndex);
+  static void schedule(State* state, const JobHandle& job, uint32_t threadIndex);
+  static JobHandle findJob(State* state, uint32_t threadIndex);
+  static void execute(State* state, const JobHandle& job, uint32_t threadIndex);
+
+  std::shared_ptr<State> state_;
+  std::shared_ptr<std::vector<std::thread>> threads_;
+};
+
+struct JobSystem::Job
+{
+  JobFunction function;
+  Affinity affinity = Affinity::Any;
+
+  // Incomplete dependencies, plus one while being submitted
+  std::atomic_uint32_t pendingCount = 1;
+
+  std::atomic_bool complete = false;
+
+  // Jobs waiting for this one, guarded by mutex
+  std::mutex mutex;
+  std::vector<JobHandle> dependents;
+};
+
+class JobSystemCreateInfo
+{
+public:
+  // Threads other than the main thread. Zero uses the hardware concurrency
+  uint32_t workerCount = 0;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_JOB_SYSTEM_H_
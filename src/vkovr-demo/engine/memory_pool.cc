@@ -1,5 +1,11 @@
 #include <vkovr-demo/engine/memory_pool.h>
 
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace demo
 {
 namespace engine
@@ -10,73 +16,283 @@ vk::DeviceSize align(vk::DeviceSize offset, vk::DeviceSize alignment)
 {
   return (offset + alignment - 1) & ~(alignment - 1);
 }
+
+// Index of the most significant set bit, value must not be zero
+uint32_t findLastSet(uint64_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
 }
 
-MemoryPool createMemoryPool(const MemoryPoolCreateInfo& createInfo)
+// Index of the least significant set bit, value must not be zero
+uint32_t findFirstSet(uint64_t value)
 {
-  const auto device = createInfo.device;
-  const auto physicalDevice = createInfo.physicalDevice;
-  const auto deviceMemorySize = createInfo.deviceMemorySize;
-  const auto hostMemorySize = createInfo.hostMemorySize;
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+}
 
-  uint32_t hostIndex = 0;
-  uint32_t deviceIndex = 0;
+// Two-level segregated fit allocator over a range of offsets. Free blocks are kept in lists indexed by
+// the power of two of their size and a linear subdivision of it, with bitmaps to find a non-empty list
+// in constant time. Freed blocks are merged with their free physical neighbors immediately.
+class TlsfAllocator
+{
+public:
+  static constexpr uint32_t nullBlock = UINT32_MAX;
 
-  // Find memroy type index
-  uint64_t deviceAvailableSize = 0;
-  uint64_t hostAvailableSize = 0;
-  const auto memoryProperties = physicalDevice.getMemoryProperties();
-  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+  explicit TlsfAllocator(vk::DeviceSize size)
   {
-    const auto properties = memoryProperties.memoryTypes[i].propertyFlags;
-    const auto heap_index = memoryProperties.memoryTypes[i].heapIndex;
-    const auto heap = memoryProperties.memoryHeaps[heap_index];
+    freeLists_.fill(nullBlock);
 
-    if ((properties & vk::MemoryPropertyFlagBits::eDeviceLocal) == vk::MemoryPropertyFlagBits::eDeviceLocal)
+    const auto block = createBlock();
+    blocks_[block].offset = 0;
+    blocks_[block].size = size & ~(granularity - 1);
+    insertFreeBlock(block);
+  }
+
+  ~TlsfAllocator() = default;
+
+  // Returns nullBlock if there is no free block large enough
+  uint32_t allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+  {
+    size = align(std::max<vk::DeviceSize>(size, 1), granularity);
+    alignment = std::max(alignment, granularity);
+
+    // Any block of this size can fit the allocation after skipping alignment padding
+    auto block = findFreeBlock(size + alignment - granularity);
+    if (block == nullBlock)
+      return nullBlock;
+
+    removeFreeBlock(block);
+
+    // Return alignment padding to the free lists. The previous physical block is in use,
+    // otherwise it would have been merged
+    const auto alignedOffset = align(blocks_[block].offset, alignment);
+    if (alignedOffset != blocks_[block].offset)
     {
-      if (heap.size > deviceAvailableSize)
-      {
-        deviceIndex = i;
-        deviceAvailableSize = heap.size;
-      }
+      const auto alignedBlock = splitBlock(block, alignedOffset - blocks_[block].offset);
+      insertFreeBlock(block);
+      block = alignedBlock;
+    }
+
+    // Same for the remaining space
+    if (blocks_[block].size > size)
+    {
+      const auto remainingBlock = splitBlock(block, size);
+      insertFreeBlock(remainingBlock);
+    }
+
+    allocationCount_++;
+    return block;
+  }
+
+  void free(uint32_t block)
+  {
+    allocationCount_--;
+
+    const auto prevBlock = blocks_[block].prevPhysical;
+    if (prevBlock != nullBlock && blocks_[prevBlock].free)
+    {
+      removeFreeBlock(prevBlock);
+      mergeBlocks(prevBlock, block);
+      block = prevBlock;
+    }
+
+    const auto nextBlock = blocks_[block].nextPhysical;
+    if (nextBlock != nullBlock && blocks_[nextBlock].free)
+    {
+      removeFreeBlock(nextBlock);
+      mergeBlocks(block, nextBlock);
+    }
+
+    insertFreeBlock(block);
+  }
+
+  auto getOffset(uint32_t block) const { return blocks_[block].offset; }
+  auto empty() const { return allocationCount_ == 0; }
+
+private:
+  // Offsets and sizes are multiples of granularity, which also bounds the number of blocks
+  static constexpr vk::DeviceSize granularity = 256;
+
+  static constexpr uint32_t slCountLog2 = 4;
+  static constexpr uint32_t slCount = 1u << slCountLog2;
+  static constexpr uint32_t flCount = 48;
+
+  struct Block
+  {
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    bool free = false;
+
+    // Neighbors in memory
+    uint32_t prevPhysical = nullBlock;
+    uint32_t nextPhysical = nullBlock;
+
+    // Neighbors in free list
+    uint32_t prevFree = nullBlock;
+    uint32_t nextFree = nullBlock;
+  };
+
+  static void mapping(vk::DeviceSize size, uint32_t& fl, uint32_t& sl)
+  {
+    fl = findLastSet(size);
+    sl = static_cast<uint32_t>(size >> (fl - slCountLog2)) - slCount;
+  }
+
+  uint32_t createBlock()
+  {
+    if (!unusedBlocks_.empty())
+    {
+      const auto block = unusedBlocks_.back();
+      unusedBlocks_.pop_back();
+      blocks_[block] = Block{};
+      return block;
     }
 
-    if ((properties & (vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent))
-      == (vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent))
+    blocks_.emplace_back();
+    return static_cast<uint32_t>(blocks_.size() - 1);
+  }
+
+  // Splits the block at size, returning the new block following it
+  uint32_t splitBlock(uint32_t block, vk::DeviceSize size)
+  {
+    const auto newBlock = createBlock();
+    auto& original = blocks_[block];
+    auto& split = blocks_[newBlock];
+
+    split.offset = original.offset + size;
+    split.size = original.size - size;
+    split.prevPhysical = block;
+    split.nextPhysical = original.nextPhysical;
+    if (split.nextPhysical != nullBlock)
+      blocks_[split.nextPhysical].prevPhysical = newBlock;
+
+    original.size = size;
+    original.nextPhysical = newBlock;
+
+    return newBlock;
+  }
+
+  // Absorbs next block, which must physically follow the block
+  void mergeBlocks(uint32_t block, uint32_t nextBlock)
+  {
+    blocks_[block].size += blocks_[nextBlock].size;
+    blocks_[block].nextPhysical = blocks_[nextBlock].nextPhysical;
+    if (blocks_[block].nextPhysical != nullBlock)
+      blocks_[blocks_[block].nextPhysical].prevPhysical = block;
+
+    unusedBlocks_.push_back(nextBlock);
+  }
+
+  void insertFreeBlock(uint32_t block)
+  {
+    uint32_t fl, sl;
+    mapping(blocks_[block].size, fl, sl);
+
+    const auto head = freeLists_[fl * slCount + sl];
+    blocks_[block].free = true;
+    blocks_[block].prevFree = nullBlock;
+    blocks_[block].nextFree = head;
+    if (head != nullBlock)
+      blocks_[head].prevFree = block;
+    freeLists_[fl * slCount + sl] = block;
+
+    flBitmap_ |= uint64_t{ 1 } << fl;
+    slBitmaps_[fl] |= 1u << sl;
+  }
+
+  void removeFreeBlock(uint32_t block)
+  {
+    uint32_t fl, sl;
+    mapping(blocks_[block].size, fl, sl);
+
+    const auto prevFree = blocks_[block].prevFree;
+    const auto nextFree = blocks_[block].nextFree;
+    if (prevFree != nullBlock)
+      blocks_[prevFree].nextFree = nextFree;
+    if (nextFree != nullBlock)
+      blocks_[nextFree].prevFree = prevFree;
+
+    if (freeLists_[fl * slCount + sl] == block)
     {
-      if (heap.size > hostAvailableSize)
+      freeLists_[fl * slCount + sl] = nextFree;
+      if (nextFree == nullBlock)
       {
-        hostIndex = i;
-        hostAvailableSize = heap.size;
+        slBitmaps_[fl] &= ~(1u << sl);
+        if (slBitmaps_[fl] == 0)
+          flBitmap_ &= ~(uint64_t{ 1 } << fl);
       }
     }
+
+    blocks_[block].free = false;
   }
 
-  vk::MemoryAllocateInfo memoryAllocateInfo;
-  memoryAllocateInfo
-    .setAllocationSize(deviceMemorySize)
-    .setMemoryTypeIndex(deviceIndex);
-  auto deviceMemory = device.allocateMemory(memoryAllocateInfo);
+  uint32_t findFreeBlock(vk::DeviceSize size) const
+  {
+    // Round up to the next list, so that the head of any list found is large enough
+    size += (vk::DeviceSize{ 1 } << (findLastSet(size) - slCountLog2)) - 1;
 
-  memoryAllocateInfo
-    .setAllocationSize(hostMemorySize)
-    .setMemoryTypeIndex(hostIndex);
-  auto hostMemory = device.allocateMemory(memoryAllocateInfo);
+    uint32_t fl, sl;
+    mapping(size, fl, sl);
+    if (fl >= flCount)
+      return nullBlock;
+
+    auto slBitmap = slBitmaps_[fl] & (~0u << sl);
+    if (slBitmap == 0)
+    {
+      const auto flBitmap = flBitmap_ & (~uint64_t{ 0 } << (fl + 1));
+      if (flBitmap == 0)
+        return nullBlock;
+
+      fl = findFirstSet(flBitmap);
+      slBitmap = slBitmaps_[fl];
+    }
+    sl = findFirstSet(slBitmap);
+
+    return freeLists_[fl * slCount + sl];
+  }
+
+  std::vector<Block> blocks_;
+  std::vector<uint32_t> unusedBlocks_;
+  uint32_t allocationCount_ = 0;
+
+  uint64_t flBitmap_ = 0;
+  std::array<uint32_t, flCount> slBitmaps_{};
+  std::array<uint32_t, flCount * slCount> freeLists_;
+};
+
+MemoryPool createMemoryPool(const MemoryPoolCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  const auto physicalDevice = createInfo.physicalDevice;
+  const auto memoryProperties = physicalDevice.getMemoryProperties();
 
   MemoryPool memoryPool;
   memoryPool.device_ = device;
-  memoryPool.hostIndex_ = hostIndex;
-  memoryPool.memories_[0] = deviceMemory;
-  memoryPool.memories_[1] = hostMemory;
+  memoryPool.physicalDevice_ = physicalDevice;
+  memoryPool.memoryBudget_ = createInfo.memoryBudget;
+  memoryPool.blockSize_ = align(createInfo.blockSize, 256);
+  memoryPool.bufferImageGranularity_ = physicalDevice.getProperties().limits.bufferImageGranularity;
+  memoryPool.memoryProperties_ = memoryProperties;
+  memoryPool.blocks_.resize(memoryProperties.memoryTypeCount);
+  memoryPool.heapAllocatedSizes_.resize(memoryProperties.memoryHeapCount, 0);
   return memoryPool;
 }
 
 MemoryPool::MemoryPool()
 {
-  for (int i = 0; i < 2; i++)
-    mutexes_.emplace_back(std::make_shared<std::mutex>());
-
-  mappedMutex_ = std::make_shared<std::mutex>();
+  mutex_ = std::make_shared<std::mutex>();
 }
 
 MemoryPool::~MemoryPool()
@@ -95,21 +311,21 @@ MemoryPool::MappedMemory MemoryPool::allocatePersistentlyMappedMemory(vk::Image
 
 MemoryPool::MappedMemory MemoryPool::allocatePersistentlyMappedMemory(const vk::MemoryRequirements& requirements)
 {
-  vk::MemoryAllocateInfo memoryAllocateInfo;
-  memoryAllocateInfo
-    .setAllocationSize(requirements.size)
-    .setMemoryTypeIndex(hostIndex_);
-  auto memory = device_.allocateMemory(memoryAllocateInfo);
+  // Coherent memory, so mapped ranges need no flush
+  const auto memory = allocateMemory(requirements,
+    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, {}, false);
 
   MappedMemory mappedMemory;
-  mappedMemory.memory = memory;
-  mappedMemory.offset = 0;
-  mappedMemory.size = requirements.size;
-  mappedMemory.map = reinterpret_cast<uint8_t*>(device_.mapMemory(memory, 0, requirements.size));
+  mappedMemory.memory = memory.memory;
+  mappedMemory.offset = memory.offset;
+  mappedMemory.size = memory.size;
+  mappedMemory.memoryTypeIndex = memory.memoryTypeIndex;
+  mappedMemory.blockIndex = memory.blockIndex;
+  mappedMemory.allocation = memory.allocation;
 
   {
-    std::lock_guard<std::mutex> guard{ *mappedMutex_ };
-    mappedMemories_.push_back(mappedMemory);
+    std::lock_guard<std::mutex> guard{ *mutex_ };
+    mappedMemory.map = blocks_[memory.memoryTypeIndex][memory.blockIndex].map + memory.offset;
   }
 
   return mappedMemory;
@@ -117,46 +333,240 @@ MemoryPool::MappedMemory MemoryPool::allocatePersistentlyMappedMemory(const vk::
 
 MemoryPool::Memory MemoryPool::allocateDeviceMemory(vk::Buffer buffer)
 {
-  return allocateMemory(0, device_.getBufferMemoryRequirements(buffer));
+  return allocateMemory(device_.getBufferMemoryRequirements(buffer), {}, vk::MemoryPropertyFlagBits::eDeviceLocal, false);
 }
 
 MemoryPool::Memory MemoryPool::allocateDeviceMemory(vk::Image image)
 {
-  return allocateMemory(0, device_.getImageMemoryRequirements(image));
+  return allocateMemory(device_.getImageMemoryRequirements(image), {}, vk::MemoryPropertyFlagBits::eDeviceLocal, true);
 }
 
 MemoryPool::Memory MemoryPool::allocateHostMemory(vk::Buffer buffer)
 {
-  return allocateMemory(1, device_.getBufferMemoryRequirements(buffer));
+  return allocateMemory(device_.getBufferMemoryRequirements(buffer), vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, {}, false);
 }
 
 MemoryPool::Memory MemoryPool::allocateHostMemory(vk::Image image)
 {
-  return allocateMemory(1, device_.getImageMemoryRequirements(image));
+  return allocateMemory(device_.getImageMemoryRequirements(image), vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, {}, true);
 }
 
-MemoryPool::Memory MemoryPool::allocateMemory(int memoryIndex, const vk::MemoryRequirements& requirements)
+MemoryPool::Memory MemoryPool::allocateMemory(const vk::MemoryRequirements& requirements,
+  vk::MemoryPropertyFlags requiredFlags, vk::MemoryPropertyFlags preferredFlags, bool isImage)
 {
-  std::lock_guard<std::mutex> lock_guard{ *mutexes_[memoryIndex] };
+  auto size = requirements.size;
+  auto alignment = requirements.alignment;
 
+  // Images are assumed to have optimal tiling. Aligning both ends to bufferImageGranularity
+  // keeps them from sharing a page with linear resources
+  if (isImage)
+  {
+    alignment = std::max(alignment, bufferImageGranularity_);
+    size = align(size, bufferImageGranularity_);
+  }
+
+  // Memory types valid for the resource, the ones with preferred flags first
+  std::vector<uint32_t> memoryTypeIndices;
+  for (const auto preferred : { true, false })
+  {
+    for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++)
+    {
+      const auto flags = memoryProperties_.memoryTypes[i].propertyFlags;
+      if ((requirements.memoryTypeBits & (1u << i)) &&
+        (flags & requiredFlags) == requiredFlags &&
+        ((flags & preferredFlags) == preferredFlags) == preferred)
+        memoryTypeIndices.push_back(i);
+    }
+  }
+
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  // Falls back to the next memory type when a heap is out of budget
   Memory memory;
-  memory.memory = memories_[memoryIndex];
-  memory.offset = align(offsets_[memoryIndex], requirements.alignment);
-  memory.size = requirements.size;
+  for (const auto memoryTypeIndex : memoryTypeIndices)
+  {
+    if (allocateFromMemoryType(memoryTypeIndex, size, alignment, memory))
+    {
+      memory.size = requirements.size;
+      return memory;
+    }
+  }
+
+  throw std::runtime_error("Failed to allocate memory from memory pool");
+}
+
+bool MemoryPool::allocateFromMemoryType(uint32_t memoryTypeIndex, vk::DeviceSize size, vk::DeviceSize alignment, Memory& memory)
+{
+  auto& blocks = blocks_[memoryTypeIndex];
 
-  offsets_[memoryIndex] = memory.offset + memory.size;
+  uint32_t blockIndex = 0;
+  uint32_t allocation = TlsfAllocator::nullBlock;
+  for (; blockIndex < blocks.size() && allocation == TlsfAllocator::nullBlock; blockIndex++)
+  {
+    if (blocks[blockIndex].memory)
+      allocation = blocks[blockIndex].allocator->allocate(size, alignment);
+  }
 
-  return memory;
+  if (allocation != TlsfAllocator::nullBlock)
+    blockIndex--;
+  else
+  {
+    // Grow with a new block, large enough for the worst case alignment padding
+    blockIndex = createBlock(memoryTypeIndex, size + alignment);
+    if (blockIndex == UINT32_MAX)
+      return false;
+
+    allocation = blocks[blockIndex].allocator->allocate(size, alignment);
+    if (allocation == TlsfAllocator::nullBlock)
+      return false;
+  }
+
+  memory.memory = blocks[blockIndex].memory;
+  memory.offset = blocks[blockIndex].allocator->getOffset(allocation);
+  memory.memoryTypeIndex = memoryTypeIndex;
+  memory.blockIndex = blockIndex;
+  memory.allocation = allocation;
+  return true;
+}
+
+uint32_t MemoryPool::createBlock(uint32_t memoryTypeIndex, vk::DeviceSize minSize)
+{
+  const auto& memoryType = memoryProperties_.memoryTypes[memoryTypeIndex];
+  const auto heapIndex = memoryType.heapIndex;
+  const auto heapSize = memoryProperties_.memoryHeaps[heapIndex].size;
+
+  // Smaller blocks on small heaps, e.g. 256MB host visible device memory
+  auto blockSize = std::min(blockSize_, align(heapSize / 8, 256));
+  blockSize = std::max(blockSize, align(minSize, 256));
+
+  const auto heapBudget = getHeapBudget(heapIndex);
+  if (heapBudget.usage + blockSize > heapBudget.budget)
+    return UINT32_MAX;
+
+  vk::MemoryAllocateInfo memoryAllocateInfo;
+  memoryAllocateInfo
+    .setAllocationSize(blockSize)
+    .setMemoryTypeIndex(memoryTypeIndex);
+
+  MemoryBlock block;
+  try
+  {
+    block.memory = device_.allocateMemory(memoryAllocateInfo);
+  }
+  catch (const vk::SystemError&)
+  {
+    // Budget may be exceeded by other processes
+    return UINT32_MAX;
+  }
+
+  block.size = blockSize;
+  block.allocator = std::make_shared<TlsfAllocator>(blockSize);
+  if (memoryType.propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+    block.map = reinterpret_cast<uint8_t*>(device_.mapMemory(block.memory, 0, blockSize));
+
+  heapAllocatedSizes_[heapIndex] += blockSize;
+
+  // Reuse slot of a released block, so that block indices of live allocations stay valid
+  auto& blocks = blocks_[memoryTypeIndex];
+  for (uint32_t i = 0; i < blocks.size(); i++)
+  {
+    if (!blocks[i].memory)
+    {
+      blocks[i] = block;
+      return i;
+    }
+  }
+
+  blocks.push_back(block);
+  return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void MemoryPool::free(const Memory& memory)
+{
+  if (memory.allocation == TlsfAllocator::nullBlock)
+    return;
+
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+  freeAllocation(memory.memoryTypeIndex, memory.blockIndex, memory.allocation);
+}
+
+void MemoryPool::free(const MappedMemory& memory)
+{
+  if (memory.allocation == TlsfAllocator::nullBlock)
+    return;
+
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+  freeAllocation(memory.memoryTypeIndex, memory.blockIndex, memory.allocation);
+}
+
+void MemoryPool::freeAllocation(uint32_t memoryTypeIndex, uint32_t blockIndex, uint32_t allocation)
+{
+  auto& blocks = blocks_[memoryTypeIndex];
+  auto& block = blocks[blockIndex];
+  block.allocator->free(allocation);
+
+  // Keep one block per memory type to avoid reallocating on every create and destroy
+  const auto blockCount = std::count_if(blocks.begin(), blocks.end(), [](const MemoryBlock& block) { return block.memory; });
+  if (block.allocator->empty() && blockCount > 1)
+  {
+    if (block.map)
+      device_.unmapMemory(block.memory);
+    device_.freeMemory(block.memory);
+
+    heapAllocatedSizes_[memoryProperties_.memoryTypes[memoryTypeIndex].heapIndex] -= block.size;
+    block = MemoryBlock{};
+  }
+}
+
+std::vector<MemoryPool::HeapBudget> MemoryPool::getHeapBudgets()
+{
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  std::vector<HeapBudget> heapBudgets;
+  for (uint32_t i = 0; i < memoryProperties_.memoryHeapCount; i++)
+    heapBudgets.push_back(getHeapBudget(i));
+  return heapBudgets;
+}
+
+MemoryPool::HeapBudget MemoryPool::getHeapBudget(uint32_t heapIndex)
+{
+  HeapBudget heapBudget;
+  if (memoryBudget_)
+  {
+    const auto chain = physicalDevice_.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    const auto& budgetProperties = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    heapBudget.budget = budgetProperties.heapBudget[heapIndex];
+
+    // Reported usage may not include the most recent allocations yet
+    heapBudget.usage = std::max(budgetProperties.heapUsage[heapIndex], heapAllocatedSizes_[heapIndex]);
+  }
+  else
+  {
+    // Leave some room for other applications and the driver
+    heapBudget.budget = memoryProperties_.memoryHeaps[heapIndex].size / 10 * 8;
+    heapBudget.usage = heapAllocatedSizes_[heapIndex];
+  }
+  return heapBudget;
 }
 
 void MemoryPool::destroy()
 {
-  for (const auto& memory : memories_)
-    device_.freeMemory(memory);
+  for (auto& blocks : blocks_)
+  {
+    for (auto& block : blocks)
+    {
+      if (!block.memory)
+        continue;
+
+      if (block.map)
+        device_.unmapMemory(block.memory);
+      device_.freeMemory(block.memory);
+    }
+    blocks.clear();
+  }
 
-  for (const auto& mappedMemory : mappedMemories_)
-    device_.freeMemory(mappedMemory.memory);
-  mappedMemories_.clear();
+  for (auto& heapAllocatedSize : heapAllocatedSizes_)
+    heapAllocatedSize = 0;
 }
 }
 }
@@ -1,8 +1,9 @@
 #ifndef VKOVR_DEMO_ENGINE_MEMORY_POOL_H_
 #define VKOVR_DEMO_ENGINE_MEMORY_POOL_H_
 
-#include <array>
+#include <vector>
 #include <mutex>
+#include <memory>
 
 #include <vulkan/vulkan.hpp>
 
@@ -13,26 +14,44 @@ namespace engine
 class MemoryPool;
 class MemoryPoolCreateInfo;
 
+class TlsfAllocator;
+
 MemoryPool createMemoryPool(const MemoryPoolCreateInfo& createInfo);
 
 class MemoryPool
 {
   friend MemoryPool createMemoryPool(const MemoryPoolCreateInfo& createInfo);
 
-private:
+public:
   struct Memory
   {
     vk::DeviceMemory memory;
-    vk::DeviceSize offset;
-    vk::DeviceSize size;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+
+    // Allocator bookkeeping, used to free the memory
+    uint32_t memoryTypeIndex = 0;
+    uint32_t blockIndex = 0;
+    uint32_t allocation = UINT32_MAX;
   };
 
   struct MappedMemory
   {
     vk::DeviceMemory memory;
-    vk::DeviceSize offset;
-    vk::DeviceSize size;
-    uint8_t* map;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    uint8_t* map = nullptr;
+
+    // Allocator bookkeeping, used to free the memory
+    uint32_t memoryTypeIndex = 0;
+    uint32_t blockIndex = 0;
+    uint32_t allocation = UINT32_MAX;
+  };
+
+  struct HeapBudget
+  {
+    vk::DeviceSize budget = 0;
+    vk::DeviceSize usage = 0;
   };
 
 public:
@@ -46,20 +65,45 @@ public:
   Memory allocateHostMemory(vk::Buffer buffer);
   Memory allocateHostMemory(vk::Image image);
 
+  // Returns device or host memory to the pool
+  void free(const Memory& memory);
+  void free(const MappedMemory& memory);
+
+  // Per memory heap. Without VK_EXT_memory_budget, estimated from heap size and allocations of this pool
+  std::vector<HeapBudget> getHeapBudgets();
+
   void destroy();
 
 private:
+  // Device memory sub-allocated with its own allocator
+  struct MemoryBlock
+  {
+    vk::DeviceMemory memory;
+    vk::DeviceSize size = 0;
+    uint8_t* map = nullptr;
+    std::shared_ptr<TlsfAllocator> allocator;
+  };
+
   MappedMemory allocatePersistentlyMappedMemory(const vk::MemoryRequirements& requirements);
-  Memory allocateMemory(int memoryIndex, const vk::MemoryRequirements& requirements);
+  Memory allocateMemory(const vk::MemoryRequirements& requirements,
+    vk::MemoryPropertyFlags requiredFlags, vk::MemoryPropertyFlags preferredFlags, bool isImage);
+  bool allocateFromMemoryType(uint32_t memoryTypeIndex, vk::DeviceSize size, vk::DeviceSize alignment, Memory& memory);
+  uint32_t createBlock(uint32_t memoryTypeIndex, vk::DeviceSize minSize);
+  void freeAllocation(uint32_t memoryTypeIndex, uint32_t blockIndex, uint32_t allocation);
+  HeapBudget getHeapBudget(uint32_t heapIndex);
 
   vk::Device device_;
-  uint32_t hostIndex_ = 0;
-  std::array<vk::DeviceMemory, 2> memories_;
-  std::array<vk::DeviceSize, 2> offsets_ = { 0ull, 0ull };
-  std::vector<std::shared_ptr<std::mutex>> mutexes_;
+  vk::PhysicalDevice physicalDevice_;
+  bool memoryBudget_ = false;
+  vk::DeviceSize blockSize_ = 0;
+  vk::DeviceSize bufferImageGranularity_ = 1;
+  vk::PhysicalDeviceMemoryProperties memoryProperties_;
+
+  // Blocks per memory type, and bytes allocated per heap
+  std::vector<std::vector<MemoryBlock>> blocks_;
+  std::vector<vk::DeviceSize> heapAllocatedSizes_;
 
-  std::shared_ptr<std::mutex> mappedMutex_;
-  std::vector<MappedMemory> mappedMemories_;
+  std::shared_ptr<std::mutex> mutex_;
 };
 
 class MemoryPoolCreateInfo
@@ -67,8 +111,12 @@ class MemoryPoolCreateInfo
 public:
   vk::Device device;
   vk::PhysicalDevice physicalDevice;
-  vk::DeviceSize deviceMemorySize;
-  vk::DeviceSize hostMemorySize;
+
+  // Memory is allocated from the device in blocks of this size on demand, or smaller on small heaps
+  vk::DeviceSize blockSize = 64 * 1024 * 1024;
+
+  // Query heap budget and usage with VK_EXT_memory_budget, which must be enabled on the device
+  bool memoryBudget = false;
 };
 }
 }
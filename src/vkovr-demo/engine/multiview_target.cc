@@ -0,0 +1,218 @@
+#include <vkovr-demo/engine/multiview_target.h>
+
+#include <algorithm>
+
+#include <vkovr-demo/engine/render_pass.h>
+
+namespace demo
+{
+namespace engine
+{
+MultiviewTarget createMultiviewTarget(const MultiviewTargetCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  auto& memoryPool = *createInfo.pMemoryPool;
+  const auto& renderPass = *createInfo.pRenderPass;
+  const auto viewCount = renderPass.getViewCount();
+  const vk::Extent2D extent{ createInfo.width, createInfo.height };
+
+  vk::ImageCreateInfo imageCreateInfo;
+  imageCreateInfo
+    .setImageType(vk::ImageType::e2D)
+    .setFormat(renderPass.getFormat())
+    .setExtent({ extent.width, extent.height, 1 })
+    .setMipLevels(1)
+    .setArrayLayers(viewCount)
+    .setSamples(vk::SampleCountFlagBits::e1)
+    .setTiling(vk::ImageTiling::eOptimal)
+    .setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc)
+    .setSharingMode(vk::SharingMode::eExclusive)
+    .setInitialLayout(vk::ImageLayout::eUndefined);
+  const auto colorImage = device.createImage(imageCreateInfo);
+  const auto colorMemory = memoryPool.allocateDeviceMemory(colorImage);
+  device.bindImageMemory(colorImage, colorMemory.memory, colorMemory.offset);
+
+  vk::ImageViewCreateInfo imageViewCreateInfo;
+  imageViewCreateInfo
+    .setImage(colorImage)
+    .setViewType(vk::ImageViewType::e2DArray)
+    .setFormat(renderPass.getFormat())
+    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, viewCount });
+  const auto colorImageView = device.createImageView(imageViewCreateInfo);
+
+  // Depth resolve target, submitted with the eye layers for positional reprojection
+  vk::Image depthImage;
+  vk::ImageView depthImageView;
+  MemoryPool::Memory depthMemory;
+  if (renderPass.hasDepthResolve())
+  {
+    imageCreateInfo
+      .setFormat(renderPass.getDepthFormat())
+      .setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc);
+    depthImage = device.createImage(imageCreateInfo);
+    depthMemory = memoryPool.allocateDeviceMemory(depthImage);
+    device.bindImageMemory(depthImage, depthMemory.memory, depthMemory.offset);
+
+    imageViewCreateInfo
+      .setImage(depthImage)
+      .setFormat(renderPass.getDepthFormat())
+      .setSubresourceRange({ vk::ImageAspectFlagBits::eDepth, 0, 1, 0, viewCount });
+    depthImageView = device.createImageView(imageViewCreateInfo);
+  }
+
+  MultiviewTarget target;
+  target.device_ = device;
+  target.pMemoryPool_ = &memoryPool;
+  target.extent_ = extent;
+  target.colorImage_ = colorImage;
+  target.colorImageView_ = colorImageView;
+  target.colorMemory_ = colorMemory;
+  target.depthImage_ = depthImage;
+  target.depthImageView_ = depthImageView;
+  target.depthMemory_ = depthMemory;
+  return target;
+}
+
+MultiviewTarget::MultiviewTarget()
+{
+}
+
+MultiviewTarget::~MultiviewTarget()
+{
+}
+
+vk::Extent2D MultiviewTarget::getViewportExtent(float viewportScale) const
+{
+  const auto scale = std::clamp(viewportScale, 0.f, 1.f);
+  return vk::Extent2D{
+    std::max(static_cast<uint32_t>(extent_.width * scale), 1u),
+    std::max(static_cast<uint32_t>(extent_.height * scale), 1u),
+  };
+}
+
+void MultiviewTarget::copy(vk::CommandBuffer commandBuffer, const vk::Extent2D& extent,
+  const std::array<vk::Image, 2>& colorImages, const std::array<vk::Image, 2>& depthImages)
+{
+  constexpr auto depthStencil = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+  const auto depth = static_cast<bool>(depthImage_);
+
+  // Sources to transfer src, destinations to transfer dst
+  std::array<vk::ImageMemoryBarrier, 6> barriers;
+  uint32_t barrierCount = 0;
+  barriers[barrierCount++]
+    .setImage(colorImage_)
+    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 2 })
+    .setOldLayout(vk::ImageLayout::eColorAttachmentOptimal)
+    .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+    .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+    .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+  if (depth)
+  {
+    barriers[barrierCount++]
+      .setImage(depthImage_)
+      .setSubresourceRange({ depthStencil, 0, 1, 0, 2 })
+      .setOldLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+      .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+      .setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+      .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+  }
+  for (uint32_t view = 0; view < 2; view++)
+  {
+    barriers[barrierCount++]
+      .setImage(colorImages[view])
+      .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 })
+      .setOldLayout(vk::ImageLayout::eUndefined)
+      .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+      .setSrcAccessMask({})
+      .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+    if (depth)
+    {
+      barriers[barrierCount++]
+        .setImage(depthImages[view])
+        .setSubresourceRange({ depthStencil, 0, 1, 0, 1 })
+        .setOldLayout(vk::ImageLayout::eUndefined)
+        .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+        .setSrcAccessMask({})
+        .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+    }
+  }
+  for (uint32_t i = 0; i < barrierCount; i++)
+  {
+    barriers[i]
+      .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+      .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+  }
+  commandBuffer.pipelineBarrier(
+    vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eTransfer,
+    {}, {}, {}, vk::ArrayProxy<const vk::ImageMemoryBarrier>(barrierCount, barriers.data()));
+
+  for (uint32_t view = 0; view < 2; view++)
+  {
+    vk::ImageCopy region;
+    region
+      .setSrcSubresource({ vk::ImageAspectFlagBits::eColor, 0, view, 1 })
+      .setDstSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+      .setExtent({ extent.width, extent.height, 1 });
+    commandBuffer.copyImage(colorImage_, vk::ImageLayout::eTransferSrcOptimal, colorImages[view], vk::ImageLayout::eTransferDstOptimal, region);
+
+    // The compositor reads depth only
+    if (depth)
+    {
+      region
+        .setSrcSubresource({ vk::ImageAspectFlagBits::eDepth, 0, view, 1 })
+        .setDstSubresource({ vk::ImageAspectFlagBits::eDepth, 0, 0, 1 });
+      commandBuffer.copyImage(depthImage_, vk::ImageLayout::eTransferSrcOptimal, depthImages[view], vk::ImageLayout::eTransferDstOptimal, region);
+    }
+  }
+
+  // Destinations to the layouts eye images have after a render pass, sources are rewritten by the next one
+  barrierCount = 0;
+  for (uint32_t view = 0; view < 2; view++)
+  {
+    barriers[barrierCount++]
+      .setImage(colorImages[view])
+      .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 })
+      .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+      .setNewLayout(vk::ImageLayout::ePresentSrcKHR)
+      .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+      .setDstAccessMask({});
+    if (depth)
+    {
+      barriers[barrierCount++]
+        .setImage(depthImages[view])
+        .setSubresourceRange({ depthStencil, 0, 1, 0, 1 })
+        .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+        .setNewLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+        .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+        .setDstAccessMask({});
+    }
+  }
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+    {}, {}, {}, vk::ArrayProxy<const vk::ImageMemoryBarrier>(barrierCount, barriers.data()));
+
+  // The render pass of a later frame in flight writes the same target after these copies read it
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+    vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+    {}, {}, {}, {});
+}
+
+void MultiviewTarget::destroy()
+{
+  if (colorImage_)
+  {
+    device_.destroyImageView(colorImageView_);
+    device_.destroyImage(colorImage_);
+    pMemoryPool_->free(colorMemory_);
+    colorImage_ = nullptr;
+  }
+
+  if (depthImage_)
+  {
+    device_.destroyImageView(depthImageView_);
+    device_.destroyImage(depthImage_);
+    pMemoryPool_->free(depthMemory_);
+    depthImage_ = nullptr;
+  }
+}
+}
+}
@@ -0,0 +1,74 @@
+#ifndef VKOVR_DEMO_ENGINE_MULTIVIEW_TARGET_H_
+#define VKOVR_DEMO_ENGINE_MULTIVIEW_TARGET_H_
+
+#include <array>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkovr-demo/engine/memory_pool.h>
+
+namespace demo
+{
+namespace engine
+{
+class RenderPass;
+
+class MultiviewTarget;
+class MultiviewTargetCreateInfo;
+
+MultiviewTarget createMultiviewTarget(const MultiviewTargetCreateInfo& createInfo);
+
+// Single-sample color and depth with a layer per view, resolved to by a multiview render pass.
+// LibOVR eye swapchains have a single layer each, so the layers are copied to the eye images after rendering
+class MultiviewTarget
+{
+  friend MultiviewTarget createMultiviewTarget(const MultiviewTargetCreateInfo& createInfo);
+
+public:
+  MultiviewTarget();
+  ~MultiviewTarget();
+
+  auto getColorImageView() const { return colorImageView_; }
+  auto getDepthImageView() const { return depthImageView_; }
+  const auto& getExtent() const { return extent_; }
+
+  // Extent of the viewport rendered at a fraction of the target extent
+  vk::Extent2D getViewportExtent(float viewportScale) const;
+
+  // Records copies of the region at the origin of each layer to the images of the view, outside of render passes.
+  // The render pass leaves color in color attachment layout. Color images are left in present layout,
+  // depth images in depth stencil attachment layout. Depth images are ignored without depth
+  void copy(vk::CommandBuffer commandBuffer, const vk::Extent2D& extent,
+    const std::array<vk::Image, 2>& colorImages, const std::array<vk::Image, 2>& depthImages);
+
+  void destroy();
+
+private:
+  vk::Device device_;
+  MemoryPool* pMemoryPool_ = nullptr;
+
+  vk::Extent2D extent_;
+  vk::Image colorImage_;
+  vk::ImageView colorImageView_;
+  MemoryPool::Memory colorMemory_;
+  vk::Image depthImage_;
+  vk::ImageView depthImageView_;
+  MemoryPool::Memory depthMemory_;
+};
+
+class MultiviewTargetCreateInfo
+{
+public:
+  vk::Device device;
+  MemoryPool* pMemoryPool = nullptr;
+
+  // Formats, view count and depth resolve of the render pass
+  RenderPass* pRenderPass = nullptr;
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_MULTIVIEW_TARGET_H_
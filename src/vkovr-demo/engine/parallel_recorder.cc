@@ -0,0 +1,128 @@
+#include <vkovr-demo/engine/parallel_recorder.h>
+
+#include <algorithm>
+
+namespace demo
+{
+namespace engine
+{
+ParallelRecorder createParallelRecorder(const ParallelRecorderCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  const auto frameCount = createInfo.frameCount;
+
+  ParallelRecorder recorder;
+  recorder.device_ = device;
+  recorder.pJobSystem_ = createInfo.pJobSystem;
+  recorder.minDrawsPerChunk_ = std::max(createInfo.minDrawsPerChunk, 1u);
+
+  // Command pools are externally synchronized, so each thread has its own
+  auto& threadCommandPools = recorder.threadCommandPools_;
+  threadCommandPools.resize(createInfo.pJobSystem->getThreadCount() + 1);
+  for (auto& commandPools : threadCommandPools)
+  {
+    vk::CommandPoolCreateInfo commandPoolCreateInfo;
+    commandPoolCreateInfo
+      .setQueueFamilyIndex(createInfo.queueIndex)
+      .setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+
+    for (uint32_t i = 0; i < frameCount; i++)
+      commandPools.commandPools.push_back(device.createCommandPool(commandPoolCreateInfo));
+    commandPools.commandBuffers.resize(frameCount);
+  }
+
+  return recorder;
+}
+
+ParallelRecorder::ParallelRecorder()
+{
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+}
+
+uint32_t ParallelRecorder::getChunkCount(uint32_t drawCount) const
+{
+  const auto chunkCount = (drawCount + minDrawsPerChunk_ - 1) / minDrawsPerChunk_;
+  return std::clamp(chunkCount, 1u, pJobSystem_->getThreadCount());
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex)
+{
+  frameIndex_ = frameIndex;
+  for (auto& commandPools : threadCommandPools_)
+  {
+    device_.resetCommandPool(commandPools.commandPools[frameIndex]);
+    commandPools.usedCount = 0;
+  }
+}
+
+const std::vector<vk::CommandBuffer>& ParallelRecorder::record(const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t chunkCount, const RecordFunction& function)
+{
+  auto& commandBuffers = recordedCommandBuffers_;
+  commandBuffers.resize(chunkCount);
+
+  // Jobs read the arguments through members, so that their functions fit in the small buffer of std::function
+  pInheritanceInfo_ = &inheritanceInfo;
+  pRecordFunction_ = &function;
+
+  jobs_.clear();
+  for (uint32_t i = 1; i < chunkCount; i++)
+  {
+    jobs_.push_back(pJobSystem_->submit([this, i]
+      {
+        recordedCommandBuffers_[i] = recordChunk(*pInheritanceInfo_, i, *pRecordFunction_);
+      }));
+  }
+
+  commandBuffers[0] = recordChunk(inheritanceInfo, 0, function);
+
+  pJobSystem_->wait(jobs_);
+  jobs_.clear();
+  pInheritanceInfo_ = nullptr;
+  pRecordFunction_ = nullptr;
+
+  return commandBuffers;
+}
+
+vk::CommandBuffer ParallelRecorder::recordChunk(const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t chunkIndex, const RecordFunction& function)
+{
+  const auto threadIndex = std::min(pJobSystem_->getThreadIndex(), static_cast<uint32_t>(threadCommandPools_.size() - 1));
+  auto& commandPools = threadCommandPools_[threadIndex];
+  auto& commandBuffers = commandPools.commandBuffers[frameIndex_];
+
+  // Reuse command buffers allocated in previous frames
+  if (commandPools.usedCount == commandBuffers.size())
+  {
+    vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
+    commandBufferAllocateInfo
+      .setLevel(vk::CommandBufferLevel::eSecondary)
+      .setCommandPool(commandPools.commandPools[frameIndex_])
+      .setCommandBufferCount(1);
+    commandBuffers.push_back(device_.allocateCommandBuffers(commandBufferAllocateInfo)[0]);
+  }
+  const auto commandBuffer = commandBuffers[commandPools.usedCount++];
+
+  vk::CommandBufferBeginInfo beginInfo;
+  beginInfo
+    .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+    .setPInheritanceInfo(&inheritanceInfo);
+  commandBuffer.begin(beginInfo);
+  function(commandBuffer, chunkIndex);
+  commandBuffer.end();
+
+  return commandBuffer;
+}
+
+void ParallelRecorder::destroy()
+{
+  for (auto& commandPools : threadCommandPools_)
+  {
+    for (auto commandPool : commandPools.commandPools)
+      device_.destroyCommandPool(commandPool);
+  }
+  threadCommandPools_.clear();
+}
+}
+}
@@ -0,0 +1,90 @@
+#ifndef VKOVR_DEMO_ENGINE_PARALLEL_RECORDER_H_
+#define VKOVR_DEMO_ENGINE_PARALLEL_RECORDER_H_
+
+#include <vector>
+#include <functional>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkovr-demo/engine/job_system.h>
+
+namespace demo
+{
+namespace engine
+{
+class ParallelRecorder;
+class ParallelRecorderCreateInfo;
+
+ParallelRecorder createParallelRecorder(const ParallelRecorderCreateInfo& createInfo);
+
+// Records chunks of a render pass in parallel into secondary command buffers, as jobs of the job system.
+// The calling thread records too. Each thread allocates from its own command pool per frame in flight.
+class ParallelRecorder
+{
+  friend ParallelRecorder createParallelRecorder(const ParallelRecorderCreateInfo& createInfo);
+
+public:
+  // Records the chunk to a secondary command buffer that has begun inside the render pass
+  using RecordFunction = std::function<void(vk::CommandBuffer commandBuffer, uint32_t chunkIndex)>;
+
+public:
+  ParallelRecorder();
+  ~ParallelRecorder();
+
+  // Number of chunks for the draws, at most one per job system thread
+  uint32_t getChunkCount(uint32_t drawCount) const;
+
+  // Resets the command pools of the frame, whose previous submission must have completed
+  void beginFrame(uint32_t frameIndex);
+
+  // Returns secondary command buffers in chunk order, to be executed in the subpass of the inheritance info.
+  // Valid until the next call
+  const std::vector<vk::CommandBuffer>& record(const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t chunkCount, const RecordFunction& function);
+
+  void destroy();
+
+private:
+  struct ThreadCommandPools
+  {
+    // Per frame in flight
+    std::vector<vk::CommandPool> commandPools;
+    std::vector<std::vector<vk::CommandBuffer>> commandBuffers;
+    uint32_t usedCount = 0;
+  };
+
+  vk::CommandBuffer recordChunk(const vk::CommandBufferInheritanceInfo& inheritanceInfo, uint32_t chunkIndex, const RecordFunction& function);
+
+  vk::Device device_;
+  JobSystem* pJobSystem_ = nullptr;
+  uint32_t minDrawsPerChunk_ = 1;
+  uint32_t frameIndex_ = 0;
+
+  // Per job system thread, and the last one for a calling thread outside of the job system
+  std::vector<ThreadCommandPools> threadCommandPools_;
+
+  // Reused by every record(), so that frames do not allocate
+  std::vector<vk::CommandBuffer> recordedCommandBuffers_;
+  std::vector<JobSystem::JobHandle> jobs_;
+
+  // Arguments of the record() in progress
+  const vk::CommandBufferInheritanceInfo* pInheritanceInfo_ = nullptr;
+  const RecordFunction* pRecordFunction_ = nullptr;
+};
+
+class ParallelRecorderCreateInfo
+{
+public:
+  vk::Device device;
+  uint32_t queueIndex = 0;
+  JobSystem* pJobSystem = nullptr;
+
+  // Frames in flight
+  uint32_t frameCount = 3;
+
+  // Secondary command buffers have a fixed cost, so small scenes are recorded by fewer threads
+  uint32_t minDrawsPerChunk = 32;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_PARALLEL_RECORDER_H_
@@ -0,0 +1,139 @@
+#include <vkovr-demo/engine/pipeline_cache.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+namespace demo
+{
+namespace engine
+{
+namespace
+{
+// Written before the cache data, identifying the device and driver that produced it
+struct FileHeader
+{
+  uint32_t magic;
+  uint32_t driverVersion;
+  uint32_t vendorId;
+  uint32_t deviceId;
+  uint8_t pipelineCacheUuid[VK_UUID_SIZE];
+  uint64_t dataSize;
+};
+
+constexpr uint32_t fileMagic = 0x43504b56; // "VKPC"
+
+FileHeader getFileHeader(const vk::PhysicalDeviceProperties& properties, uint64_t dataSize)
+{
+  FileHeader header{};
+  header.magic = fileMagic;
+  header.driverVersion = properties.driverVersion;
+  header.vendorId = properties.vendorID;
+  header.deviceId = properties.deviceID;
+  std::memcpy(header.pipelineCacheUuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+  header.dataSize = dataSize;
+  return header;
+}
+
+// Returns cache data if the file was written for this device and driver, otherwise empty
+std::vector<uint8_t> loadCacheData(const std::string& filepath, const vk::PhysicalDeviceProperties& properties)
+{
+  std::ifstream file(filepath, std::ios::binary);
+  if (!file.is_open())
+    return {};
+
+  FileHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    return {};
+
+  const auto expectedHeader = getFileHeader(properties, header.dataSize);
+  if (std::memcmp(&header, &expectedHeader, sizeof(header)) != 0)
+  {
+    std::cout << "Pipeline cache: discarding " << filepath << ", written by another device or driver" << std::endl;
+    return {};
+  }
+
+  std::vector<uint8_t> data(header.dataSize);
+  if (!file.read(reinterpret_cast<char*>(data.data()), data.size()))
+    return {};
+
+  // Vulkan header of the cache data itself
+  if (data.size() < 16 + VK_UUID_SIZE)
+    return {};
+
+  uint32_t headerLength, headerVersion, vendorId, deviceId;
+  std::memcpy(&headerLength, data.data(), 4);
+  std::memcpy(&headerVersion, data.data() + 4, 4);
+  std::memcpy(&vendorId, data.data() + 8, 4);
+  std::memcpy(&deviceId, data.data() + 12, 4);
+  if (headerLength < 16 + VK_UUID_SIZE ||
+    headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+    vendorId != properties.vendorID ||
+    deviceId != properties.deviceID ||
+    std::memcmp(data.data() + 16, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+    return {};
+
+  return data;
+}
+}
+
+PipelineCache createPipelineCache(const PipelineCacheCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  const auto properties = createInfo.physicalDevice.getProperties();
+  const auto& filepath = createInfo.filepath;
+
+  const auto data = loadCacheData(filepath, properties);
+  if (!data.empty())
+    std::cout << "Pipeline cache: loaded " << data.size() << " bytes from " << filepath << std::endl;
+
+  vk::PipelineCacheCreateInfo pipelineCacheCreateInfo;
+  pipelineCacheCreateInfo
+    .setInitialDataSize(data.size())
+    .setPInitialData(data.data());
+  const auto pipelineCache = device.createPipelineCache(pipelineCacheCreateInfo);
+
+  PipelineCache result;
+  result.device_ = device;
+  result.properties_ = properties;
+  result.filepath_ = filepath;
+  result.pipelineCache_ = pipelineCache;
+  return result;
+}
+
+PipelineCache::PipelineCache() = default;
+
+PipelineCache::~PipelineCache() = default;
+
+void PipelineCache::save()
+{
+  const auto data = device_.getPipelineCacheData(pipelineCache_);
+  const auto header = getFileHeader(properties_, data.size());
+
+  // Write to a temporary file first, so that an interrupted save does not leave a truncated cache
+  const auto tempFilepath = filepath_ + ".tmp";
+  {
+    std::ofstream file(tempFilepath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+      std::cerr << "Pipeline cache: failed to open " << tempFilepath << std::endl;
+      return;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempFilepath, filepath_, error);
+  if (error)
+    std::cerr << "Pipeline cache: failed to write " << filepath_ << ": " << error.message() << std::endl;
+}
+
+void PipelineCache::destroy()
+{
+  device_.destroyPipelineCache(pipelineCache_);
+}
+}
+}
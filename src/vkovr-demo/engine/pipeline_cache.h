@@ -0,0 +1,52 @@
+#ifndef VKOVR_DEMO_ENGINE_PIPELINE_CACHE_H_
+#define VKOVR_DEMO_ENGINE_PIPELINE_CACHE_H_
+
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+namespace demo
+{
+namespace engine
+{
+class PipelineCache;
+class PipelineCacheCreateInfo;
+
+PipelineCache createPipelineCache(const PipelineCacheCreateInfo& createInfo);
+
+// Pipeline cache persisted to disk. Cache data written by another device or driver version is discarded.
+// Vulkan pipeline caches are internally synchronized, so one cache is shared by the desktop and vr threads.
+class PipelineCache
+{
+  friend PipelineCache createPipelineCache(const PipelineCacheCreateInfo& createInfo);
+
+public:
+  PipelineCache();
+  ~PipelineCache();
+
+  operator vk::PipelineCache() const { return pipelineCache_; }
+
+  void save();
+
+  void destroy();
+
+private:
+  vk::Device device_;
+  vk::PhysicalDeviceProperties properties_;
+  std::string filepath_;
+  vk::PipelineCache pipelineCache_;
+};
+
+class PipelineCacheCreateInfo
+{
+public:
+  vk::Device device;
+  vk::PhysicalDevice physicalDevice;
+
+  // Loaded if exists and valid, written by save()
+  std::string filepath;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_PIPELINE_CACHE_H_
@@ -4,6 +4,48 @@ namespace demo
 {
 namespace engine
 {
+namespace
+{
+vk::AttachmentDescription2 toAttachmentDescription2(const vk::AttachmentDescription& attachment)
+{
+  vk::AttachmentDescription2 result;
+  result
+    .setFormat(attachment.format)
+    .setSamples(attachment.samples)
+    .setLoadOp(attachment.loadOp)
+    .setStoreOp(attachment.storeOp)
+    .setStencilLoadOp(attachment.stencilLoadOp)
+    .setStencilStoreOp(attachment.stencilStoreOp)
+    .setInitialLayout(attachment.initialLayout)
+    .setFinalLayout(attachment.finalLayout);
+  return result;
+}
+
+vk::AttachmentReference2 toAttachmentReference2(const vk::AttachmentReference& reference, vk::ImageAspectFlags aspectMask)
+{
+  vk::AttachmentReference2 result;
+  result
+    .setAttachment(reference.attachment)
+    .setLayout(reference.layout)
+    .setAspectMask(aspectMask);
+  return result;
+}
+
+vk::SubpassDependency2 toSubpassDependency2(const vk::SubpassDependency& dependency)
+{
+  vk::SubpassDependency2 result;
+  result
+    .setSrcSubpass(dependency.srcSubpass)
+    .setDstSubpass(dependency.dstSubpass)
+    .setSrcStageMask(dependency.srcStageMask)
+    .setDstStageMask(dependency.dstStageMask)
+    .setSrcAccessMask(dependency.srcAccessMask)
+    .setDstAccessMask(dependency.dstAccessMask)
+    .setDependencyFlags(dependency.dependencyFlags);
+  return result;
+}
+}
+
 RenderPass createRenderPass(const RenderPassCreateInfo& createInfo)
 {
   const auto device = createInfo.device;
@@ -11,6 +53,9 @@ RenderPass createRenderPass(const RenderPassCreateInfo& createInfo)
   const auto depthFormat = vk::Format::eD24UnormS8Uint;
   const auto samples = createInfo.samples;
   const auto finalLayout = createInfo.finalLayout;
+  const auto viewCount = createInfo.viewCount;
+  const auto fragmentDensityMap = createInfo.fragmentDensityMap;
+  const auto depthResolve = createInfo.depthResolve && samples != vk::SampleCountFlagBits::e1;
 
   std::vector<vk::AttachmentReference> attachmentReferences;
   std::vector<vk::AttachmentDescription> attachments;
@@ -70,6 +115,28 @@ RenderPass createRenderPass(const RenderPassCreateInfo& createInfo)
       .setColorAttachments(attachmentReferences[0])
       .setPDepthStencilAttachment(&attachmentReferences[1])
       .setResolveAttachments(attachmentReferences[2]);
+
+    // Depth of sample zero kept for the compositor's reprojection
+    if (depthResolve)
+    {
+      vk::AttachmentDescription depthResolveAttachment;
+      depthResolveAttachment
+        .setFormat(depthFormat)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setLoadOp(vk::AttachmentLoadOp::eDontCare)
+        .setStoreOp(vk::AttachmentStoreOp::eStore)
+        .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+        .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+        .setInitialLayout(vk::ImageLayout::eUndefined)
+        .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+      attachments.push_back(depthResolveAttachment);
+
+      vk::AttachmentReference depthResolveReference;
+      depthResolveReference
+        .setAttachment(3)
+        .setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+      attachmentReferences.push_back(depthResolveReference);
+    }
   }
   else
   {
@@ -111,6 +178,28 @@ RenderPass createRenderPass(const RenderPassCreateInfo& createInfo)
       .setPDepthStencilAttachment(&attachmentReferences[1]);
   }
 
+  // Fragment density map, read before rasterization and never written by the render pass
+  vk::AttachmentReference fragmentDensityMapReference;
+  if (fragmentDensityMap)
+  {
+    vk::AttachmentDescription fragmentDensityMapAttachment;
+    fragmentDensityMapAttachment
+      .setFormat(vk::Format::eR8G8Unorm)
+      .setSamples(vk::SampleCountFlagBits::e1)
+      .setLoadOp(vk::AttachmentLoadOp::eDontCare)
+      .setStoreOp(vk::AttachmentStoreOp::eDontCare)
+      .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+      .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+      .setInitialLayout(vk::ImageLayout::eFragmentDensityMapOptimalEXT)
+      .setFinalLayout(vk::ImageLayout::eFragmentDensityMapOptimalEXT);
+
+    fragmentDensityMapReference
+      .setAttachment(static_cast<uint32_t>(attachments.size()))
+      .setLayout(vk::ImageLayout::eFragmentDensityMapOptimalEXT);
+
+    attachments.push_back(fragmentDensityMapAttachment);
+  }
+
   // Dependencies
   std::vector<vk::SubpassDependency> dependencies(1);
   dependencies[0]
@@ -121,13 +210,85 @@ RenderPass createRenderPass(const RenderPassCreateInfo& createInfo)
     .setSrcAccessMask({})
     .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
 
+  // Multiview, views are correlated as eyes see almost the same scene
+  const uint32_t viewMask = (1u << viewCount) - 1;
+  vk::RenderPassMultiviewCreateInfo multiviewCreateInfo;
+  multiviewCreateInfo
+    .setViewMasks(viewMask)
+    .setCorrelationMasks(viewMask);
+
   // Render pass
   vk::RenderPassCreateInfo renderPassCreateInfo;
   renderPassCreateInfo
     .setAttachments(attachments)
     .setSubpasses(subpasses)
     .setDependencies(dependencies);
-  const auto renderPass = device.createRenderPass(renderPassCreateInfo);
+
+  vk::RenderPassFragmentDensityMapCreateInfoEXT fragmentDensityMapCreateInfo;
+  fragmentDensityMapCreateInfo
+    .setFragmentDensityMapAttachment(fragmentDensityMapReference);
+
+  if (viewCount > 1)
+    renderPassCreateInfo.setPNext(&multiviewCreateInfo);
+
+  if (fragmentDensityMap)
+  {
+    fragmentDensityMapCreateInfo.setPNext(renderPassCreateInfo.pNext);
+    renderPassCreateInfo.setPNext(&fragmentDensityMapCreateInfo);
+  }
+
+  vk::RenderPass renderPass;
+  if (!depthResolve)
+    renderPass = device.createRenderPass(renderPassCreateInfo);
+  else
+  {
+    // Depth resolve requires render pass 2, core in Vulkan 1.2. Multiview moves to the subpass view mask
+    std::vector<vk::AttachmentDescription2> attachments2;
+    for (const auto& attachment : attachments)
+      attachments2.push_back(toAttachmentDescription2(attachment));
+
+    const auto colorReference2 = toAttachmentReference2(attachmentReferences[0], vk::ImageAspectFlagBits::eColor);
+    const auto depthReference2 = toAttachmentReference2(attachmentReferences[1], vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil);
+    const auto resolveReference2 = toAttachmentReference2(attachmentReferences[2], vk::ImageAspectFlagBits::eColor);
+    const auto depthResolveReference2 = toAttachmentReference2(attachmentReferences[3], vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil);
+
+    // Sample zero is supported by all implementations of depth resolve
+    vk::SubpassDescriptionDepthStencilResolve depthStencilResolve;
+    depthStencilResolve
+      .setDepthResolveMode(vk::ResolveModeFlagBits::eSampleZero)
+      .setStencilResolveMode(vk::ResolveModeFlagBits::eSampleZero)
+      .setPDepthStencilResolveAttachment(&depthResolveReference2);
+
+    vk::SubpassDescription2 subpass2;
+    subpass2
+      .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+      .setViewMask(viewCount > 1 ? viewMask : 0)
+      .setColorAttachments(colorReference2)
+      .setPDepthStencilAttachment(&depthReference2)
+      .setResolveAttachments(resolveReference2)
+      .setPNext(&depthStencilResolve);
+
+    std::vector<vk::SubpassDependency2> dependencies2;
+    for (const auto& dependency : dependencies)
+      dependencies2.push_back(toSubpassDependency2(dependency));
+
+    vk::RenderPassCreateInfo2 renderPassCreateInfo2;
+    renderPassCreateInfo2
+      .setAttachments(attachments2)
+      .setSubpasses(subpass2)
+      .setDependencies(dependencies2);
+
+    if (viewCount > 1)
+      renderPassCreateInfo2.setCorrelatedViewMasks(viewMask);
+
+    if (fragmentDensityMap)
+    {
+      fragmentDensityMapCreateInfo.setPNext(nullptr);
+      renderPassCreateInfo2.setPNext(&fragmentDensityMapCreateInfo);
+    }
+
+    renderPass = device.createRenderPass2(renderPassCreateInfo2);
+  }
 
   RenderPass result;
   result.device_ = device;
@@ -135,6 +296,9 @@ RenderPass createRenderPass(const RenderPassCreateInfo& createInfo)
   result.depthFormat_ = depthFormat;
   result.samples_ = samples;
   result.finalLayout_ = finalLayout;
+  result.viewCount_ = viewCount;
+  result.fragmentDensityMap_ = fragmentDensityMap;
+  result.depthResolve_ = depthResolve;
   result.renderPass_ = renderPass;
   return result;
 }
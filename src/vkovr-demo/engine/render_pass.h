@@ -25,6 +25,9 @@ public:
   auto getFormat() const { return format_; }
   auto getDepthFormat() const { return depthFormat_; }
   auto getSamples() const { return samples_; }
+  auto getViewCount() const { return viewCount_; }
+  auto hasFragmentDensityMap() const { return fragmentDensityMap_; }
+  auto hasDepthResolve() const { return depthResolve_; }
 
   void destroy();
 
@@ -35,6 +38,9 @@ private:
   vk::Format depthFormat_;
   vk::SampleCountFlagBits samples_;
   vk::ImageLayout finalLayout_;
+  uint32_t viewCount_ = 1;
+  bool fragmentDensityMap_ = false;
+  bool depthResolve_ = false;
   vk::RenderPass renderPass_;
 };
 
@@ -45,6 +51,16 @@ public:
   vk::Format format;
   vk::SampleCountFlagBits samples;
   vk::ImageLayout finalLayout;
+
+  // Multiview render pass broadcasting draws to array layers if greater than 1
+  uint32_t viewCount = 1;
+
+  // Last attachment is a fragment density map with a layer per view, requires VK_EXT_fragment_density_map enabled
+  bool fragmentDensityMap = false;
+
+  // With multisampling, resolves depth into an attachment after the color resolve, requires Vulkan 1.2.
+  // Ignored without multisampling, where the depth attachment is already single sampled
+  bool depthResolve = false;
 };
 }
 }
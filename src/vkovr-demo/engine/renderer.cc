@@ -2,8 +2,8 @@
 
 #include <fstream>
 
-#include <vkovr-demo/engine/memory_pool.h>
 #include <vkovr-demo/engine/render_pass.h>
+#include <vkovr-demo/shader/shaders.h>
 
 namespace demo
 {
@@ -11,29 +11,37 @@ namespace engine
 {
 namespace
 {
-auto align(vk::DeviceSize offset, vk::DeviceSize alignment)
+// Shader compiled into the binary, or loaded from <shaderDirectory>/<name>.spv if the directory is given
+vk::ShaderModule createShaderModule(vk::Device device, const std::string& shaderDirectory, const std::string& name)
 {
-  return (offset + alignment - 1) & ~(alignment - 1);
-}
+  vk::ShaderModuleCreateInfo shaderModuleCreateInfo;
 
-vk::ShaderModule createShaderModule(vk::Device device, const std::string& filepath)
-{
+  if (shaderDirectory.empty())
+  {
+    for (const auto& spirv : shader::spirvs)
+    {
+      if (name == spirv.name)
+      {
+        shaderModuleCreateInfo
+          .setCodeSize(spirv.size)
+          .setPCode(spirv.code);
+        return device.createShaderModule(shaderModuleCreateInfo);
+      }
+    }
+
+    throw std::runtime_error("Failed to find embedded shader: " + name);
+  }
+
+  const auto filepath = shaderDirectory + "/" + name + ".spv";
   std::ifstream file(filepath, std::ios::ate | std::ios::binary);
   if (!file.is_open())
     throw std::runtime_error("Failed to open file: " + filepath);
 
-  size_t fileSize = (size_t)file.tellg();
-  std::vector<char> buffer(fileSize);
+  const auto fileSize = static_cast<size_t>(file.tellg());
+  std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
   file.seekg(0);
-  file.read(buffer.data(), fileSize);
-  file.close();
-
-  std::vector<uint32_t> code;
-  auto* intPtr = reinterpret_cast<uint32_t*>(buffer.data());
-  for (int i = 0; i < fileSize / 4; i++)
-    code.push_back(intPtr[i]);
+  file.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
 
-  vk::ShaderModuleCreateInfo shaderModuleCreateInfo;
   shaderModuleCreateInfo.setCode(code);
   return device.createShaderModule(shaderModuleCreateInfo);
 }
@@ -42,29 +50,27 @@ vk::ShaderModule createShaderModule(vk::Device device, const std::string& filepa
 Renderer createRenderer(const RendererCreateInfo& createInfo)
 {
   const auto device = createInfo.device;
-  const auto physicalDevice = createInfo.physicalDevice;
   auto& renderPass = *createInfo.pRenderPass;
   const auto samples = renderPass.getSamples();
+  const auto viewCount = renderPass.getViewCount();
   const auto descriptorPool = createInfo.descriptorPool;
-  const auto imageCount = createInfo.imageCount;
   const auto textureImageView = createInfo.textureImageView;
   const auto sampler = createInfo.sampler;
-  auto& memoryPool = *createInfo.pMemoryPool;
-
-  // Pipeline cache
-  const auto pipelineCache = device.createPipelineCache({});
+  const auto maxInstanceCount = createInfo.maxInstanceCount;
+  auto& uniformAllocator = *createInfo.pUniformAllocator;
+  const auto pipelineCache = createInfo.pipelineCache;
 
   // Descriptor set layout
-  std::vector<vk::DescriptorSetLayoutBinding> descriptorSetLayoutBindings(3);
+  std::vector<vk::DescriptorSetLayoutBinding> descriptorSetLayoutBindings(4);
   descriptorSetLayoutBindings[0]
     .setBinding(0)
-    .setDescriptorType(vk::DescriptorType::eUniformBuffer)
+    .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
     .setDescriptorCount(1)
     .setStageFlags(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
 
   descriptorSetLayoutBindings[1]
     .setBinding(1)
-    .setDescriptorType(vk::DescriptorType::eUniformBuffer)
+    .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
     .setDescriptorCount(1)
     .setStageFlags(vk::ShaderStageFlagBits::eFragment);
 
@@ -74,97 +80,96 @@ Renderer createRenderer(const RendererCreateInfo& createInfo)
     .setDescriptorCount(1)
     .setStageFlags(vk::ShaderStageFlagBits::eFragment);
 
+  descriptorSetLayoutBindings[3]
+    .setBinding(3)
+    .setDescriptorType(vk::DescriptorType::eStorageBufferDynamic)
+    .setDescriptorCount(1)
+    .setStageFlags(vk::ShaderStageFlagBits::eVertex);
+
   vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
   descriptorSetLayoutCreateInfo
     .setBindings(descriptorSetLayoutBindings);
   const auto descriptorSetLayout = device.createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
 
-  // Uniform buffer
-  const auto alignment = physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
-  const auto cameraSize = align(sizeof(CameraUbo), alignment);
-  const auto lightSize = align(sizeof(LightUbo), alignment);
-  const auto stride = cameraSize + lightSize;
-  const auto lightOffset = cameraSize;
-  const auto bufferSize = stride * imageCount;
-
-  vk::BufferCreateInfo bufferCreateInfo;
-  bufferCreateInfo
-    .setUsage(vk::BufferUsageFlagBits::eUniformBuffer)
-    .setSize(bufferSize);
-  const auto uniformBuffer = device.createBuffer(bufferCreateInfo);
-
-  const auto uniformBufferMemory = memoryPool.allocatePersistentlyMappedMemory(uniformBuffer);
-  device.bindBufferMemory(uniformBuffer, uniformBufferMemory.memory, uniformBufferMemory.offset);
-  
-  // Descriptor sets
-  std::vector<vk::DescriptorSetLayout> setLayouts(imageCount, descriptorSetLayout);
+  // Uniform and instance data are written per draw, bound with dynamic offsets
+  const auto cameraSize = viewCount == 1 ? sizeof(CameraUbo) : sizeof(MultiviewCameraUbo);
+  const auto lightSize = sizeof(LightUbo);
+  const auto instanceSize = sizeof(glm::mat4) * maxInstanceCount;
+  if (instanceSize > uniformAllocator.getMaxRange())
+    throw std::runtime_error("Failed to create renderer, instance range exceeding uniform allocator max range");
+
+  const auto uniformBuffer = uniformAllocator.getBuffer();
+
+  // Descriptor set
   vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo;
   descriptorSetAllocateInfo
     .setDescriptorPool(descriptorPool)
-    .setSetLayouts(setLayouts);
-  const auto descriptorSets = device.allocateDescriptorSets(descriptorSetAllocateInfo);
+    .setSetLayouts(descriptorSetLayout);
+  const auto descriptorSet = device.allocateDescriptorSets(descriptorSetAllocateInfo)[0];
 
-  for (int i = 0; i < descriptorSets.size(); i++)
-  {
-    std::vector<vk::DescriptorBufferInfo> bufferInfos(2);
-    bufferInfos[0]
-      .setBuffer(uniformBuffer)
-      .setOffset(stride * i)
-      .setRange(cameraSize);
-
-    bufferInfos[1]
-      .setBuffer(uniformBuffer)
-      .setOffset(stride * i + lightOffset)
-      .setRange(lightSize);
-
-    std::vector<vk::DescriptorImageInfo> imageInfos(1);
-    imageInfos[0]
-      .setImageView(textureImageView)
-      .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-      .setSampler(sampler);
-
-    std::vector<vk::WriteDescriptorSet> descriptorWrites(3);
-    descriptorWrites[0]
-      .setDstSet(descriptorSets[i])
-      .setDstBinding(0)
-      .setDstArrayElement(0)
-      .setDescriptorType(vk::DescriptorType::eUniformBuffer)
-      .setBufferInfo(bufferInfos[0]);
-
-    descriptorWrites[1]
-      .setDstSet(descriptorSets[i])
-      .setDstBinding(1)
-      .setDstArrayElement(0)
-      .setDescriptorType(vk::DescriptorType::eUniformBuffer)
-      .setBufferInfo(bufferInfos[1]);
-
-    descriptorWrites[2]
-      .setDstSet(descriptorSets[i])
-      .setDstBinding(2)
-      .setDstArrayElement(0)
-      .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-      .setImageInfo(imageInfos[0]);
-
-    device.updateDescriptorSets(descriptorWrites, {});
-  }
+  std::vector<vk::DescriptorBufferInfo> bufferInfos(3);
+  bufferInfos[0]
+    .setBuffer(uniformBuffer)
+    .setOffset(0)
+    .setRange(cameraSize);
 
-  // Pipeline layout
-  vk::PushConstantRange pushConstantRange;
-  pushConstantRange
-    .setStageFlags(vk::ShaderStageFlagBits::eVertex)
+  bufferInfos[1]
+    .setBuffer(uniformBuffer)
+    .setOffset(0)
+    .setRange(lightSize);
+
+  bufferInfos[2]
+    .setBuffer(uniformBuffer)
     .setOffset(0)
-    .setSize(sizeof(float) * 16 + sizeof(float) * 16);
+    .setRange(instanceSize);
+
+  std::vector<vk::DescriptorImageInfo> imageInfos(1);
+  imageInfos[0]
+    .setImageView(textureImageView)
+    .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+    .setSampler(sampler);
+
+  std::vector<vk::WriteDescriptorSet> descriptorWrites(4);
+  descriptorWrites[0]
+    .setDstSet(descriptorSet)
+    .setDstBinding(0)
+    .setDstArrayElement(0)
+    .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+    .setBufferInfo(bufferInfos[0]);
+
+  descriptorWrites[1]
+    .setDstSet(descriptorSet)
+    .setDstBinding(1)
+    .setDstArrayElement(0)
+    .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+    .setBufferInfo(bufferInfos[1]);
+
+  descriptorWrites[2]
+    .setDstSet(descriptorSet)
+    .setDstBinding(2)
+    .setDstArrayElement(0)
+    .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+    .setImageInfo(imageInfos[0]);
+
+  descriptorWrites[3]
+    .setDstSet(descriptorSet)
+    .setDstBinding(3)
+    .setDstArrayElement(0)
+    .setDescriptorType(vk::DescriptorType::eStorageBufferDynamic)
+    .setBufferInfo(bufferInfos[2]);
+
+  device.updateDescriptorSets(descriptorWrites, {});
 
+  // Pipeline layout
   vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo;
   pipelineLayoutCreateInfo
-    .setSetLayouts(descriptorSetLayout)
-    .setPushConstantRanges(pushConstantRange);
+    .setSetLayouts(descriptorSetLayout);
   const auto pipelineLayout = device.createPipelineLayout(pipelineLayoutCreateInfo);
 
   // Shader modules
-  const std::string baseDir = "C:\\workspace\\vkovr\\src\\vkovr-demo\\shader";
-  vk::ShaderModule vertModule = createShaderModule(device, baseDir + "\\mesh.vert.spv");
-  vk::ShaderModule fragModule = createShaderModule(device, baseDir + "\\mesh.frag.spv");
+  const std::string shaderName = viewCount == 1 ? "mesh" : "mesh_multiview";
+  vk::ShaderModule vertModule = createShaderModule(device, createInfo.shaderDirectory, shaderName + ".vert");
+  vk::ShaderModule fragModule = createShaderModule(device, createInfo.shaderDirectory, shaderName + ".frag");
 
   // Shader stages
   std::vector<vk::PipelineShaderStageCreateInfo> shaderStages(2);
@@ -305,18 +310,16 @@ Renderer createRenderer(const RendererCreateInfo& createInfo)
   const auto pipeline = pipelineCreateResult.value;
 
   // Destroy local objects
-  device.destroyPipelineCache(pipelineCache);
   device.destroyShaderModule(vertModule);
   device.destroyShaderModule(fragModule);
 
   Renderer renderer;
   renderer.device_ = device;
+  renderer.pUniformAllocator_ = &uniformAllocator;
   renderer.descriptorSetLayout_ = descriptorSetLayout;
-  renderer.uniformBuffer_ = uniformBuffer;
-  renderer.uniformBufferMap_ = uniformBufferMemory.map;
-  renderer.uniformBufferLightOffset_ = lightOffset;
-  renderer.uniformBufferStride_ = stride;
-  renderer.descriptorSets_ = descriptorSets;
+  renderer.descriptorSet_ = descriptorSet;
+  renderer.viewCount_ = viewCount;
+  renderer.maxInstanceCount_ = maxInstanceCount;
   renderer.pipelineLayout_ = pipelineLayout;
   renderer.pipeline_ = pipeline;
   return renderer;
@@ -330,15 +333,14 @@ Renderer::~Renderer()
 {
 }
 
-void Renderer::updateDescriptorSet(int imageIndex)
+void Renderer::updateCamera(const CameraUbo& camera)
 {
-  std::memcpy(uniformBufferMap_ + uniformBufferStride_ * imageIndex, &cameraUbo_, sizeof(CameraUbo));
-  std::memcpy(uniformBufferMap_ + uniformBufferStride_ * imageIndex + uniformBufferLightOffset_, &lightUbo_, sizeof(LightUbo));
+  cameraUbo_ = camera;
 }
 
-void Renderer::updateCamera(const CameraUbo& camera)
+void Renderer::updateCamera(const MultiviewCameraUbo& camera)
 {
-  cameraUbo_ = camera;
+  multiviewCameraUbo_ = camera;
 }
 
 void Renderer::updateLight(const LightUbo& light)
@@ -346,14 +348,39 @@ void Renderer::updateLight(const LightUbo& light)
   lightUbo_ = light;
 }
 
+std::array<uint32_t, 3> Renderer::updateUniforms(vk::ArrayProxy<const glm::mat4> models)
+{
+  if (models.size() > maxInstanceCount_)
+    throw std::runtime_error("Failed to update instances, exceeding max instance count");
+
+  // In binding order of the dynamic descriptors
+  std::array<uint32_t, 3> dynamicOffsets;
+  if (viewCount_ == 1)
+    dynamicOffsets[0] = pUniformAllocator_->write(&cameraUbo_, sizeof(CameraUbo));
+  else
+    dynamicOffsets[0] = pUniformAllocator_->write(&multiviewCameraUbo_, sizeof(MultiviewCameraUbo));
+  dynamicOffsets[1] = pUniformAllocator_->write(&lightUbo_, sizeof(LightUbo));
+  dynamicOffsets[2] = pUniformAllocator_->write(models.data(), sizeof(glm::mat4) * models.size());
+  return dynamicOffsets;
+}
+
+void Renderer::latchCamera(uint32_t cameraOffset, const CameraUbo& camera)
+{
+  cameraUbo_ = camera;
+  pUniformAllocator_->overwrite(cameraOffset, &cameraUbo_, sizeof(CameraUbo));
+}
+
+void Renderer::latchCamera(uint32_t cameraOffset, const MultiviewCameraUbo& camera)
+{
+  multiviewCameraUbo_ = camera;
+  pUniformAllocator_->overwrite(cameraOffset, &multiviewCameraUbo_, sizeof(MultiviewCameraUbo));
+}
+
 void Renderer::destroy()
 {
   device_.destroyDescriptorSetLayout(descriptorSetLayout_);
   device_.destroyPipelineLayout(pipelineLayout_);
   device_.destroyPipeline(pipeline_);
-
-  device_.destroyBuffer(uniformBuffer_);
-  descriptorSets_.clear();
 }
 }
 }
@@ -1,8 +1,16 @@
 #ifndef VKOVR_DEMO_ENGINE_RENDERER_H_
 #define VKOVR_DEMO_ENGINE_RENDERER_H_
 
+#include <vector>
+#include <array>
+#include <string>
+
 #include <vulkan/vulkan.hpp>
 
+#include <glm/glm.hpp>
+
+#include <vkovr-demo/engine/uniform_allocator.h>
+
 #include <vkovr-demo/engine/ubo/camera_ubo.h>
 #include <vkovr-demo/engine/ubo/light_ubo.h>
 
@@ -10,7 +18,6 @@ namespace demo
 {
 namespace engine
 {
-class MemoryPool;
 class RenderPass;
 
 class Renderer;
@@ -29,28 +36,36 @@ public:
   auto getDescriptorSetLayout() const { return descriptorSetLayout_; }
   auto getPipeline() const { return pipeline_; }
   auto getPipelineLayout() const { return pipelineLayout_; }
-  const auto& getDescriptorSets() const { return descriptorSets_; }
+  auto getDescriptorSet() const { return descriptorSet_; }
 
-  void updateDescriptorSet(int imageIndex);
   void updateCamera(const CameraUbo& camera);
+  void updateCamera(const MultiviewCameraUbo& camera);
   void updateLight(const LightUbo& light);
 
+  // Writes camera, light and model matrices drawn with a single instanced draw call to the uniform allocator.
+  // Returns dynamic offsets of the descriptor set for the draw
+  std::array<uint32_t, 3> updateUniforms(vk::ArrayProxy<const glm::mat4> models);
+
+  // Rewrites the camera at the first dynamic offset returned by updateUniforms(), after recording and before submission
+  void latchCamera(uint32_t cameraOffset, const CameraUbo& camera);
+  void latchCamera(uint32_t cameraOffset, const MultiviewCameraUbo& camera);
+
   void destroy();
 
 private:
   vk::Device device_;
+  UniformAllocator* pUniformAllocator_ = nullptr;
 
   vk::DescriptorSetLayout descriptorSetLayout_;
   vk::PipelineLayout pipelineLayout_;
   vk::Pipeline pipeline_;
-  std::vector<vk::DescriptorSet> descriptorSets_;
+  vk::DescriptorSet descriptorSet_;
 
-  vk::Buffer uniformBuffer_;
-  uint8_t* uniformBufferMap_ = nullptr;
-  vk::DeviceSize uniformBufferLightOffset_ = 0;
-  vk::DeviceSize uniformBufferStride_ = 0;
+  uint32_t viewCount_ = 1;
   CameraUbo cameraUbo_;
+  MultiviewCameraUbo multiviewCameraUbo_;
   LightUbo lightUbo_;
+  uint32_t maxInstanceCount_ = 0;
 };
 
 class RendererCreateInfo
@@ -59,11 +74,18 @@ public:
   vk::Device device;
   vk::PhysicalDevice physicalDevice;
   vk::DescriptorPool descriptorPool;
-  uint32_t imageCount;
+
+  // Shared pipeline cache, may be null
+  vk::PipelineCache pipelineCache;
+
   vk::ImageView textureImageView;
   vk::Sampler sampler;
-  MemoryPool* pMemoryPool;
+  UniformAllocator* pUniformAllocator;
   RenderPass* pRenderPass;
+  uint32_t maxInstanceCount = 4096;
+
+  // Loads SPIR-V files from the directory instead of the shaders compiled into the binary, for development
+  std::string shaderDirectory;
 };
 }
 }
@@ -0,0 +1,46 @@
+#include <vkovr-demo/engine/resolution_controller.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace demo
+{
+namespace engine
+{
+ResolutionController createResolutionController(const ResolutionControllerCreateInfo& createInfo)
+{
+  ResolutionController controller;
+  controller.budget_ = createInfo.frameBudget;
+  controller.targetTime_ = createInfo.frameBudget * createInfo.headroom;
+  controller.minScale_ = createInfo.minScale;
+  controller.maxScale_ = createInfo.maxScale;
+  controller.smoothing_ = createInfo.smoothing;
+  controller.scale_ = createInfo.maxScale;
+  return controller;
+}
+
+ResolutionController::ResolutionController()
+{
+}
+
+ResolutionController::~ResolutionController()
+{
+}
+
+void ResolutionController::update(double gpuTime, float frameScale)
+{
+  if (gpuTime <= 0. || frameScale <= 0.f)
+    return;
+
+  // Scale at which the frame would have hit the target time
+  const auto idealScale = frameScale * static_cast<float>(std::sqrt(targetTime_ / gpuTime));
+
+  if (gpuTime > budget_)
+    scale_ = std::min(scale_, idealScale);
+  else
+    scale_ += (idealScale - scale_) * smoothing_;
+
+  scale_ = std::clamp(scale_, minScale_, maxScale_);
+}
+}
+}
@@ -0,0 +1,58 @@
+#ifndef VKOVR_DEMO_ENGINE_RESOLUTION_CONTROLLER_H_
+#define VKOVR_DEMO_ENGINE_RESOLUTION_CONTROLLER_H_
+
+#include <cstdint>
+
+namespace demo
+{
+namespace engine
+{
+class ResolutionController;
+class ResolutionControllerCreateInfo;
+
+ResolutionController createResolutionController(const ResolutionControllerCreateInfo& createInfo);
+
+// Adjusts the viewport scale to hold the GPU time of a frame within its budget.
+// GPU time is assumed to grow with the pixel count, i.e. the square of the scale.
+class ResolutionController
+{
+  friend ResolutionController createResolutionController(const ResolutionControllerCreateInfo& createInfo);
+
+public:
+  ResolutionController();
+  ~ResolutionController();
+
+  auto getScale() const { return scale_; }
+
+  // GPU seconds of a completed frame rendered at the scale, possibly older than the current one
+  void update(double gpuTime, float frameScale);
+
+private:
+  double targetTime_ = 0.;
+  double budget_ = 0.;
+  float minScale_ = 0.5f;
+  float maxScale_ = 1.f;
+  float smoothing_ = 0.1f;
+  float scale_ = 1.f;
+};
+
+class ResolutionControllerCreateInfo
+{
+public:
+  // Seconds per display refresh
+  double frameBudget = 1. / 90.;
+
+  // Fraction of the budget targeted, leaving room for the compositor and spikes
+  float headroom = 0.85f;
+
+  float minScale = 0.5f;
+  float maxScale = 1.f;
+
+  // Fraction of the distance to the ideal scale moved per frame while within budget.
+  // Frames over budget move all the way at once
+  float smoothing = 0.1f;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_RESOLUTION_CONTROLLER_H_
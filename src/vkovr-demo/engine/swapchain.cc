@@ -12,6 +12,61 @@ Swapchain createSwapchain(const SwapchainCreateInfo& createInfo)
   const auto width = createInfo.width;
   const auto height = createInfo.height;
 
+  // Offscreen images when there is no window surface
+  if (!surface)
+  {
+    auto& memoryPool = *createInfo.pMemoryPool;
+
+    // Same image count and format as the triple buffered window swapchain
+    constexpr uint32_t imageCount = 3;
+    constexpr auto format = vk::Format::eB8G8R8A8Srgb;
+
+    std::vector<vk::Image> images(imageCount);
+    std::vector<MemoryPool::Memory> memories(imageCount);
+    std::vector<vk::ImageView> imageViews(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+      vk::ImageCreateInfo imageCreateInfo;
+      imageCreateInfo
+        .setImageType(vk::ImageType::e2D)
+        .setFormat(format)
+        .setExtent({ width, height, 1u })
+        .setMipLevels(1)
+        .setArrayLayers(1)
+        .setSamples(vk::SampleCountFlagBits::e1)
+        .setTiling(vk::ImageTiling::eOptimal)
+        .setUsage(vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eColorAttachment)
+        .setSharingMode(vk::SharingMode::eExclusive)
+        .setInitialLayout(vk::ImageLayout::eUndefined);
+      images[i] = device.createImage(imageCreateInfo);
+
+      memories[i] = memoryPool.allocateDeviceMemory(images[i]);
+      device.bindImageMemory(images[i], memories[i].memory, memories[i].offset);
+
+      vk::ImageViewCreateInfo imageViewCreateInfo;
+      imageViewCreateInfo
+        .setImage(images[i])
+        .setViewType(vk::ImageViewType::e2D)
+        .setFormat(format)
+        .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
+      imageViews[i] = device.createImageView(imageViewCreateInfo);
+    }
+
+    Swapchain resultSwapchain;
+    resultSwapchain.device_ = device;
+    resultSwapchain.width_ = width;
+    resultSwapchain.height_ = height;
+    resultSwapchain.swapchainImageCount_ = imageCount;
+    resultSwapchain.swapchainImageFormat_ = format;
+    resultSwapchain.finalLayout_ = vk::ImageLayout::eTransferSrcOptimal;
+    resultSwapchain.swapchainImages_ = images;
+    resultSwapchain.swapchainImageViews_ = imageViews;
+    resultSwapchain.queue_ = createInfo.queue;
+    resultSwapchain.pMemoryPool_ = &memoryPool;
+    resultSwapchain.memories_ = memories;
+    return resultSwapchain;
+  }
+
   const auto capabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
 
   // Triple buffering
@@ -114,13 +169,64 @@ Swapchain::~Swapchain()
 {
 }
 
+vk::ResultValue<uint32_t> Swapchain::acquireNextImage(vk::Semaphore imageAvailableSemaphore)
+{
+  if (!isOffscreen())
+    return device_.acquireNextImageKHR(swapchain_, UINT64_MAX, imageAvailableSemaphore);
+
+  const auto imageIndex = nextImageIndex_;
+  nextImageIndex_ = (nextImageIndex_ + 1) % swapchainImageCount_;
+
+  // Nothing to wait for, but the semaphore must be signaled as a presentation engine would do
+  vk::SubmitInfo submitInfo;
+  submitInfo
+    .setSignalSemaphores(imageAvailableSemaphore);
+  queue_.submit(submitInfo);
+
+  return vk::ResultValue<uint32_t>{ vk::Result::eSuccess, imageIndex };
+}
+
+vk::Result Swapchain::present(vk::Queue queue, vk::Semaphore renderFinishedSemaphore, uint32_t imageIndex)
+{
+  if (!isOffscreen())
+  {
+    vk::PresentInfoKHR presentInfo;
+    presentInfo
+      .setWaitSemaphores(renderFinishedSemaphore)
+      .setSwapchains(swapchain_)
+      .setImageIndices(imageIndex);
+    return queue.presentKHR(presentInfo);
+  }
+
+  // Consume the semaphore so that it can be signaled again
+  const vk::PipelineStageFlags waitMask = vk::PipelineStageFlagBits::eAllCommands;
+  vk::SubmitInfo submitInfo;
+  submitInfo
+    .setWaitSemaphores(renderFinishedSemaphore)
+    .setWaitDstStageMask(waitMask);
+  queue.submit(submitInfo);
+
+  return vk::Result::eSuccess;
+}
+
 void Swapchain::destroy()
 {
   for (auto& imageView : swapchainImageViews_)
     device_.destroyImageView(imageView);
   swapchainImageViews_.clear();
 
-  device_.destroySwapchainKHR(swapchain_);
+  if (isOffscreen())
+  {
+    for (auto& image : swapchainImages_)
+      device_.destroyImage(image);
+    swapchainImages_.clear();
+
+    for (const auto& memory : memories_)
+      pMemoryPool_->free(memory);
+    memories_.clear();
+  }
+  else
+    device_.destroySwapchainKHR(swapchain_);
 }
 }
 }
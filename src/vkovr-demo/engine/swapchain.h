@@ -5,6 +5,8 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <vkovr-demo/engine/memory_pool.h>
+
 namespace demo
 {
 namespace engine
@@ -27,6 +29,11 @@ public:
   const auto& getImages() const { return swapchainImages_; }
   const auto& getImageViews() const { return swapchainImageViews_; }
   auto getImageCount() const { return swapchainImageCount_; }
+  auto getFinalLayout() const { return finalLayout_; }
+  auto isOffscreen() const { return !swapchain_; }
+
+  vk::ResultValue<uint32_t> acquireNextImage(vk::Semaphore imageAvailableSemaphore);
+  vk::Result present(vk::Queue queue, vk::Semaphore renderFinishedSemaphore, uint32_t imageIndex);
 
   void destroy();
 
@@ -39,8 +46,15 @@ private:
   vk::SwapchainKHR swapchain_;
   uint32_t swapchainImageCount_ = 0;
   vk::Format swapchainImageFormat_ = vk::Format::eUndefined;
+  vk::ImageLayout finalLayout_ = vk::ImageLayout::ePresentSrcKHR;
   std::vector<vk::Image> swapchainImages_;
   std::vector<vk::ImageView> swapchainImageViews_;
+
+  // Offscreen images are owned by this swapchain and handed out in order
+  vk::Queue queue_;
+  uint32_t nextImageIndex_ = 0;
+  MemoryPool* pMemoryPool_ = nullptr;
+  std::vector<MemoryPool::Memory> memories_;
 };
 
 class SwapchainCreateInfo
@@ -51,6 +65,10 @@ public:
   vk::PhysicalDevice physicalDevice;
   uint32_t width;
   uint32_t height;
+
+  // Offscreen swapchain if surface is null
+  vk::Queue queue;
+  MemoryPool* pMemoryPool = nullptr;
 };
 }
 }
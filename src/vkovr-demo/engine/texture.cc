@@ -1,7 +1,5 @@
 #include <vkovr-demo/engine/texture.h>
 
-#include <vkovr-demo/engine/memory_pool.h>
-
 namespace demo
 {
 namespace engine
@@ -11,11 +9,10 @@ Texture createTexture(const TextureCreateInfo& createInfo)
   const auto device = createInfo.device;
   const auto width = createInfo.width;
   const auto height = createInfo.height;
-  const auto srcBuffer = createInfo.srcBuffer;
-  const auto srcOffset = createInfo.srcOffset;
+  const auto pixels = createInfo.pixels;
   const auto mipLevel = createInfo.mipLevel;
-  const auto commandBuffer = createInfo.commandBuffer;
   auto& memoryPool = createInfo.pMemoryPool;
+  auto& uploader = createInfo.pUploader;
 
   constexpr auto format = vk::Format::eR8G8B8A8Srgb;
 
@@ -45,35 +42,42 @@ Texture createTexture(const TextureCreateInfo& createInfo)
     .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, mipLevel, 0, 1 });
   auto imageView = device.createImageView(imageViewCreateInfo);
 
-  // Transition to transfer dst
+  // Base level is left in transfer dst layout for mipmap generation
+  const auto uploadTicket = uploader->uploadImage(image, width, height, mipLevel, pixels, static_cast<vk::DeviceSize>(width) * height * 4,
+    vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+
+  Texture result;
+  result.device_ = device;
+  result.width_ = width;
+  result.height_ = height;
+  result.mipLevel_ = mipLevel;
+  result.image_ = image;
+  result.imageView_ = imageView;
+  result.pMemoryPool_ = memoryPool;
+  result.memory_ = imageMemory;
+  result.uploadTicket_ = uploadTicket;
+  return result;
+}
+
+Texture::Texture()
+{
+}
+
+Texture::~Texture()
+{
+}
+
+void Texture::generateMipmaps(vk::CommandBuffer commandBuffer)
+{
   vk::ImageMemoryBarrier barrier;
   barrier
-    .setImage(image)
-    .setOldLayout(vk::ImageLayout::eUndefined)
-    .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-    .setSrcAccessMask({})
-    .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+    .setImage(image_)
     .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, mipLevel, 0, 1 });
-  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {},
-    {}, {}, barrier);
+    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
 
-  // Copy to image
-  vk::BufferImageCopy region;
-  region
-    .setBufferOffset(srcOffset)
-    .setBufferRowLength(0)
-    .setBufferImageHeight(0)
-    .setImageOffset({ 0, 0, 0 })
-    .setImageExtent({ width, height, 1 })
-    .setImageSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 });
-  commandBuffer.copyBufferToImage(srcBuffer, image, vk::ImageLayout::eTransferDstOptimal, region);
-
-  // Generate mipmap
-  int32_t currentWidth = width;
-  int32_t currentHeight = height;
-  for (uint32_t i = 0; i + 1 < mipLevel; i++)
+  int32_t currentWidth = width_;
+  int32_t currentHeight = height_;
+  for (uint32_t i = 0; i + 1 < mipLevel_; i++)
   {
     // Current level layout from transfer dst to transfer src
     barrier
@@ -100,7 +104,7 @@ Texture createTexture(const TextureCreateInfo& createInfo)
       .setSrcSubresource({ vk::ImageAspectFlagBits::eColor, i, 0, 1 })
       .setDstOffsets(dstOffsets)
       .setDstSubresource({ vk::ImageAspectFlagBits::eColor, i + 1, 0, 1 });
-    commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal,
+    commandBuffer.blitImage(image_, vk::ImageLayout::eTransferSrcOptimal, image_, vk::ImageLayout::eTransferDstOptimal,
       blit, vk::Filter::eLinear);
 
     currentWidth /= 2;
@@ -123,30 +127,16 @@ Texture createTexture(const TextureCreateInfo& createInfo)
     .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
     .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
     .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
-    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, mipLevel - 1, 1, 0, 1 });
+    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, mipLevel_ - 1, 1, 0, 1 });
   commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {},
     {}, {}, barrier);
-
-  Texture result;
-  result.device_ = device;
-  result.mipLevel_ = mipLevel;
-  result.image_ = image;
-  result.imageView_ = imageView;
-  return result;
-}
-
-Texture::Texture()
-{
-}
-
-Texture::~Texture()
-{
 }
 
 void Texture::destroy()
 {
   device_.destroyImage(image_);
   device_.destroyImageView(imageView_);
+  pMemoryPool_->free(memory_);
 }
 }
 }
@@ -3,12 +3,13 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <vkovr-demo/engine/memory_pool.h>
+#include <vkovr-demo/engine/uploader.h>
+
 namespace demo
 {
 namespace engine
 {
-class MemoryPool;
-
 class Texture;
 class TextureCreateInfo;
 
@@ -23,15 +24,24 @@ public:
   ~Texture();
 
   auto getImageView() const { return imageView_; }
+  auto getUploadTicket() const { return uploadTicket_; }
+
+  // Records mipmap generation after the upload is acquired, to a command buffer on the graphics queue family
+  void generateMipmaps(vk::CommandBuffer commandBuffer);
 
   void destroy();
 
 private:
   vk::Device device_;
+  MemoryPool* pMemoryPool_ = nullptr;
 
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
   uint32_t mipLevel_;
   vk::Image image_;
   vk::ImageView imageView_;
+  MemoryPool::Memory memory_;
+  uint64_t uploadTicket_ = 0;
 };
 
 class TextureCreateInfo
@@ -40,11 +50,13 @@ public:
   vk::Device device;
   uint32_t width = 0;
   uint32_t height = 0;
-  vk::Buffer srcBuffer;
-  vk::DeviceSize srcOffset = 0;
+
+  // RGBA8 texels of the base level, copied through the uploader
+  const uint8_t* pixels = nullptr;
+
   uint32_t mipLevel = 1;
-  vk::CommandBuffer commandBuffer;
   MemoryPool* pMemoryPool;
+  Uploader* pUploader;
 };
 }
 }
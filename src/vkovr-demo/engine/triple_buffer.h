@@ -0,0 +1,64 @@
+#ifndef VKOVR_DEMO_ENGINE_TRIPLE_BUFFER_H_
+#define VKOVR_DEMO_ENGINE_TRIPLE_BUFFER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace demo
+{
+namespace engine
+{
+// Wait-free exchange of the latest value from one writer thread to one reader thread.
+// The writer and the reader each own a slot, and swap it with the shared middle slot, so neither ever blocks the other.
+template <typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() = default;
+
+  explicit TripleBuffer(const T& value)
+  {
+    for (auto& slot : slots_)
+      slot.value = value;
+  }
+
+  // Writer thread only
+  void write(const T& value)
+  {
+    slots_[writeIndex_].value = value;
+    const auto previous = middle_.exchange(static_cast<uint8_t>(writeIndex_ | dirtyBit), std::memory_order_acq_rel);
+    writeIndex_ = static_cast<uint8_t>(previous & indexMask);
+  }
+
+  // Reader thread only. Latest written value, or the previous one if nothing was written since
+  const T& read()
+  {
+    if (middle_.load(std::memory_order_relaxed) & dirtyBit)
+    {
+      const auto previous = middle_.exchange(readIndex_, std::memory_order_acq_rel);
+      readIndex_ = static_cast<uint8_t>(previous & indexMask);
+    }
+    return slots_[readIndex_].value;
+  }
+
+private:
+  static constexpr uint8_t indexMask = 3;
+  static constexpr uint8_t dirtyBit = 4;
+
+  // Separate cache lines, as the writer and the reader touch different slots at the same time
+  struct alignas(64) Slot
+  {
+    T value{};
+  };
+
+  std::array<Slot, 3> slots_;
+
+  alignas(64) uint8_t writeIndex_ = 0;
+  alignas(64) std::atomic_uint8_t middle_ = 1;
+  alignas(64) uint8_t readIndex_ = 2;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_TRIPLE_BUFFER_H_
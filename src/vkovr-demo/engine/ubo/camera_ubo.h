@@ -13,6 +13,14 @@ struct CameraUbo
   glm::mat4 view{ 0.f };
   glm::vec3 eye{ 0.f };
 };
+
+// Cameras indexed by gl_ViewIndex in multiview shaders
+struct MultiviewCameraUbo
+{
+  glm::mat4 projection[2]{};
+  glm::mat4 view[2]{};
+  glm::vec4 eye[2]{}; // vec3 array has 16-byte stride in std140
+};
 }
 }
 
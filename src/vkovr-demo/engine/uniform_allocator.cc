@@ -0,0 +1,92 @@
+#include <vkovr-demo/engine/uniform_allocator.h>
+
+#include <cstring>
+#include <algorithm>
+
+namespace demo
+{
+namespace engine
+{
+namespace
+{
+vk::DeviceSize align(vk::DeviceSize offset, vk::DeviceSize alignment)
+{
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+}
+
+UniformAllocator createUniformAllocator(const UniformAllocatorCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  const auto physicalDevice = createInfo.physicalDevice;
+  const auto memoryPool = createInfo.pMemoryPool;
+  const auto frameCount = createInfo.frameCount;
+
+  // Offsets valid for both uniform and storage buffer bindings
+  const auto limits = physicalDevice.getProperties().limits;
+  const auto alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+  const auto frameSize = align(createInfo.frameSize, alignment);
+
+  // A descriptor range starting at the last offset of the last frame must stay inside the buffer
+  const auto bufferSize = frameSize * frameCount + createInfo.maxRange;
+
+  vk::BufferCreateInfo bufferCreateInfo;
+  bufferCreateInfo
+    .setUsage(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer)
+    .setSize(bufferSize);
+  const auto buffer = device.createBuffer(bufferCreateInfo);
+
+  const auto memory = memoryPool->allocatePersistentlyMappedMemory(buffer);
+  device.bindBufferMemory(buffer, memory.memory, memory.offset);
+
+  UniformAllocator uniformAllocator;
+  uniformAllocator.device_ = device;
+  uniformAllocator.pMemoryPool_ = memoryPool;
+  uniformAllocator.buffer_ = buffer;
+  uniformAllocator.memory_ = memory;
+  uniformAllocator.alignment_ = alignment;
+  uniformAllocator.frameSize_ = frameSize;
+  uniformAllocator.maxRange_ = createInfo.maxRange;
+  return uniformAllocator;
+}
+
+UniformAllocator::UniformAllocator()
+{
+}
+
+UniformAllocator::~UniformAllocator()
+{
+}
+
+void UniformAllocator::beginFrame(uint32_t frameIndex)
+{
+  frameOffset_ = frameSize_ * frameIndex;
+  offset_ = 0;
+}
+
+uint32_t UniformAllocator::write(const void* data, vk::DeviceSize size)
+{
+  const auto offset = align(offset_, alignment_);
+  if (offset + size > frameSize_)
+    throw std::runtime_error("Failed to allocate uniform data, exceeding frame size");
+
+  std::memcpy(memory_.map + frameOffset_ + offset, data, size);
+  offset_ = offset + size;
+  return static_cast<uint32_t>(frameOffset_ + offset);
+}
+
+void UniformAllocator::overwrite(uint32_t offset, const void* data, vk::DeviceSize size)
+{
+  if (offset < frameOffset_ || offset + size > frameOffset_ + offset_)
+    throw std::runtime_error("Failed to overwrite uniform data, outside of current frame region");
+
+  std::memcpy(memory_.map + offset, data, size);
+}
+
+void UniformAllocator::destroy()
+{
+  device_.destroyBuffer(buffer_);
+  pMemoryPool_->free(memory_);
+}
+}
+}
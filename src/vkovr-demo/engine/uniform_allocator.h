@@ -0,0 +1,72 @@
+#ifndef VKOVR_DEMO_ENGINE_UNIFORM_ALLOCATOR_H_
+#define VKOVR_DEMO_ENGINE_UNIFORM_ALLOCATOR_H_
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkovr-demo/engine/memory_pool.h>
+
+namespace demo
+{
+namespace engine
+{
+class UniformAllocator;
+class UniformAllocatorCreateInfo;
+
+UniformAllocator createUniformAllocator(const UniformAllocatorCreateInfo& createInfo);
+
+// Linear allocator of per-frame uniform and storage data in a persistently mapped buffer.
+// Each frame in flight owns a region, bound with dynamic offsets to a single descriptor set.
+class UniformAllocator
+{
+  friend UniformAllocator createUniformAllocator(const UniformAllocatorCreateInfo& createInfo);
+
+public:
+  UniformAllocator();
+  ~UniformAllocator();
+
+  auto getBuffer() const { return buffer_; }
+  auto getMaxRange() const { return maxRange_; }
+
+  // Restarts allocation in the region of the frame. Its previous submission must have completed
+  void beginFrame(uint32_t frameIndex);
+
+  // Copies data to the current frame region, returns the dynamic offset
+  uint32_t write(const void* data, vk::DeviceSize size);
+
+  // Rewrites data written to the current frame region, e.g. to late-latch it after recording and before submission
+  void overwrite(uint32_t offset, const void* data, vk::DeviceSize size);
+
+  void destroy();
+
+private:
+  vk::Device device_;
+  MemoryPool* pMemoryPool_ = nullptr;
+
+  vk::Buffer buffer_;
+  MemoryPool::MappedMemory memory_;
+  vk::DeviceSize alignment_ = 1;
+  vk::DeviceSize frameSize_ = 0;
+  vk::DeviceSize maxRange_ = 0;
+
+  vk::DeviceSize frameOffset_ = 0;
+  vk::DeviceSize offset_ = 0;
+};
+
+class UniformAllocatorCreateInfo
+{
+public:
+  vk::Device device;
+  vk::PhysicalDevice physicalDevice;
+  MemoryPool* pMemoryPool = nullptr;
+
+  // Frames in flight
+  uint32_t frameCount = 3;
+  vk::DeviceSize frameSize = 1024 * 1024;
+
+  // Largest descriptor range bound at a dynamic offset
+  vk::DeviceSize maxRange = 256 * 1024;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_UNIFORM_ALLOCATOR_H_
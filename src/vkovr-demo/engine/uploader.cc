@@ -0,0 +1,370 @@
+#include <vkovr-demo/engine/uploader.h>
+
+#include <cstring>
+#include <algorithm>
+
+namespace demo
+{
+namespace engine
+{
+namespace
+{
+vk::DeviceSize align(vk::DeviceSize offset, vk::DeviceSize alignment)
+{
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// Satisfies copyBufferToImage offset alignment for the texel formats in use
+constexpr vk::DeviceSize stagingAlignment = 16;
+}
+
+Uploader createUploader(const UploaderCreateInfo& createInfo)
+{
+  const auto device = createInfo.device;
+  const auto memoryPool = createInfo.pMemoryPool;
+  const auto ringSize = align(createInfo.ringSize, stagingAlignment);
+  const auto batchCount = createInfo.batchCount;
+
+  Uploader uploader;
+  uploader.device_ = device;
+  uploader.queue_ = createInfo.queue;
+  uploader.queueIndex_ = createInfo.queueIndex;
+  uploader.graphicsQueueIndex_ = createInfo.graphicsQueueIndex;
+  uploader.pQueueMutex_ = createInfo.pQueueMutex;
+  uploader.pMemoryPool_ = memoryPool;
+
+  // Command buffers, one per batch
+  vk::CommandPoolCreateInfo commandPoolCreateInfo;
+  commandPoolCreateInfo
+    .setQueueFamilyIndex(createInfo.queueIndex)
+    .setFlags(vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+  uploader.commandPool_ = device.createCommandPool(commandPoolCreateInfo);
+
+  vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
+  commandBufferAllocateInfo
+    .setLevel(vk::CommandBufferLevel::ePrimary)
+    .setCommandPool(uploader.commandPool_)
+    .setCommandBufferCount(batchCount);
+  const auto commandBuffers = device.allocateCommandBuffers(commandBufferAllocateInfo);
+
+  uploader.batches_.resize(batchCount);
+  for (uint32_t i = 0; i < batchCount; i++)
+  {
+    uploader.batches_[i].commandBuffer = commandBuffers[i];
+    uploader.batches_[i].fence = device.createFence({});
+    uploader.freeBatches_.push_back(batchCount - i - 1);
+  }
+
+  // Staging ring
+  vk::BufferCreateInfo bufferCreateInfo;
+  bufferCreateInfo
+    .setUsage(vk::BufferUsageFlagBits::eTransferSrc)
+    .setSize(ringSize);
+  uploader.ringBuffer_ = device.createBuffer(bufferCreateInfo);
+
+  uploader.ringMemory_ = memoryPool->allocatePersistentlyMappedMemory(uploader.ringBuffer_);
+  device.bindBufferMemory(uploader.ringBuffer_, uploader.ringMemory_.memory, uploader.ringMemory_.offset);
+  uploader.ringSize_ = ringSize;
+
+  return uploader;
+}
+
+Uploader::Uploader()
+{
+  mutex_ = std::make_shared<std::mutex>();
+}
+
+Uploader::~Uploader()
+{
+}
+
+uint64_t Uploader::uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size,
+  vk::PipelineStageFlags dstStageMask, vk::AccessFlags dstAccessMask)
+{
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  // Data larger than the ring is copied in chunks, possibly over several batches
+  const auto bytes = static_cast<const uint8_t*>(data);
+  for (vk::DeviceSize copied = 0; copied < size;)
+  {
+    const auto chunkSize = std::min(size - copied, ringSize_);
+    const auto stagingOffset = allocateStaging(chunkSize);
+    std::memcpy(ringMemory_.map + stagingOffset, bytes + copied, chunkSize);
+
+    auto& batch = getRecordingBatch();
+    batch.ringEnd = ringHead_;
+
+    vk::BufferCopy region;
+    region
+      .setSrcOffset(stagingOffset)
+      .setDstOffset(offset + copied)
+      .setSize(chunkSize);
+    batch.commandBuffer.copyBuffer(ringBuffer_, buffer, region);
+
+    copied += chunkSize;
+  }
+
+  auto& batch = getRecordingBatch();
+
+  vk::BufferMemoryBarrier barrier;
+  barrier
+    .setBuffer(buffer)
+    .setOffset(offset)
+    .setSize(size)
+    .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+    .setDstAccessMask(dstAccessMask)
+    .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+
+  if (queueIndex_ != graphicsQueueIndex_)
+  {
+    // Release to the graphics queue family, with a matching acquire recorded by acquire()
+    barrier
+      .setSrcQueueFamilyIndex(queueIndex_)
+      .setDstQueueFamilyIndex(graphicsQueueIndex_);
+
+    auto releaseBarrier = barrier;
+    releaseBarrier.setDstAccessMask({});
+    batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+      {}, releaseBarrier, {});
+
+    barrier.setSrcAccessMask({});
+  }
+
+  batch.bufferBarriers.push_back(barrier);
+  batch.dstStageMask |= dstStageMask;
+  return batch.ticket;
+}
+
+uint64_t Uploader::uploadImage(vk::Image image, uint32_t width, uint32_t height, uint32_t mipLevel, const void* data, vk::DeviceSize size,
+  vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStageMask, vk::AccessFlags dstAccessMask)
+{
+  if (size > ringSize_)
+    throw std::runtime_error("Failed to upload image larger than staging ring");
+
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  const auto stagingOffset = allocateStaging(size);
+  std::memcpy(ringMemory_.map + stagingOffset, data, size);
+
+  auto& batch = getRecordingBatch();
+  batch.ringEnd = ringHead_;
+
+  // Transition to transfer dst
+  vk::ImageMemoryBarrier barrier;
+  barrier
+    .setImage(image)
+    .setOldLayout(vk::ImageLayout::eUndefined)
+    .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+    .setSrcAccessMask({})
+    .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+    .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+    .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, mipLevel, 0, 1 });
+  batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {},
+    {}, {}, barrier);
+
+  // Copy to image
+  vk::BufferImageCopy region;
+  region
+    .setBufferOffset(stagingOffset)
+    .setBufferRowLength(0)
+    .setBufferImageHeight(0)
+    .setImageOffset({ 0, 0, 0 })
+    .setImageExtent({ width, height, 1 })
+    .setImageSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 });
+  batch.commandBuffer.copyBufferToImage(ringBuffer_, image, vk::ImageLayout::eTransferDstOptimal, region);
+
+  // Layout from transfer dst to final layout, on the graphics queue
+  barrier
+    .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+    .setNewLayout(finalLayout)
+    .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+    .setDstAccessMask(dstAccessMask);
+
+  if (queueIndex_ != graphicsQueueIndex_)
+  {
+    // Release to the graphics queue family. Release and acquire specify the same layout transition
+    barrier
+      .setSrcQueueFamilyIndex(queueIndex_)
+      .setDstQueueFamilyIndex(graphicsQueueIndex_);
+
+    auto releaseBarrier = barrier;
+    releaseBarrier.setDstAccessMask({});
+    batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+      {}, {}, releaseBarrier);
+
+    barrier.setSrcAccessMask({});
+  }
+
+  batch.imageBarriers.push_back(barrier);
+  batch.dstStageMask |= dstStageMask;
+  return batch.ticket;
+}
+
+uint64_t Uploader::flush()
+{
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  if (recordingBatch_ == UINT32_MAX)
+    return nextTicket_ - 1;
+
+  const auto ticket = batches_[recordingBatch_].ticket;
+  submitRecordingBatch();
+  return ticket;
+}
+
+bool Uploader::isComplete(uint64_t ticket)
+{
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  retireBatches(false);
+  return ticket <= completedTicket_;
+}
+
+void Uploader::wait(uint64_t ticket)
+{
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  if (recordingBatch_ != UINT32_MAX && batches_[recordingBatch_].ticket <= ticket)
+    submitRecordingBatch();
+
+  while (completedTicket_ < ticket && !pendingBatches_.empty())
+    retireBatches(true);
+}
+
+void Uploader::acquire(vk::CommandBuffer commandBuffer)
+{
+  std::lock_guard<std::mutex> guard{ *mutex_ };
+
+  retireBatches(false);
+  if (acquireBufferBarriers_.empty() && acquireImageBarriers_.empty())
+    return;
+
+  // Completed batches were waited on the host, so no semaphore is needed
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, acquireStageMask_, {},
+    {}, acquireBufferBarriers_, acquireImageBarriers_);
+
+  acquireStageMask_ = {};
+  acquireBufferBarriers_.clear();
+  acquireImageBarriers_.clear();
+}
+
+Uploader::Batch& Uploader::getRecordingBatch()
+{
+  if (recordingBatch_ == UINT32_MAX)
+  {
+    // All batches in flight, wait for the oldest one
+    if (freeBatches_.empty())
+      retireBatches(true);
+
+    recordingBatch_ = freeBatches_.back();
+    freeBatches_.pop_back();
+
+    auto& batch = batches_[recordingBatch_];
+    batch.ticket = nextTicket_++;
+    batch.dstStageMask = {};
+    batch.commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+  }
+
+  return batches_[recordingBatch_];
+}
+
+vk::DeviceSize Uploader::allocateStaging(vk::DeviceSize size)
+{
+  while (true)
+  {
+    // Wrap around instead of splitting an allocation at the end of the ring
+    auto head = align(ringHead_, stagingAlignment);
+    if (head % ringSize_ + size > ringSize_)
+      head = (head / ringSize_ + 1) * ringSize_;
+
+    if (head + size - ringTail_ <= ringSize_)
+    {
+      ringHead_ = head + size;
+      return head % ringSize_;
+    }
+
+    // Ring is full. The recording batch may hold the space, so submit it before waiting
+    if (pendingBatches_.empty())
+      submitRecordingBatch();
+    retireBatches(true);
+  }
+}
+
+void Uploader::submitRecordingBatch()
+{
+  if (recordingBatch_ == UINT32_MAX)
+    return;
+
+  auto& batch = batches_[recordingBatch_];
+  batch.commandBuffer.end();
+
+  vk::SubmitInfo submitInfo;
+  submitInfo.setCommandBuffers(batch.commandBuffer);
+  {
+    std::unique_lock<std::mutex> queueLock;
+    if (pQueueMutex_)
+      queueLock = std::unique_lock<std::mutex>{ *pQueueMutex_ };
+    queue_.submit(submitInfo, batch.fence);
+  }
+
+  pendingBatches_.push_back(recordingBatch_);
+  recordingBatch_ = UINT32_MAX;
+}
+
+void Uploader::retireBatches(bool waitOldest)
+{
+  if (waitOldest && !pendingBatches_.empty())
+  {
+    const auto result = device_.waitForFences(batches_[pendingBatches_.front()].fence, true, UINT64_MAX);
+    if (result != vk::Result::eSuccess)
+      throw std::runtime_error("Failed to wait for upload batch");
+  }
+
+  // Batches complete in submission order on a single queue
+  while (!pendingBatches_.empty())
+  {
+    const auto batchIndex = pendingBatches_.front();
+    auto& batch = batches_[batchIndex];
+    if (device_.getFenceStatus(batch.fence) != vk::Result::eSuccess)
+      break;
+
+    device_.resetFences(batch.fence);
+
+    ringTail_ = batch.ringEnd;
+    completedTicket_ = batch.ticket;
+
+    acquireStageMask_ |= batch.dstStageMask;
+    acquireBufferBarriers_.insert(acquireBufferBarriers_.end(), batch.bufferBarriers.begin(), batch.bufferBarriers.end());
+    acquireImageBarriers_.insert(acquireImageBarriers_.end(), batch.imageBarriers.begin(), batch.imageBarriers.end());
+    batch.bufferBarriers.clear();
+    batch.imageBarriers.clear();
+
+    pendingBatches_.pop_front();
+    freeBatches_.push_back(batchIndex);
+  }
+}
+
+void Uploader::destroy()
+{
+  {
+    std::lock_guard<std::mutex> guard{ *mutex_ };
+
+    submitRecordingBatch();
+    while (!pendingBatches_.empty())
+      retireBatches(true);
+  }
+
+  for (const auto& batch : batches_)
+    device_.destroyFence(batch.fence);
+  batches_.clear();
+  freeBatches_.clear();
+
+  device_.destroyCommandPool(commandPool_);
+
+  device_.destroyBuffer(ringBuffer_);
+  pMemoryPool_->free(ringMemory_);
+}
+}
+}
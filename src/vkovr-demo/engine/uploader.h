@@ -0,0 +1,123 @@
+#ifndef VKOVR_DEMO_ENGINE_UPLOADER_H_
+#define VKOVR_DEMO_ENGINE_UPLOADER_H_
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkovr-demo/engine/memory_pool.h>
+
+namespace demo
+{
+namespace engine
+{
+class Uploader;
+class UploaderCreateInfo;
+
+Uploader createUploader(const UploaderCreateInfo& createInfo);
+
+// Streams data to device local resources through a persistently mapped staging ring.
+// Copies are batched into command buffers submitted to the transfer queue, and each batch is tracked with a fence.
+// Resources are released to the graphics queue family, and acquired with acquire() once their batch has completed.
+class Uploader
+{
+  friend Uploader createUploader(const UploaderCreateInfo& createInfo);
+
+public:
+  Uploader();
+  ~Uploader();
+
+  // Returns the ticket of the batch the copy is recorded into
+  uint64_t uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size,
+    vk::PipelineStageFlags dstStageMask, vk::AccessFlags dstAccessMask);
+
+  // Copies tightly packed texels to mip level 0. The image is in finalLayout once acquired
+  uint64_t uploadImage(vk::Image image, uint32_t width, uint32_t height, uint32_t mipLevel, const void* data, vk::DeviceSize size,
+    vk::ImageLayout finalLayout, vk::PipelineStageFlags dstStageMask, vk::AccessFlags dstAccessMask);
+
+  // Submits the recording batch, returns its ticket
+  uint64_t flush();
+
+  bool isComplete(uint64_t ticket);
+  void wait(uint64_t ticket);
+
+  // Records acquire barriers of completed uploads, to a command buffer submitted to the graphics queue family
+  void acquire(vk::CommandBuffer commandBuffer);
+
+  void destroy();
+
+private:
+  struct Batch
+  {
+    vk::CommandBuffer commandBuffer;
+    vk::Fence fence;
+    uint64_t ticket = 0;
+
+    // Ring position after the last staging allocation of this batch
+    vk::DeviceSize ringEnd = 0;
+
+    vk::PipelineStageFlags dstStageMask;
+    std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+  };
+
+  Batch& getRecordingBatch();
+  vk::DeviceSize allocateStaging(vk::DeviceSize size);
+  void submitRecordingBatch();
+  void retireBatches(bool waitOldest);
+
+  vk::Device device_;
+  vk::Queue queue_;
+  uint32_t queueIndex_ = 0;
+  uint32_t graphicsQueueIndex_ = 0;
+  std::mutex* pQueueMutex_ = nullptr;
+  MemoryPool* pMemoryPool_ = nullptr;
+
+  vk::CommandPool commandPool_;
+
+  // Staging ring. Head and tail count bytes since creation
+  vk::Buffer ringBuffer_;
+  MemoryPool::MappedMemory ringMemory_;
+  vk::DeviceSize ringSize_ = 0;
+  vk::DeviceSize ringHead_ = 0;
+  vk::DeviceSize ringTail_ = 0;
+
+  std::vector<Batch> batches_;
+  std::vector<uint32_t> freeBatches_;
+  std::deque<uint32_t> pendingBatches_;
+  uint32_t recordingBatch_ = UINT32_MAX;
+  uint64_t nextTicket_ = 1;
+  uint64_t completedTicket_ = 0;
+
+  // Acquire barriers of completed batches
+  vk::PipelineStageFlags acquireStageMask_;
+  std::vector<vk::BufferMemoryBarrier> acquireBufferBarriers_;
+  std::vector<vk::ImageMemoryBarrier> acquireImageBarriers_;
+
+  std::shared_ptr<std::mutex> mutex_;
+};
+
+class UploaderCreateInfo
+{
+public:
+  vk::Device device;
+  MemoryPool* pMemoryPool = nullptr;
+
+  // Transfer queue, may be the graphics queue
+  vk::Queue queue;
+  uint32_t queueIndex = 0;
+  uint32_t graphicsQueueIndex = 0;
+
+  // Locked around submits when the queue is shared with another thread
+  std::mutex* pQueueMutex = nullptr;
+
+  vk::DeviceSize ringSize = 16 * 1024 * 1024;
+  uint32_t batchCount = 4;
+};
+}
+}
+
+#endif // VKOVR_DEMO_ENGINE_UPLOADER_H_
@@ -7,16 +7,44 @@
 #include <iostream>
 #include <chrono>
 #include <queue>
+#include <algorithm>
 
 #include <vkovr-demo/engine/engine.h>
 #include <vkovr-demo/engine/memory_pool.h>
 #include <vkovr-demo/engine/texture.h>
 #include <vkovr-demo/engine/sampler.h>
+#include <vkovr-demo/engine/allocation_counter.h>
 
 namespace demo
 {
 namespace engine
 {
+namespace
+{
+// Y-up to Z-up
+glm::mat4 getCoordinateSystem()
+{
+  glm::mat4 coordinateSystem{ 0.f };
+  coordinateSystem[0][0] = 1.f;
+  coordinateSystem[1][2] = 1.f;
+  coordinateSystem[2][1] = -1.f;
+  coordinateSystem[3][3] = 1.f;
+  return coordinateSystem;
+}
+
+MultiviewCameraUbo getMultiviewCamera(const std::array<CameraUbo, ovrEye_Count>& cameras)
+{
+  MultiviewCameraUbo camera;
+  for (const auto eye : { ovrEye_Left, ovrEye_Right })
+  {
+    camera.projection[eye] = cameras[eye].projection;
+    camera.view[eye] = cameras[eye].view;
+    camera.eye[eye] = glm::vec4{ cameras[eye].eye, 1.f };
+  }
+  return camera;
+}
+}
+
 VrWorker::VrWorker(Engine* engine)
   : engine_{ engine }
 {
@@ -34,14 +62,12 @@ void VrWorker::join()
 
 void VrWorker::updateLight(const LightUbo& light)
 {
-  std::lock_guard<std::mutex> guard{ lightMutex_ };
-  light_ = light;
+  light_.write(light);
 }
 
 std::array<glm::mat4, 2> VrWorker::getEyePoses()
 {
-  std::lock_guard<std::mutex> guard{ eyeMutex_ };
-  return eyePoses_;
+  return eyePoses_.read();
 }
 
 void VrWorker::run(const VrWorkerRunInfo& runInfo)
@@ -50,8 +76,23 @@ void VrWorker::run(const VrWorkerRunInfo& runInfo)
   physicalDevice_ = runInfo.physicalDevice;
   device_ = runInfo.device;
   pMemoryPool_ = runInfo.pMemoryPool;
+  pJobSystem_ = runInfo.pJobSystem;
+  pipelineCache_ = runInfo.pipelineCache;
+  shaderDirectory_ = runInfo.shaderDirectory;
   queue_ = runInfo.queue;
   queueIndex_ = runInfo.queueIndex;
+  pQueueMutex_ = runInfo.pQueueMutex;
+  backend_ = runInfo.backend;
+  multiview_ = runInfo.multiview;
+  maxPixelDensity_ = runInfo.maxPixelDensity;
+  fragmentDensityMap_ = runInfo.fragmentDensityMap;
+  foveationLevel_ = runInfo.foveationLevel;
+  gazeSource_ = runInfo.gazeSource;
+  depthResolve_ = runInfo.depthResolve;
+  framesInFlight_ = runInfo.framesInFlight;
+  mirrorImages_ = runInfo.mirrorImages;
+  mirrorExtent_ = runInfo.mirrorExtent;
+  mirrorReadSemaphore_ = runInfo.mirrorReadSemaphore;
 
   meshBuffer_ = runInfo.meshBuffer;
   meshIndexOffset_ = runInfo.meshIndexOffset;
@@ -76,25 +117,67 @@ void VrWorker::loop()
   constexpr auto setCount = 100;
   std::vector<vk::DescriptorPoolSize> poolSizes = {
     {vk::DescriptorType::eUniformBuffer, descriptorCount},
+    {vk::DescriptorType::eUniformBufferDynamic, descriptorCount},
     {vk::DescriptorType::eStorageBuffer, descriptorCount},
+    {vk::DescriptorType::eStorageBufferDynamic, descriptorCount},
     {vk::DescriptorType::eCombinedImageSampler, descriptorCount},
   };
 
-  // VR command buffers
-  constexpr auto imageCount = 3; // TODO: is it fixed?
+  // VR command buffers and uniform regions, reused when the frame scheduler retires the frame of the slot
+  FrameSchedulerCreateInfo frameSchedulerCreateInfo;
+  frameSchedulerCreateInfo.device = device_;
+  frameSchedulerCreateInfo.frameCount = framesInFlight_;
+  frameScheduler_ = createFrameScheduler(frameSchedulerCreateInfo);
+
+  const auto frameCount = frameScheduler_.getFrameCount();
   vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
   commandBufferAllocateInfo
     .setLevel(vk::CommandBufferLevel::ePrimary)
     .setCommandPool(commandPool_)
-    .setCommandBufferCount(imageCount);
+    .setCommandBufferCount(frameCount);
   commandBuffers_ = device_.allocateCommandBuffers(commandBufferAllocateInfo);
 
+  // Timestamps at the beginning and the end of each frame in flight, driving the viewport scale
+  if (physicalDevice_.getQueueFamilyProperties()[queueIndex_].timestampValidBits != 0)
+  {
+    timestampPeriod_ = physicalDevice_.getProperties().limits.timestampPeriod;
+
+    vk::QueryPoolCreateInfo queryPoolCreateInfo;
+    queryPoolCreateInfo
+      .setQueryType(vk::QueryType::eTimestamp)
+      .setQueryCount(frameCount * 2);
+    timestampQueryPool_ = device_.createQueryPool(queryPoolCreateInfo);
+  }
+  timestampWritten_.resize(frameCount, false);
+  frameScales_.resize(frameCount, 1.f);
+
+  UniformAllocatorCreateInfo uniformAllocatorCreateInfo;
+  uniformAllocatorCreateInfo.device = device_;
+  uniformAllocatorCreateInfo.physicalDevice = physicalDevice_;
+  uniformAllocatorCreateInfo.pMemoryPool = pMemoryPool_;
+  uniformAllocatorCreateInfo.frameCount = frameCount;
+  uniformAllocator_ = createUniformAllocator(uniformAllocatorCreateInfo);
+
+  ParallelRecorderCreateInfo parallelRecorderCreateInfo;
+  parallelRecorderCreateInfo.device = device_;
+  parallelRecorderCreateInfo.queueIndex = queueIndex_;
+  parallelRecorderCreateInfo.pJobSystem = pJobSystem_;
+  parallelRecorderCreateInfo.frameCount = frameCount;
+  parallelRecorder_ = createParallelRecorder(parallelRecorderCreateInfo);
+
   vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo;
   descriptorPoolCreateInfo
     .setMaxSets(setCount)
     .setPoolSizes(poolSizes);
   descriptorPool_ = device_.createDescriptorPool(descriptorPoolCreateInfo);
 
+  vkovr::SessionConnectorCreateInfo sessionConnectorCreateInfo;
+  sessionConnectorCreateInfo.backend = backend_;
+  sessionConnector_ = vkovr::createSessionConnector(sessionConnectorCreateInfo);
+
+  FrameArenaCreateInfo frameArenaCreateInfo;
+  frameArena_ = createFrameArena(frameArenaCreateInfo);
+
   using namespace std::chrono_literals;
   using Clock = std::chrono::high_resolution_clock;
   using Duration = std::chrono::duration<double>;
@@ -104,6 +187,8 @@ void VrWorker::loop()
   int64_t recentSeconds = 0;
   const auto startTime = Clock::now();
   Timestamp previousTime = startTime;
+  double previousDisplayTime = 0.;
+  uint64_t frameAllocations = 0;
 
   while (!shouldTerminate_)
   {
@@ -118,84 +203,191 @@ void VrWorker::loop()
     // Check ovr session
     if (session_.opened() && session_.getStatus().ShouldQuit)
     {
+      frameScheduler_.waitIdle();
+
       for (auto& swapchain : swapchains_)
         swapchain.destroy();
       swapchains_.clear();
+      panelSwapchain_.destroy();
+      mirror_.destroy();
+      poseStream_.destroy();
+
+      {
+        // The desktop draws its own scene again
+        std::lock_guard<std::mutex> guard{ mirrorMutex_ };
+        mirrorLatestIndex_ = -1;
+      }
 
       renderPass_.destroy();
 
       for (auto& framebuffer : framebuffers_)
         framebuffer.destroy();
       framebuffers_.clear();
+      multiviewTarget_.destroy();
+
+      for (auto& foveationMap : foveationMaps_)
+        foveationMap.destroy();
+      foveationMaps_.clear();
 
       renderer_.destroy();
 
       session_.destroy();
+      previousDisplayTime = 0.;
     }
 
-    // Create session if not opened
-    bool sessionCreated = false;
-    if (!session_.opened())
+    // Connect in background if not opened, and take the session in the frame it becomes available
+    if (!session_.opened() && !sessionFuture_.valid())
+      sessionFuture_ = sessionConnector_.connect();
+
+    if (!session_.opened() && sessionFuture_.wait_for(0s) == std::future_status::ready)
     {
-      // TODO: try open ovr session in thread. It takes about 0.5s to receive response on failure
       try
       {
-        session_ = vkovr::createSession({});
-        sessionCreated = true;
+        session_ = sessionFuture_.get();
 
         // Check if physical device needs to be changed
         const auto vrPhysicalDevice = session_.getPhysicalDevice(instance_);
         if (vrPhysicalDevice != physicalDevice_)
           throw std::runtime_error("VR device requires another GPU");
 
-        // OVR render pass
+        // OVR render pass, foveated if the device supports fragment density maps
+        const auto foveated = fragmentDensityMap_ && foveationLevel_ != FoveationLevel::Off;
         RenderPassCreateInfo renderPassCreateInfo;
         renderPassCreateInfo.device = device_;
         renderPassCreateInfo.format = vk::Format::eB8G8R8A8Srgb;
         renderPassCreateInfo.samples = vk::SampleCountFlagBits::e4;
-        renderPassCreateInfo.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+        renderPassCreateInfo.finalLayout = multiview_ ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::ePresentSrcKHR;
+        renderPassCreateInfo.viewCount = multiview_ ? 2 : 1;
+        renderPassCreateInfo.fragmentDensityMap = foveated;
+        renderPassCreateInfo.depthResolve = depthResolve_;
         renderPass_ = engine::createRenderPass(renderPassCreateInfo);
 
-        // OVR swapchains, framebuffers and renderers
-        // TODO: use the same pipeline, bind different render pass
+        // OVR swapchains, a single layer per eye
         swapchains_.resize(ovrEye_Count);
-        framebuffers_.resize(ovrEye_Count);
-        for (const auto eye : { ovrEye_Left, ovrEye_Right })
+        for (auto eye : { ovrEye_Left, ovrEye_Right })
         {
           vkovr::SwapchainCreateInfo swapchainCreateInfo;
           swapchainCreateInfo.device = device_;
           swapchainCreateInfo.eye = eye;
+          swapchainCreateInfo.pixelDensity = maxPixelDensity_;
+          swapchainCreateInfo.depth = renderPass_.hasDepthResolve();
           swapchains_[eye] = session_.createSwapchain(swapchainCreateInfo);
+        }
+
+        // Multiview renders to a layered target fitting both eyes, copied to the eye swapchains
+        if (multiview_)
+        {
+          const auto& leftExtent = swapchains_[ovrEye_Left].getExtent();
+          const auto& rightExtent = swapchains_[ovrEye_Right].getExtent();
+
+          MultiviewTargetCreateInfo multiviewTargetCreateInfo;
+          multiviewTargetCreateInfo.device = device_;
+          multiviewTargetCreateInfo.pMemoryPool = pMemoryPool_;
+          multiviewTargetCreateInfo.pRenderPass = &renderPass_;
+          multiviewTargetCreateInfo.width = std::max(leftExtent.width, rightExtent.width);
+          multiviewTargetCreateInfo.height = std::max(leftExtent.height, rightExtent.height);
+          multiviewTarget_ = createMultiviewTarget(multiviewTargetCreateInfo);
+        }
+
+        // Framebuffers and foveation maps, of the multiview target or of each eye
+        // TODO: use the same pipeline, bind different render pass
+        const auto framebufferCount = multiview_ ? 1 : ovrEye_Count;
+        framebuffers_.resize(framebufferCount);
+        if (foveated)
+          foveationMaps_.resize(framebufferCount);
+        for (int i = 0; i < framebufferCount; i++)
+        {
+          const auto extent = multiview_ ? multiviewTarget_.getExtent() : swapchains_[i].getExtent();
+
+          if (foveated)
+          {
+            FoveationMapCreateInfo foveationMapCreateInfo;
+            foveationMapCreateInfo.device = device_;
+            foveationMapCreateInfo.physicalDevice = physicalDevice_;
+            foveationMapCreateInfo.pMemoryPool = pMemoryPool_;
+            foveationMapCreateInfo.width = extent.width;
+            foveationMapCreateInfo.height = extent.height;
+            foveationMapCreateInfo.layerCount = renderPass_.getViewCount();
+            foveationMapCreateInfo.frameCount = frameScheduler_.getFrameCount();
+            foveationMapCreateInfo.level = foveationLevel_;
+            foveationMaps_[i] = engine::createFoveationMap(foveationMapCreateInfo);
+          }
 
-          // Create framebuffers targeting swapchain images
-          const auto& extent = swapchains_[eye].getExtent();
           FramebufferCreateInfo framebufferCreateInfo;
           framebufferCreateInfo.device = device_;
           framebufferCreateInfo.width = extent.width;
           framebufferCreateInfo.height = extent.height;
           framebufferCreateInfo.maxWidth = extent.width;
           framebufferCreateInfo.maxHeight = extent.height;
-          framebufferCreateInfo.colorImageViews = swapchains_[eye].getColorImageViews();
-          framebufferCreateInfo.depthImageViews = swapchains_[eye].getDepthImageViews();
+          if (multiview_)
+          {
+            framebufferCreateInfo.colorImageViews = { multiviewTarget_.getColorImageView() };
+            if (renderPass_.hasDepthResolve())
+              framebufferCreateInfo.depthImageViews = { multiviewTarget_.getDepthImageView() };
+          }
+          else
+          {
+            framebufferCreateInfo.colorImageViews = swapchains_[i].getColorImageViews();
+            framebufferCreateInfo.depthImageViews = swapchains_[i].getDepthImageViews();
+          }
           framebufferCreateInfo.pMemoryPool = pMemoryPool_;
           framebufferCreateInfo.pRenderPass = &renderPass_;
-          framebuffers_[eye] = engine::createFramebuffer(framebufferCreateInfo);
+          if (foveated)
+            framebufferCreateInfo.fragmentDensityMapImageView = foveationMaps_[i].getImageView();
+          framebuffers_[i] = engine::createFramebuffer(framebufferCreateInfo);
         }
 
-        // OVR renderer
-        // TODO: swapchain image count from left eye
-        const auto imageCount = swapchains_[0].getColorImageViews().size();
+        // Panel composited over the scene, below eye level in front of the tracking origin
+        vkovr::SwapchainCreateInfo panelSwapchainCreateInfo;
+        panelSwapchainCreateInfo.device = device_;
+        panelSwapchainCreateInfo.width = 256;
+        panelSwapchainCreateInfo.height = 128;
+        panelSwapchainCreateInfo.depth = false;
+        panelSwapchain_ = session_.createSwapchain(panelSwapchainCreateInfo);
+        panelColor_ = glm::vec3{ -1.f };
+
+        vkovr::Layer panelLayer;
+        panelLayer.type = vkovr::LayerType::Quad;
+        panelLayer.pSwapchain = &panelSwapchain_;
+        panelLayer.pose.Position = { 0.f, -0.5f, -1.f };
+        panelLayer.quadSize = { 0.4f, 0.2f };
+        session_.setLayers({ panelLayer });
+
+        // Input sampled at sensor rate, read without calls into the runtime
+        vkovr::PoseStreamCreateInfo poseStreamCreateInfo;
+        poseStream_ = session_.createPoseStream(poseStreamCreateInfo);
+
+        if (mirrorImages_[0])
+        {
+          vkovr::MirrorCreateInfo mirrorCreateInfo;
+          mirrorCreateInfo.device = device_;
+          mirrorCreateInfo.width = mirrorExtent_.width;
+          mirrorCreateInfo.height = mirrorExtent_.height;
+          mirror_ = session_.createMirror(mirrorCreateInfo);
+        }
+
+        std::cout << "VR worker: " << (multiview_ ? "single-pass multiview" : "two-pass") << " stereo rendering"
+          << (foveated ? ", foveated" : "") << std::endl;
+
+        // OVR renderer, uniforms of both eyes bound to one descriptor set at different offsets
         RendererCreateInfo rendererCreateInfo;
         rendererCreateInfo.device = device_;
         rendererCreateInfo.physicalDevice = physicalDevice_;
         rendererCreateInfo.pRenderPass = &renderPass_;
         rendererCreateInfo.descriptorPool = descriptorPool_;
-        rendererCreateInfo.imageCount = imageCount * 2; // For left/right eye descriptor sets
+        rendererCreateInfo.pipelineCache = pipelineCache_;
         rendererCreateInfo.textureImageView = pTexture_->getImageView();
         rendererCreateInfo.sampler = *pSampler_;
-        rendererCreateInfo.pMemoryPool = pMemoryPool_;
+        rendererCreateInfo.pUniformAllocator = &uniformAllocator_;
+        rendererCreateInfo.shaderDirectory = shaderDirectory_;
         renderer_ = engine::createRenderer(rendererCreateInfo);
 
+        // Viewport scale of the swapchains held within the frame budget of the display
+        const auto refreshRate = session_.getOculusProperties().DisplayRefreshRate;
+        ResolutionControllerCreateInfo resolutionControllerCreateInfo;
+        resolutionControllerCreateInfo.frameBudget = refreshRate > 0.f ? 1. / refreshRate : 1. / 90.;
+        resolutionController_ = createResolutionController(resolutionControllerCreateInfo);
+
         session_.synchronizeWithQueue(queue_);
       }
       catch (const std::exception& e)
@@ -206,44 +398,62 @@ void VrWorker::loop()
 
     if (session_.opened())
     {
+      const auto allocationCount = getThreadAllocationCount();
+      frameArena_.beginFrame();
+
+      // Work independent of eye poses overlaps with the runtime's frame wait
+      const auto vrFrameIndex = frameScheduler_.getFrameIndex();
+      const auto prepareJob = pJobSystem_->submit([this, vrFrameIndex]
+      {
+        // Job threads never block on the device, an unretired slot is left to the vr thread
+        framePrepared_ = frameScheduler_.waitForFrame(0);
+        if (framePrepared_)
+          prepareFrame(vrFrameIndex);
+        frameLight_ = light_.read();
+      });
+
+      // Paced by the runtime, no sleep needed
+      session_.waitFrame();
       session_.beginFrame();
 
-      LightUbo light;
+      pJobSystem_->wait(prepareJob);
+      if (!framePrepared_)
       {
-        std::lock_guard<std::mutex> guard{ lightMutex_ };
-        light = light_;
+        // The submission of the same frame index reads the command buffers and uniform region
+        frameScheduler_.waitForFrame();
+        prepareFrame(vrFrameIndex);
       }
+      const auto& light = frameLight_;
 
-      // Y-up to Z-up
-      glm::mat4 coordinateSystem{ 0.f };
-      coordinateSystem[0][0] = 1.f;
-      coordinateSystem[1][2] = 1.f;
-      coordinateSystem[2][1] = -1.f;
-      coordinateSystem[3][3] = 1.f;
+      // Animation advances by display time
+      const auto displayTime = session_.getPredictedDisplayTime();
+      const auto dt = previousDisplayTime > 0. ? static_cast<float>(std::clamp(displayTime - previousDisplayTime, 0., 0.1)) : 0.f;
+      previousDisplayTime = displayTime;
 
+      const auto coordinateSystem = getCoordinateSystem();
       glm::quat coordinateSystemOrientation{ coordinateSystem };
 
       const auto eyePoses = session_.getEyePoses();
+      std::array<glm::mat4, 2> eyePoseMatrices;
+      for (int i = 0; i < 2; i++)
       {
-        std::lock_guard<std::mutex> guard{ eyeMutex_ };
-        for (int i = 0; i < 2; i++)
-        {
-          const auto& ovrQ = eyePoses[i].Orientation;
-          const auto& ovrP = eyePoses[i].Position;
+        const auto& ovrQ = eyePoses[i].Orientation;
+        const auto& ovrP = eyePoses[i].Position;
 
-          glm::quat q{ ovrQ.w, ovrQ.x, ovrQ.y, ovrQ.z };
-          const glm::vec3 p{ ovrP.x, ovrP.y, ovrP.z };
+        glm::quat q{ ovrQ.w, ovrQ.x, ovrQ.y, ovrQ.z };
+        const glm::vec3 p{ ovrP.x, ovrP.y, ovrP.z };
 
-          eyePoses_[i] = glm::mat3{ q };
-          eyePoses_[i][3] = { p, 1.f };
-          eyePoses_[i] = coordinateSystem * eyePoses_[i];
-        }
+        eyePoseMatrices[i] = glm::mat3{ q };
+        eyePoseMatrices[i][3] = { p, 1.f };
+        eyePoseMatrices[i] = coordinateSystem * eyePoseMatrices[i];
       }
+      eyePoses_.write(eyePoseMatrices);
 
       const auto status = session_.getStatus();
-      if (status.HasInputFocus)
+      vkovr::PoseSample poseSample;
+      if (status.HasInputFocus && poseStream_.getLatestSample(poseSample))
       {
-        const auto input = session_.getInputState();
+        const auto& input = poseSample.inputState;
 
         // Average eye quaternions
         glm::quat qs{ 0.f, 0.f, 0.f, 0.f };
@@ -263,18 +473,19 @@ void VrWorker::loop()
         qs = glm::normalize(qs);
         ps = ps / 2.f;
 
-        auto objectOrientation = engine_->getObjectOrientation();
+        // Owned by this thread, published to the desktop thread
+        auto objectOrientation = objectOrientation_;
 
         constexpr float rotationSpeed = 3.f;
         glm::vec3 v = qs * glm::vec3{ input.Thumbstick[1].x, input.Thumbstick[1].y, 0.f } * rotationSpeed;
         glm::vec3 z = qs * glm::vec3{ 0.f, 0.f, 1.f };
         glm::vec3 w{ glm::cross(z, v) };
         glm::quat dq = 0.5f * glm::quat{ 0.f, w } * objectOrientation;
-        constexpr float dt = 1.f / 72.f; // TODO
         static float animationTime = 0.f;
         animationTime += dt;
         objectOrientation = glm::normalize(objectOrientation + dq * dt);
 
+        objectOrientation_ = objectOrientation;
         engine_->setObjectOrientation(objectOrientation);
         
         objectModel = objectModel * glm::mat4{ objectOrientation };
@@ -283,9 +494,9 @@ void VrWorker::loop()
         objectModel[3][2] = ps.z - 2.f + std::sin(animationTime * 2.f) * 1.f;
       }
 
+      const auto viewportScale = resolutionController_.getScale();
       if (status.IsVisible)
       {
-        const auto vrFrameIndex = session_.getFrameIndex() % 3;
 
         // Draw to vr device
         auto& commandBuffer = commandBuffers_[vrFrameIndex];
@@ -293,114 +504,221 @@ void VrWorker::loop()
         commandBuffer.reset();
         commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
 
-        constexpr auto near = 0.2f;
-        constexpr auto far = 1000.f;
-        for (const auto eye : { ovrEye_Left, ovrEye_Right })
+        if (timestampQueryPool_)
+        {
+          commandBuffer.resetQueryPool(timestampQueryPool_, static_cast<uint32_t>(vrFrameIndex) * 2, 2);
+          commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool_, static_cast<uint32_t>(vrFrameIndex) * 2);
+        }
+        frameScales_[vrFrameIndex] = viewportScale;
+
+        // Density maps centered on the gaze of each eye, or on the lenses
+        for (int i = 0; i < foveationMaps_.size(); i++)
+        {
+          std::array<glm::vec2, ovrEye_Count> centers;
+          const auto layerCount = renderPass_.getViewCount();
+          for (uint32_t layer = 0; layer < layerCount; layer++)
+          {
+            const auto eye = multiview_ ? layer : static_cast<uint32_t>(i);
+            glm::vec2 center;
+            if (!gazeSource_ || !gazeSource_->getGazePoint(eye, center))
+            {
+              const auto lensCenter = swapchains_[eye].getLensCenter();
+              center = { lensCenter.x, lensCenter.y };
+            }
+            centers[layer] = center;
+          }
+          foveationMaps_[i].update(commandBuffer, static_cast<uint32_t>(vrFrameIndex),
+            vk::ArrayProxy<const glm::vec2>(layerCount, centers.data()), viewportScale);
+        }
+
+        // The compositor keeps showing the last committed panel image
+        const glm::vec3 panelColor{ light.lights[0].diffuse };
+        const auto panelChanged = panelColor != panelColor_;
+        if (panelChanged)
         {
-          const auto imageIndex = swapchains_[eye].acquireNextImageIndex();
+          const auto panelImage = panelSwapchain_.getColorImages()[panelSwapchain_.acquireNextImageIndex()];
+
+          vk::ImageMemoryBarrier barrier;
+          barrier
+            .setImage(panelImage)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 })
+            .setOldLayout(vk::ImageLayout::eUndefined)
+            .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setSrcAccessMask({})
+            .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+          commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+            {}, {}, {}, barrier);
+
+          const std::array<float, 4> clearColor{ panelColor.r, panelColor.g, panelColor.b, 1.f };
+          commandBuffer.clearColorImage(panelImage, vk::ImageLayout::eTransferDstOptimal, vk::ClearColorValue{ clearColor },
+            vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
+
+          // Same layout as eye images after their render pass
+          barrier
+            .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setNewLayout(vk::ImageLayout::ePresentSrcKHR)
+            .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask({});
+          commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+            {}, {}, {}, barrier);
+
+          panelColor_ = panelColor;
+        }
 
-          auto projection = session_.getEyeProjection(eye, near, far);
+        // Cameras at poses sampled in beginFrame(), rewritten before submission
+        const auto cameras = getEyeCameras(eyePoses);
+        std::array<uint32_t, ovrEye_Count> cameraOffsets{};
 
-          CameraUbo camera;
-          for (int r = 0; r < 4; r++)
+        renderer_.updateLight(light);
+
+        // Grid of objects drawn with a single instanced draw call
+        std::pmr::vector<glm::mat4> models{ frameArena_.getResource() };
+        models.reserve(100);
+        auto copyModel = objectModel;
+        for (int i = -5; i < 5; i++)
+        {
+          for (int j = 0; j < 10; j++)
           {
-            for (int c = 0; c < 4; c++)
-              camera.projection[c][r] = projection.M[r][c];
+            copyModel[3].x = objectModel[3].x + i;
+            copyModel[3].y = objectModel[3].y + j;
+            models.push_back(copyModel);
           }
+        }
+        const auto instanceCount = static_cast<uint32_t>(models.size());
 
-          // Convert to Vulkan coordinate space
-          for (int c = 0; c < 4; c++)
-            camera.projection[c][1] *= -1.f;
+        if (multiview_)
+        {
+          // Both eyes in one render pass, shaders select the camera with gl_ViewIndex
+          renderer_.updateCamera(getMultiviewCamera(cameras));
+          const auto dynamicOffsets = renderer_.updateUniforms(models);
+          cameraOffsets[0] = dynamicOffsets[0];
+
+          const auto viewportExtent = multiviewTarget_.getViewportExtent(viewportScale);
+          drawScene(commandBuffer, framebuffers_[0].getFramebuffers()[0], viewportExtent, dynamicOffsets, instanceCount);
+
+          // Layers to the eye images, each within its eye's viewport
+          std::array<vk::Image, ovrEye_Count> colorImages;
+          std::array<vk::Image, ovrEye_Count> depthImages;
+          vk::Extent2D copyExtent = viewportExtent;
+          for (const auto eye : { ovrEye_Left, ovrEye_Right })
+          {
+            const auto& swapchain = swapchains_[eye];
+            const auto imageIndex = swapchain.acquireNextImageIndex();
+            colorImages[eye] = swapchain.getColorImages()[imageIndex];
+            if (renderPass_.hasDepthResolve())
+              depthImages[eye] = swapchain.getDepthImages()[imageIndex];
+
+            const auto eyeExtent = swapchain.getViewportExtent(viewportScale);
+            copyExtent.width = std::min(copyExtent.width, eyeExtent.width);
+            copyExtent.height = std::min(copyExtent.height, eyeExtent.height);
+          }
+          multiviewTarget_.copy(commandBuffer, copyExtent, colorImages, depthImages);
+        }
+        else
+        {
+          for (const auto eye : { ovrEye_Left, ovrEye_Right })
+          {
+            const auto imageIndex = swapchains_[eye].acquireNextImageIndex();
 
-          const auto& ovrQuat = eyePoses[eye].Orientation;
-          glm::quat q{ ovrQuat.w, ovrQuat.x, ovrQuat.y, ovrQuat.z };
-          glm::mat3 rot{ q };
-
-          // -Z direction is the forward direction
-          const glm::vec3 forward = glm::mat3{ coordinateSystem } * -rot[2];
-          const glm::vec3 up = glm::mat3{ coordinateSystem } * rot[1];
-
-          const auto& eyePosition = eyePoses[eye].Position;
-          auto eyeVec = glm::vec3{ eyePosition.x, eyePosition.y, eyePosition.z };
-          camera.eye = glm::vec3{ coordinateSystem * glm::vec4{eyeVec, 1.f} };
-          camera.view = glm::lookAt(camera.eye, camera.eye + forward, up);
-
-          // Update uniforms
-          renderer_.updateCamera(camera);
-          renderer_.updateLight(light);
-          renderer_.updateDescriptorSet(imageIndex * 2 + eye);
-
-          // Draw
-          const auto& framebuffer = framebuffers_[eye];
-          const auto& extent = swapchains_[eye].getExtent();
-
-          vk::Rect2D renderArea{ {0u, 0u}, {extent.width, extent.height} };
-
-          constexpr float dt = 1.f / 72.f; // TODO
-          static float animationTime = 0.f;
-          animationTime += dt;
-
-          std::array<float, 4> clearColor = { 0.75f, 0.75f, 0.75f, 1.f };
-          std::vector<vk::ClearValue> clearValues = {
-            vk::ClearColorValue{clearColor},
-            vk::ClearDepthStencilValue{1.f, 0u},
-          };
-
-          vk::RenderPassBeginInfo renderPassBeginInfo;
-          renderPassBeginInfo
-            .setClearValues(clearValues)
-            .setRenderArea(renderArea)
-            .setRenderPass(renderPass_)
-            .setFramebuffer(framebuffer.getFramebuffers()[imageIndex]);
-          commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-
-          commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderer_.getPipeline());
-
-          vk::Viewport viewport{ 0.f, 0.f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.f, 1.f };
-          commandBuffer.setViewport(0, viewport);
-          commandBuffer.setScissor(0, renderArea);
-
-          commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-            renderer_.getPipelineLayout(), 0,
-            renderer_.getDescriptorSets()[imageIndex * 2 + eye], {});
-
-          auto copyModel = objectModel;
-          for (int i = -5; i < 5; i++)
+            renderer_.updateCamera(cameras[eye]);
+            const auto dynamicOffsets = renderer_.updateUniforms(models);
+            cameraOffsets[eye] = dynamicOffsets[0];
+
+            drawScene(commandBuffer, framebuffers_[eye].getFramebuffers()[imageIndex], swapchains_[eye].getViewportExtent(viewportScale),
+              dynamicOffsets, instanceCount);
+          }
+        }
+
+        // Mirror image to write, once the desktop's last copy of it has completed
+        int mirrorIndex = -1;
+        uint64_t mirrorWaitValue = 0;
+        if (mirrorImages_[0])
+        {
           {
-            for (int j = 0; j < 10; j++)
-            {
-              copyModel[3].x = objectModel[3].x + i;
-              copyModel[3].y = objectModel[3].y + j;
-              drawMesh(commandBuffer, renderer_.getPipelineLayout(), copyModel);
-            }
+            std::lock_guard<std::mutex> guard{ mirrorMutex_ };
+            mirrorIndex = 0;
+            while (mirrorIndex == mirrorLatestIndex_ || mirrorIndex == mirrorAcquiredIndex_)
+              mirrorIndex++;
+            mirrorWaitValue = mirrorReadValues_[mirrorIndex];
           }
 
-          commandBuffer.endRenderPass();
+          mirror_.blit(commandBuffer, swapchains_, viewportScale, mirrorImages_[mirrorIndex], vk::ImageLayout::eGeneral, mirrorExtent_);
+        }
+
+        if (timestampQueryPool_)
+        {
+          commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool_, static_cast<uint32_t>(vrFrameIndex) * 2 + 1);
+          timestampWritten_[vrFrameIndex] = true;
         }
 
         commandBuffer.end();
 
-        // Submit command buffers
+        // Late latch: poses sampled again after recording, reported to the compositor by endFrame()
+        const auto latchedCameras = getEyeCameras(session_.latchEyePoses());
+        if (multiview_)
+          renderer_.latchCamera(cameraOffsets[0], getMultiviewCamera(latchedCameras));
+        else
+        {
+          for (const auto eye : { ovrEye_Left, ovrEye_Right })
+            renderer_.latchCamera(cameraOffsets[eye], latchedCameras[eye]);
+        }
+
+        // Submit command buffers, retiring the frame number on completion
+        const auto signalSemaphore = frameScheduler_.getSemaphore();
+        const auto signalValue = frameScheduler_.getFrameNumber();
+        const vk::PipelineStageFlags mirrorWaitStage = vk::PipelineStageFlagBits::eTransfer;
+        const auto waitSemaphoreCount = mirrorIndex >= 0 ? 1u : 0u;
+        vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo;
+        timelineSubmitInfo
+          .setWaitSemaphoreValueCount(waitSemaphoreCount)
+          .setPWaitSemaphoreValues(&mirrorWaitValue)
+          .setSignalSemaphoreValues(signalValue);
+
         vk::SubmitInfo submitInfo;
         submitInfo
-          .setCommandBuffers(commandBuffer);
-        queue_.submit(submitInfo);
+          .setWaitSemaphoreCount(waitSemaphoreCount)
+          .setPWaitSemaphores(&mirrorReadSemaphore_)
+          .setPWaitDstStageMask(&mirrorWaitStage)
+          .setCommandBuffers(commandBuffer)
+          .setSignalSemaphores(signalSemaphore)
+          .setPNext(&timelineSubmitInfo);
+        {
+          std::unique_lock<std::mutex> queueLock;
+          if (pQueueMutex_)
+            queueLock = std::unique_lock<std::mutex>{ *pQueueMutex_ };
+          queue_.submit(submitInfo);
+        }
+        frameScheduler_.endFrame();
+
+        // The desktop copies the image after this frame's timeline value
+        if (mirrorIndex >= 0)
+        {
+          std::lock_guard<std::mutex> guard{ mirrorMutex_ };
+          mirrorLatestIndex_ = mirrorIndex;
+          mirrorLatestValue_ = signalValue;
+        }
 
         for (auto& swapchain : swapchains_)
           swapchain.commit();
+
+        if (panelChanged)
+          panelSwapchain_.commit();
       }
 
-      session_.endFrame(swapchains_);
+      session_.endFrame(swapchains_, viewportScale);
 
       if (status.ShouldRecenter)
         session_.recenter();
+
+      frameAllocations = getThreadAllocationCount() - allocationCount;
     }
 
     else
     {
-      // If session is not opened
-      using namespace std::chrono_literals;
-      std::this_thread::sleep_for(1s);
+      // Poll the connector, responsive to termination
+      std::this_thread::sleep_for(10ms);
     }
 
     while (!deque.empty() && deque.front() < currentTime - 1s)
@@ -411,15 +729,30 @@ void VrWorker::loop()
     if (seconds > recentSeconds)
     {
       const auto fps = deque.size();
-      std::cout << "VR worker: " << fps << std::endl;
+      std::cout << "VR worker: " << fps;
+
+      if (session_.opened())
+      {
+        std::cout << " (viewport scale " << resolutionController_.getScale() << ")";
+
+        if (isAllocationCounterEnabled())
+          std::cout << " (heap allocations " << frameAllocations << ")";
+
+        const auto perfStats = session_.getPerfStats();
+        if (perfStats.FrameStatsCount > 0)
+        {
+          const auto& frameStats = perfStats.FrameStats[0];
+          std::cout << " (motion-to-photon " << frameStats.AppMotionToPhotonLatency * 1000.f << "ms"
+            << ", dropped " << frameStats.AppDroppedFrameCount << ")";
+        }
+      }
+
+      std::cout << std::endl;
 
       recentSeconds = seconds;
     }
 
     previousTime = currentTime;
-
-    // TODO: need a short delay to remove flickering with two rendering thread. What is the best sleep duration?
-    std::this_thread::sleep_for(0.005s);
   }
 
   destroy();
@@ -427,22 +760,71 @@ void VrWorker::loop()
 
 void VrWorker::destroy()
 {
+  // Desktop copies wait on the vr timeline semaphore
+  if (mirrorReadSemaphore_)
+  {
+    std::lock_guard<std::mutex> guard{ mirrorMutex_ };
+    mirrorLatestIndex_ = -1;
+
+    const auto readValue = *std::max_element(mirrorReadValues_.begin(), mirrorReadValues_.end());
+    vk::SemaphoreWaitInfo waitInfo;
+    waitInfo
+      .setSemaphores(mirrorReadSemaphore_)
+      .setValues(readValue);
+    if (device_.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+      throw std::runtime_error("Failed to wait for desktop mirror copies");
+  }
+
+  frameScheduler_.waitIdle();
+  frameScheduler_.destroy();
+
+  if (timestampQueryPool_)
+    device_.destroyQueryPool(timestampQueryPool_);
+  timestampWritten_.clear();
+  frameScales_.clear();
+
+  uniformAllocator_.destroy();
+  parallelRecorder_.destroy();
+
   commandBuffers_.clear();
   device_.destroyCommandPool(commandPool_);
+  frameArena_.destroy();
   device_.destroyDescriptorPool(descriptorPool_);
 
+  // A session connected but not taken yet
+  sessionConnector_.destroy();
+  if (sessionFuture_.valid())
+  {
+    try
+    {
+      auto session = sessionFuture_.get();
+      session.destroy();
+    }
+    catch (const std::exception&)
+    {
+    }
+  }
+
   // Close session
   if (session_.opened())
   {
     for (auto& swapchain : swapchains_)
       swapchain.destroy();
     swapchains_.clear();
+    panelSwapchain_.destroy();
+    mirror_.destroy();
+    poseStream_.destroy();
 
     renderPass_.destroy();
 
     for (auto& framebuffer : framebuffers_)
       framebuffer.destroy();
     framebuffers_.clear();
+    multiviewTarget_.destroy();
+
+    for (auto& foveationMap : foveationMaps_)
+      foveationMap.destroy();
+    foveationMaps_.clear();
 
     renderer_.destroy();
 
@@ -450,26 +832,145 @@ void VrWorker::destroy()
   }
 }
 
+bool VrWorker::acquireMirror(MirrorView& view)
+{
+  std::lock_guard<std::mutex> guard{ mirrorMutex_ };
+  if (mirrorLatestIndex_ < 0)
+    return false;
+
+  mirrorAcquiredIndex_ = mirrorLatestIndex_;
+  view.image = mirrorImages_[mirrorAcquiredIndex_];
+  view.semaphore = frameScheduler_.getSemaphore();
+  view.value = mirrorLatestValue_;
+  return true;
+}
+
+void VrWorker::releaseMirror(uint64_t frameNumber)
+{
+  std::lock_guard<std::mutex> guard{ mirrorMutex_ };
+  mirrorReadValues_[mirrorAcquiredIndex_] = frameNumber;
+  mirrorAcquiredIndex_ = -1;
+}
+
 void VrWorker::terminate()
 {
   shouldTerminate_ = true;
 }
 
-void VrWorker::drawMesh(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, const glm::mat4& model)
+void VrWorker::prepareFrame(uint32_t frameIndex)
 {
-  std::array<float, 16> modelArray;
-  std::memcpy(&modelArray, glm::value_ptr(model), sizeof(modelArray));
+  // GPU time of the frame previously submitted in this slot
+  if (timestampQueryPool_ && timestampWritten_[frameIndex])
+  {
+    std::array<uint64_t, 2> timestamps;
+    const auto queryResult = device_.getQueryPoolResults(timestampQueryPool_, frameIndex * 2, 2,
+      sizeof(timestamps), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (queryResult == vk::Result::eSuccess)
+    {
+      const auto gpuTime = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod_ * 1e-9;
+      resolutionController_.update(gpuTime, frameScales_[frameIndex]);
+    }
+  }
+
+  uniformAllocator_.beginFrame(frameIndex);
+  parallelRecorder_.beginFrame(frameIndex);
+}
+
+void VrWorker::drawScene(vk::CommandBuffer commandBuffer, vk::Framebuffer framebuffer, const vk::Extent2D& extent,
+  const std::array<uint32_t, 3>& dynamicOffsets, uint32_t instanceCount)
+{
+  vk::Rect2D renderArea{ {0u, 0u}, {extent.width, extent.height} };
+
+  std::array<float, 4> clearColor = { 0.75f, 0.75f, 0.75f, 1.f };
+  const std::array<vk::ClearValue, 2> clearValues = {
+    vk::ClearColorValue{clearColor},
+    vk::ClearDepthStencilValue{1.f, 0u},
+  };
+
+  vk::RenderPassBeginInfo renderPassBeginInfo;
+  renderPassBeginInfo
+    .setClearValues(clearValues)
+    .setRenderArea(renderArea)
+    .setRenderPass(renderPass_)
+    .setFramebuffer(framebuffer);
+  commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+
+  vk::Viewport viewport{ 0.f, 0.f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.f, 1.f };
+
+  // Instances split into chunks, recorded in parallel to secondary command buffers
+  vk::CommandBufferInheritanceInfo inheritanceInfo;
+  inheritanceInfo
+    .setRenderPass(renderPass_)
+    .setSubpass(0)
+    .setFramebuffer(framebuffer);
+
+  const auto chunkCount = parallelRecorder_.getChunkCount(instanceCount);
+  const auto& secondaryCommandBuffers = parallelRecorder_.record(inheritanceInfo, chunkCount,
+    [&](vk::CommandBuffer secondaryCommandBuffer, uint32_t chunkIndex)
+    {
+      secondaryCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderer_.getPipeline());
 
-  glm::mat4 modelInverseTranspose = glm::transpose(glm::inverse(model));
-  std::array<float, 16> modelInverseTransposeArray;
-  std::memcpy(&modelInverseTransposeArray, glm::value_ptr(modelInverseTranspose), sizeof(modelInverseTransposeArray));
+      secondaryCommandBuffer.setViewport(0, viewport);
+      secondaryCommandBuffer.setScissor(0, renderArea);
 
-  commandBuffer.pushConstants<float>(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, modelArray);
-  commandBuffer.pushConstants<float>(pipelineLayout, vk::ShaderStageFlagBits::eVertex, sizeof(modelArray), modelInverseTransposeArray);
+      secondaryCommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+        renderer_.getPipelineLayout(), 0,
+        renderer_.getDescriptorSet(), dynamicOffsets);
 
+      const auto firstInstance = instanceCount * chunkIndex / chunkCount;
+      const auto lastInstance = instanceCount * (chunkIndex + 1) / chunkCount;
+      drawMesh(secondaryCommandBuffer, lastInstance - firstInstance, firstInstance);
+    });
+  commandBuffer.executeCommands(secondaryCommandBuffers);
+
+  commandBuffer.endRenderPass();
+}
+
+std::array<CameraUbo, ovrEye_Count> VrWorker::getEyeCameras(const std::array<ovrPosef, ovrEye_Count>& eyePoses)
+{
+  const auto coordinateSystem = getCoordinateSystem();
+
+  constexpr auto near = 0.2f;
+  constexpr auto far = 1000.f;
+  std::array<CameraUbo, ovrEye_Count> cameras;
+  for (const auto eye : { ovrEye_Left, ovrEye_Right })
+  {
+    auto projection = session_.getEyeProjection(eye, near, far);
+
+    CameraUbo camera;
+    for (int r = 0; r < 4; r++)
+    {
+      for (int c = 0; c < 4; c++)
+        camera.projection[c][r] = projection.M[r][c];
+    }
+
+    // Convert to Vulkan coordinate space
+    for (int c = 0; c < 4; c++)
+      camera.projection[c][1] *= -1.f;
+
+    const auto& ovrQuat = eyePoses[eye].Orientation;
+    glm::quat q{ ovrQuat.w, ovrQuat.x, ovrQuat.y, ovrQuat.z };
+    glm::mat3 rot{ q };
+
+    // -Z direction is the forward direction
+    const glm::vec3 forward = glm::mat3{ coordinateSystem } * -rot[2];
+    const glm::vec3 up = glm::mat3{ coordinateSystem } * rot[1];
+
+    const auto& eyePosition = eyePoses[eye].Position;
+    auto eyeVec = glm::vec3{ eyePosition.x, eyePosition.y, eyePosition.z };
+    camera.eye = glm::vec3{ coordinateSystem * glm::vec4{eyeVec, 1.f} };
+    camera.view = glm::lookAt(camera.eye, camera.eye + forward, up);
+
+    cameras[eye] = camera;
+  }
+  return cameras;
+}
+
+void VrWorker::drawMesh(vk::CommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
+{
   commandBuffer.bindVertexBuffers(0, { meshBuffer_ }, { 0 });
   commandBuffer.bindIndexBuffer(meshBuffer_, meshIndexOffset_, vk::IndexType::eUint32);
-  commandBuffer.drawIndexed(meshIndexCount_, 1, 0, 0, 0);
+  commandBuffer.drawIndexed(meshIndexCount_, instanceCount, 0, 0, firstInstance);
 }
 }
 }
@@ -1,9 +1,12 @@
 #ifndef VKOVR_DEMO_VR_WORKER_H_
 #define VKOVR_DEMO_VR_WORKER_H_
 
+#include <array>
 #include <vector>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <future>
 
 #include <vulkan/vulkan.hpp>
 
@@ -13,7 +16,15 @@
 
 #include <vkovr-demo/engine/render_pass.h>
 #include <vkovr-demo/engine/framebuffer.h>
+#include <vkovr-demo/engine/multiview_target.h>
+#include <vkovr-demo/engine/foveation_map.h>
+#include <vkovr-demo/engine/frame_arena.h>
+#include <vkovr-demo/engine/frame_scheduler.h>
 #include <vkovr-demo/engine/renderer.h>
+#include <vkovr-demo/engine/job_system.h>
+#include <vkovr-demo/engine/parallel_recorder.h>
+#include <vkovr-demo/engine/resolution_controller.h>
+#include <vkovr-demo/engine/triple_buffer.h>
 #include <vkovr-demo/engine/ubo/light_ubo.h>
 
 namespace demo
@@ -27,6 +38,17 @@ class Sampler;
 
 class VrWorkerRunInfo;
 
+// Headset view for the desktop, in one of the engine's mirror images
+class MirrorView
+{
+public:
+  vk::Image image;
+
+  // Timeline semaphore and value signaled by the vr frame that wrote the image
+  vk::Semaphore semaphore;
+  uint64_t value = 0;
+};
+
 class VrWorker
 {
 public:
@@ -34,10 +56,15 @@ public:
   explicit VrWorker(Engine* engine);
   ~VrWorker();
 
+  // Called by the desktop thread, never blocks the vr thread
   void updateLight(const LightUbo& light);
-
   std::array<glm::mat4, 2> getEyePoses();
 
+  // Called by the desktop thread before recording a copy of the latest headset view. False if no vr frame has written one.
+  // The vr thread leaves the image alone until releaseMirror() with the desktop frame number whose submission reads it
+  bool acquireMirror(MirrorView& view);
+  void releaseMirror(uint64_t frameNumber);
+
   void run(const VrWorkerRunInfo& runInfo);
   void terminate();
   void join();
@@ -47,7 +74,17 @@ private:
 
   void destroy();
 
-  void drawMesh(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, const glm::mat4& model);
+  // Reads the GPU time of the frame previously in the slot and resets its per-frame resources, once the slot is retired
+  void prepareFrame(uint32_t frameIndex);
+
+  void drawScene(vk::CommandBuffer commandBuffer, vk::Framebuffer framebuffer, const vk::Extent2D& extent,
+    const std::array<uint32_t, 3>& dynamicOffsets, uint32_t instanceCount);
+
+  // View and projection of both eyes at the poses
+  std::array<CameraUbo, ovrEye_Count> getEyeCameras(const std::array<ovrPosef, ovrEye_Count>& eyePoses);
+
+  // Instances read model matrices written with Renderer::updateUniforms()
+  void drawMesh(vk::CommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance);
 
   Engine* const engine_;
 
@@ -61,22 +98,76 @@ private:
   vk::Device device_;
   vk::Queue queue_;
   int queueIndex_ = 0;
+  std::mutex* pQueueMutex_ = nullptr;
   MemoryPool* pMemoryPool_;
+  JobSystem* pJobSystem_ = nullptr;
+  vk::PipelineCache pipelineCache_;
+  std::string shaderDirectory_;
+  std::shared_ptr<vkovr::Backend> backend_;
+  bool multiview_ = false;
+  float maxPixelDensity_ = 1.f;
+  bool fragmentDensityMap_ = false;
+  FoveationLevel foveationLevel_ = FoveationLevel::Off;
+  std::shared_ptr<GazeSource> gazeSource_;
+  bool depthResolve_ = false;
+  uint32_t framesInFlight_ = 3;
 
   // Create by this thread
   vk::CommandPool commandPool_;
   vk::DescriptorPool descriptorPool_;
+  UniformAllocator uniformAllocator_;
+  ParallelRecorder parallelRecorder_;
+  FrameArena frameArena_;
 
   // Ovr
+  vkovr::SessionConnector sessionConnector_;
+  std::future<vkovr::Session> sessionFuture_;
   vkovr::Session session_;
+  vkovr::PoseStream poseStream_;
   std::vector<vkovr::Swapchain> swapchains_;
+
+  // Quad layer showing the color of the first light, rendered and committed only when it changes
+  vkovr::Swapchain panelSwapchain_;
+  glm::vec3 panelColor_{ -1.f };
+
+  // Headset view blitted every frame to a mirror image that is neither the latest one nor acquired by the desktop.
+  // The blit waits on the desktop timeline for the last copy of the image, the desktop's copy for the vr frame writing it
+  std::array<vk::Image, 3> mirrorImages_;
+  vk::Extent2D mirrorExtent_;
+  vk::Semaphore mirrorReadSemaphore_;
+  vkovr::Mirror mirror_;
+  std::mutex mirrorMutex_;
+  int mirrorLatestIndex_ = -1;
+  uint64_t mirrorLatestValue_ = 0;
+  int mirrorAcquiredIndex_ = -1;
+  std::array<uint64_t, 3> mirrorReadValues_{};
   std::vector<vk::CommandBuffer> commandBuffers_;
+  FrameScheduler frameScheduler_;
+
+  // Adaptive resolution
+  ResolutionController resolutionController_;
+  vk::QueryPool timestampQueryPool_;
+  float timestampPeriod_ = 0.f;
+  std::vector<bool> timestampWritten_;
+  std::vector<float> frameScales_;
   RenderPass renderPass_;
+  std::vector<FoveationMap> foveationMaps_;
   std::vector<Framebuffer> framebuffers_;
-  // TODO: create renderer using same pipeline cache
+  MultiviewTarget multiviewTarget_;
   Renderer renderer_;
-  LightUbo light_;
-  std::array<glm::mat4, 2> eyePoses_ = { glm::mat4{1.f}, glm::mat4{1.f} };
+
+  // Rotated with thumbstick input
+  glm::quat objectOrientation_{ 1.f, 0.f, 0.f, 0.f };
+
+  // Exchanged with the desktop thread
+  TripleBuffer<LightUbo> light_;
+  TripleBuffer<std::array<glm::mat4, 2>> eyePoses_{ { glm::mat4{1.f}, glm::mat4{1.f} } };
+
+  // Light of the frame, read by the prepare job
+  LightUbo frameLight_;
+
+  // Whether the prepare job found the slot retired, otherwise the vr thread prepares the frame after waiting for it
+  bool framePrepared_ = false;
 
   // Mesh
   // TODO: use shared mesh with engine
@@ -85,10 +176,6 @@ private:
   vk::DeviceSize meshIndexCount_ = 0;
   Texture* pTexture_ = nullptr;
   Sampler* pSampler_ = nullptr;
-
-  // Synchronizations
-  std::mutex lightMutex_;
-  std::mutex eyeMutex_;
 };
 
 class VrWorkerRunInfo
@@ -99,8 +186,51 @@ public:
   vk::Device device;
   vk::Queue queue;
   int queueIndex;
+
+  // Non-null when the queue is shared with another thread
+  std::mutex* pQueueMutex = nullptr;
+
   MemoryPool* pMemoryPool;
 
+  // Runs chunks of secondary command buffer recording
+  JobSystem* pJobSystem = nullptr;
+
+  // Engine-wide pipeline cache, so that session reconnects reuse compiled pipelines
+  vk::PipelineCache pipelineCache;
+
+  // Shaders compiled into the binary if empty
+  std::string shaderDirectory;
+
+  // LibOVR runtime if null
+  std::shared_ptr<vkovr::Backend> backend;
+
+  // Render both eyes in a single pass, requires multiview device feature enabled
+  bool multiview = false;
+
+  // Swapchains are sized for this density, and frames render at a fraction of it within the GPU frame budget
+  float maxPixelDensity = 1.25f;
+
+  // Foveated rendering with a fragment density map per swapchain, requires the device extension enabled
+  bool fragmentDensityMap = false;
+  FoveationLevel foveationLevel = FoveationLevel::Medium;
+
+  // Foveation centers on the gaze if non-null, otherwise on the lenses
+  std::shared_ptr<GazeSource> gazeSource;
+
+  // Submit depth with the eye layer, resolved from multisampled depth. Requires Vulkan 1.2.
+  // Lets the compositor reproject positionally and synthesize frames when the app falls to half rate
+  bool depthResolve = false;
+
+  // Frames the VR loop records ahead of the GPU, 1 to 4
+  uint32_t framesInFlight = 3;
+
+  // Headset view for the desktop, images kept in general layout. No mirror if null
+  std::array<vk::Image, 3> mirrorImages;
+  vk::Extent2D mirrorExtent;
+
+  // Desktop timeline semaphore, signaled with the frame number of each desktop submission
+  vk::Semaphore mirrorReadSemaphore;
+
   // Mesh
   vk::Buffer meshBuffer;
   vk::DeviceSize meshIndexOffset = 0;
@@ -2,10 +2,27 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main()
+int main(int argc, char** argv)
 {
-  demo::Application application;
+  demo::ApplicationCreateInfo createInfo;
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--mock-hmd")
+      createInfo.mockHmd = true;
+    else if (arg == "--headless")
+      createInfo.headless = true;
+    else if (arg == "--frames" && i + 1 < argc)
+      createInfo.frameCount = std::stoul(argv[++i]);
+    else if (arg == "--shader-dir" && i + 1 < argc)
+      createInfo.shaderDirectory = argv[++i];
+    else if (arg == "--frames-in-flight" && i + 1 < argc)
+      createInfo.framesInFlight = std::stoul(argv[++i]);
+  }
+
+  demo::Application application{ createInfo };
 
   try
   {
@@ -3,14 +3,64 @@ import glob
 import functools
 import operator
 
+def variable_name(filename):
+  # mesh_multiview.vert -> meshMultiviewVert
+  words = filename.replace('.', '_').replace('/', '_').replace('\\', '_').split('_')
+  return words[0] + ''.join(word[:1].upper() + word[1:] for word in words[1:])
+
+def guard_name(filename):
+  return 'VKOVR_DEMO_SHADER_' + filename.replace('.', '_').replace('/', '_').replace('\\', '_').upper() + '_SPV_H_'
+
+def write_header(filename):
+  # Embed SPIR-V words as a constexpr array
+  with open(f'{filename}.spv', 'rb') as f:
+    code = f.read()
+  words = [int.from_bytes(code[i:i + 4], 'little') for i in range(0, len(code), 4)]
+  lines = [', '.join(f'0x{word:08x}' for word in words[i:i + 8]) for i in range(0, len(words), 8)]
+
+  guard = guard_name(filename)
+  with open(f'{filename}.spv.h', 'w', newline='\n') as f:
+    f.write(f'// Generated by compile_shader.py from {filename}, do not edit\n')
+    f.write(f'#ifndef {guard}\n#define {guard}\n\n#include <cstdint>\n\n')
+    f.write('namespace demo\n{\nnamespace shader\n{\n')
+    f.write(f'constexpr uint32_t {variable_name(filename)}[] = {{\n')
+    f.write(''.join(f'  {line},\n' for line in lines))
+    f.write('};\n}\n}\n\n')
+    f.write(f'#endif // {guard}\n')
+
+def write_index(filenames):
+  # Name to code table, looked up by the renderer
+  with open('shaders.h', 'w', newline='\n') as f:
+    f.write('// Generated by compile_shader.py, do not edit\n')
+    f.write('#ifndef VKOVR_DEMO_SHADER_SHADERS_H_\n#define VKOVR_DEMO_SHADER_SHADERS_H_\n\n#include <cstdint>\n#include <cstddef>\n\n')
+    for filename in filenames:
+      f.write(f'#include <vkovr-demo/shader/{filename.replace(os.sep, "/")}.spv.h>\n')
+    f.write('\nnamespace demo\n{\nnamespace shader\n{\n')
+    f.write('struct Spirv\n{\n  const char* name;\n  const uint32_t* code;\n\n  // In bytes\n  size_t size;\n};\n\n')
+    f.write('constexpr Spirv spirvs[] = {\n')
+    for filename in filenames:
+      name = variable_name(filename)
+      f.write(f'  {{ "{filename.replace(os.sep, "/")}", {name}, sizeof({name}) }},\n')
+    f.write('};\n}\n}\n\n#endif // VKOVR_DEMO_SHADER_SHADERS_H_\n')
+
 if __name__ == "__main__":
   extensions = ['vert', 'frag', 'geom', 'tesc', 'tese', 'comp']
   filenames = functools.reduce(operator.add, [glob.glob(f'**/*.{extension}', recursive = True) for extension in extensions])
 
+  # glslc of the Vulkan SDK, found in PATH
+  glslc = 'glslc.exe' if os.name == 'nt' else 'glslc'
+
+  compiled_filenames = []
   for filename in filenames:
     print(f'compiling {filename}:')
-    if os.system(f'glslc.exe {filename} -o {filename}.spv') != 0:
+    if os.system(f'{glslc} {filename} -o {filename}.spv') != 0:
       # delete previously compiled spv file
       print(f'failed to compile shader: {filename}')
-      if os.path.exists(f'{filename}.spv'):
-        os.remove(f'{filename}.spv')
+      for output in [f'{filename}.spv', f'{filename}.spv.h']:
+        if os.path.exists(output):
+          os.remove(output)
+    else:
+      write_header(filename)
+      compiled_filenames.append(filename)
+
+  write_index(sorted(compiled_filenames))
@@ -13,11 +13,11 @@ layout (std140, binding = 0) uniform Camera
   vec3 eye;
 } camera;
 
-layout (push_constant) uniform PushConstants
+// Per-instance model matrices
+layout (std430, binding = 3) readonly buffer Instances
 {
-  mat4 model;
-  mat4 modelInverseTranspose;
-};
+  mat4 models[];
+} instances;
 
 layout (location = 0) out vec3 frag_position;
 layout (location = 1) out vec3 frag_normal;
@@ -25,9 +25,10 @@ layout (location = 2) out vec2 frag_tex_coord;
 
 void main()
 {
+  const mat4 model = instances.models[gl_InstanceIndex];
   const vec4 p = model * vec4(position, 1.f);
   gl_Position = camera.projection * camera.view * p;
   frag_position = p.xyz / p.w;
-  frag_normal = mat3(modelInverseTranspose) * normal;
+  frag_normal = transpose(inverse(mat3(model))) * normal;
   frag_tex_coord = tex_coord;
 }
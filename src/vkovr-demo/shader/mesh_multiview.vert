@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_multiview : require
+
+// Vertex
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 tex_coord;
+
+layout (std140, binding = 0) uniform Camera
+{
+  mat4 projection[2];
+  mat4 view[2];
+  vec3 eye[2];
+} camera;
+
+// Per-instance model matrices
+layout (std430, binding = 3) readonly buffer Instances
+{
+  mat4 models[];
+} instances;
+
+layout (location = 0) out vec3 frag_position;
+layout (location = 1) out vec3 frag_normal;
+layout (location = 2) out vec2 frag_tex_coord;
+
+void main()
+{
+  const mat4 model = instances.models[gl_InstanceIndex];
+  const vec4 p = model * vec4(position, 1.f);
+  gl_Position = camera.projection[gl_ViewIndex] * camera.view[gl_ViewIndex] * p;
+  frag_position = p.xyz / p.w;
+  frag_normal = transpose(inverse(mat3(model))) * normal;
+  frag_tex_coord = tex_coord;
+}
@@ -0,0 +1,89 @@
+#include <vkovr/mirror.h>
+
+#include <array>
+
+#include <vkovr/swapchain.h>
+
+namespace vkovr
+{
+Mirror::Mirror()
+{
+}
+
+Mirror::~Mirror()
+{
+}
+
+void Mirror::blit(vk::CommandBuffer commandBuffer, const std::vector<Swapchain>& swapchains, float viewportScale,
+  vk::Image dstImage, vk::ImageLayout dstLayout, const vk::Extent2D& dstExtent) const
+{
+  const auto dstWidth = static_cast<int32_t>(dstExtent.width);
+  const auto dstHeight = static_cast<int32_t>(dstExtent.height);
+
+  if (mirrorTexture_)
+  {
+    // The runtime keeps the mirror image in transfer src layout
+    vk::ImageBlit region;
+    region
+      .setSrcSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+      .setSrcOffsets({ vk::Offset3D{ 0, 0, 0 }, vk::Offset3D{ static_cast<int32_t>(extent_.width), static_cast<int32_t>(extent_.height), 1 } })
+      .setDstSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+      .setDstOffsets({ vk::Offset3D{ 0, 0, 0 }, vk::Offset3D{ dstWidth, dstHeight, 1 } });
+    commandBuffer.blitImage(image_, vk::ImageLayout::eTransferSrcOptimal, dstImage, dstLayout, region, vk::Filter::eLinear);
+  }
+  else
+  {
+    // Eye images left by the render pass in present layout
+    std::array<vk::ImageMemoryBarrier, ovrEye_Count> barriers;
+    for (auto eye : { ovrEye_Left, ovrEye_Right })
+    {
+      const auto& swapchain = swapchains[eye];
+      barriers[eye]
+        .setImage(swapchain.getColorImages()[swapchain.acquireNextImageIndex()])
+        .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+        .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+        .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 })
+        .setOldLayout(vk::ImageLayout::ePresentSrcKHR)
+        .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+        .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+      {}, {}, {}, barriers);
+
+    // Left eye to the left half, right eye to the right half
+    for (auto eye : { ovrEye_Left, ovrEye_Right })
+    {
+      const auto srcExtent = swapchains[eye].getViewportExtent(viewportScale);
+
+      vk::ImageBlit region;
+      region
+        .setSrcSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+        .setSrcOffsets({ vk::Offset3D{ 0, 0, 0 }, vk::Offset3D{ static_cast<int32_t>(srcExtent.width), static_cast<int32_t>(srcExtent.height), 1 } })
+        .setDstSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+        .setDstOffsets({ vk::Offset3D{ dstWidth * eye / 2, 0, 0 }, vk::Offset3D{ dstWidth * (eye + 1) / 2, dstHeight, 1 } });
+      commandBuffer.blitImage(barriers[eye].image, vk::ImageLayout::eTransferSrcOptimal,
+        dstImage, dstLayout, region, vk::Filter::eLinear);
+    }
+
+    for (auto& barrier : barriers)
+    {
+      barrier
+        .setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+        .setNewLayout(vk::ImageLayout::ePresentSrcKHR)
+        .setSrcAccessMask({})
+        .setDstAccessMask({});
+    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+      {}, {}, {}, barriers);
+  }
+}
+
+void Mirror::destroy()
+{
+  if (mirrorTexture_)
+    session_.getBackend()->destroyMirrorTexture(mirrorTexture_);
+  mirrorTexture_ = nullptr;
+  image_ = nullptr;
+}
+}
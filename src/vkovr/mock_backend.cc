@@ -0,0 +1,524 @@
+#include <vkovr/backend.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// Swapchain handles handed out by the mock backend. LibOVR leaves this type opaque
+struct ovrTextureSwapChainData
+{
+  vk::Device device;
+  std::vector<vk::Image> images;
+  std::vector<vk::DeviceMemory> memories;
+  int currentIndex = 0;
+};
+
+namespace vkovr
+{
+namespace
+{
+vk::Format getVkFormat(ovrTextureFormat format)
+{
+  switch (format)
+  {
+  case OVR_FORMAT_B8G8R8A8_UNORM: return vk::Format::eB8G8R8A8Unorm;
+  case OVR_FORMAT_B8G8R8A8_UNORM_SRGB: return vk::Format::eB8G8R8A8Srgb;
+  case OVR_FORMAT_R8G8B8A8_UNORM: return vk::Format::eR8G8B8A8Unorm;
+  case OVR_FORMAT_R8G8B8A8_UNORM_SRGB: return vk::Format::eR8G8B8A8Srgb;
+  case OVR_FORMAT_D16_UNORM: return vk::Format::eD16Unorm;
+  case OVR_FORMAT_D24_UNORM_S8_UINT: return vk::Format::eD24UnormS8Uint;
+  case OVR_FORMAT_D32_FLOAT: return vk::Format::eD32Sfloat;
+  case OVR_FORMAT_D32_FLOAT_S8X24_UINT: return vk::Format::eD32SfloatS8Uint;
+  default:
+    throw std::runtime_error("Mock backend: unsupported texture swapchain format");
+  }
+}
+
+ovrQuatf multiply(const ovrQuatf& a, const ovrQuatf& b)
+{
+  ovrQuatf q;
+  q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+  q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+  q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+  q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+  return q;
+}
+
+ovrVector3f rotate(const ovrQuatf& q, const ovrVector3f& v)
+{
+  // v' = v + 2w(u x v) + 2u x (u x v), u = (q.x, q.y, q.z)
+  const ovrVector3f t{
+    2.f * (q.y * v.z - q.z * v.y),
+    2.f * (q.z * v.x - q.x * v.z),
+    2.f * (q.x * v.y - q.y * v.x),
+  };
+  return {
+    v.x + q.w * t.x + (q.y * t.z - q.z * t.y),
+    v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+    v.z + q.w * t.z + (q.x * t.y - q.y * t.x),
+  };
+}
+
+ovrPosef transform(const ovrPosef& parent, const ovrPosef& child)
+{
+  ovrPosef pose;
+  pose.Orientation = multiply(parent.Orientation, child.Orientation);
+  const auto p = rotate(parent.Orientation, child.Position);
+  pose.Position = { parent.Position.x + p.x, parent.Position.y + p.y, parent.Position.z + p.z };
+  return pose;
+}
+
+class MockBackend : public Backend
+{
+private:
+  using Clock = std::chrono::steady_clock;
+  using Duration = std::chrono::duration<double>;
+
+public:
+  explicit MockBackend(const MockBackendCreateInfo& createInfo)
+    : createInfo_{ createInfo }
+  {
+  }
+
+  ~MockBackend() override = default;
+
+  bool detect(int timeoutMilliseconds) override
+  {
+    return true;
+  }
+
+  void create() override
+  {
+    std::lock_guard<std::mutex> guard{ mutex_ };
+    startTime_ = Clock::now();
+    vsyncIndex_ = 0;
+    frameIndex_ = 0;
+    frameVsyncIndex_ = 0;
+    beginFrameTime_ = 0.;
+    sensorSampleTime_ = 0.;
+    droppedFrameCount_ = 0;
+    perfStats_ = {};
+    perfStats_.AdaptiveGpuPerformanceScale = 1.f;
+  }
+
+  void destroy() override
+  {
+  }
+
+  ovrSession getSession() const override
+  {
+    return nullptr;
+  }
+
+  ovrHmdDesc getHmdDesc() override
+  {
+    ovrHmdDesc hmdDesc = {};
+    hmdDesc.Type = ovrHmd_Other;
+    std::strncpy(hmdDesc.ProductName, "vkovr mock HMD", sizeof(hmdDesc.ProductName) - 1);
+    std::strncpy(hmdDesc.Manufacturer, "vkovr", sizeof(hmdDesc.Manufacturer) - 1);
+    hmdDesc.AvailableHmdCaps = 0;
+    hmdDesc.DefaultHmdCaps = 0;
+    hmdDesc.AvailableTrackingCaps = ovrTrackingCap_Orientation | ovrTrackingCap_Position;
+    hmdDesc.DefaultTrackingCaps = hmdDesc.AvailableTrackingCaps;
+    for (auto eye : { ovrEye_Left, ovrEye_Right })
+    {
+      hmdDesc.DefaultEyeFov[eye] = getFov();
+      hmdDesc.MaxEyeFov[eye] = getFov();
+    }
+    hmdDesc.Resolution = { static_cast<int>(createInfo_.eyeWidth * 2), static_cast<int>(createInfo_.eyeHeight) };
+    hmdDesc.DisplayRefreshRate = static_cast<float>(createInfo_.refreshRate);
+    return hmdDesc;
+  }
+
+  std::vector<std::string> getInstanceExtensions() override
+  {
+    return {};
+  }
+
+  std::vector<std::string> getDeviceExtensions() override
+  {
+    return {};
+  }
+
+  vk::PhysicalDevice getPhysicalDevice(vk::Instance instance) override
+  {
+    // Same choice as the engine: the first GPU
+    physicalDevice_ = instance.enumeratePhysicalDevices()[0];
+    return physicalDevice_;
+  }
+
+  void setSynchronizationQueue(vk::Queue queue) override
+  {
+  }
+
+  ovrSessionStatus getStatus() override
+  {
+    ovrSessionStatus sessionStatus = {};
+    sessionStatus.IsVisible = ovrTrue;
+    sessionStatus.HmdPresent = ovrTrue;
+    sessionStatus.HmdMounted = ovrTrue;
+    sessionStatus.HasInputFocus = ovrTrue;
+    return sessionStatus;
+  }
+
+  ovrInputState getInputState() override
+  {
+    ovrInputState inputState = {};
+    inputState.TimeInSeconds = now();
+    inputState.ControllerType = ovrControllerType_Touch;
+    return inputState;
+  }
+
+  double getTimeInSeconds() override
+  {
+    return now();
+  }
+
+  ovrTrackingState getTrackingState(double absTime) override
+  {
+    const auto headPose = getHeadPose(absTime);
+
+    ovrTrackingState trackingState = {};
+    trackingState.HeadPose.ThePose = headPose;
+    trackingState.HeadPose.TimeInSeconds = absTime;
+    trackingState.StatusFlags = ovrStatus_OrientationTracked | ovrStatus_PositionTracked;
+
+    // Hands held in front of the body, following the head yaw
+    const ovrVector3f handOffsets[ovrHand_Count] = {
+      { -0.2f, -0.4f, -0.3f },
+      { 0.2f, -0.4f, -0.3f },
+    };
+    for (auto hand : { ovrHand_Left, ovrHand_Right })
+    {
+      ovrPosef handPose;
+      handPose.Orientation = { 0.f, 0.f, 0.f, 1.f };
+      handPose.Position = handOffsets[hand];
+
+      trackingState.HandPoses[hand].ThePose = transform(headPose, handPose);
+      trackingState.HandPoses[hand].TimeInSeconds = absTime;
+      trackingState.HandStatusFlags[hand] = ovrStatus_OrientationTracked | ovrStatus_PositionTracked;
+    }
+
+    trackingState.CalibratedOrigin.Orientation = { 0.f, 0.f, 0.f, 1.f };
+    trackingState.CalibratedOrigin.Position = { 0.f, 0.f, 0.f };
+    return trackingState;
+  }
+
+  ovrPerfStats getPerfStats() override
+  {
+    // Like the runtime, report the frames completed since the previous call
+    std::lock_guard<std::mutex> guard{ mutex_ };
+    const auto perfStats = perfStats_;
+    perfStats_.FrameStatsCount = 0;
+    perfStats_.AnyFrameStatsDropped = ovrFalse;
+    return perfStats;
+  }
+
+  void recenter() override
+  {
+  }
+
+  ovrSizei getFovTextureSize(ovrEyeType eye, const ovrFovPort& fov, float pixelsPerDisplayPixel) override
+  {
+    const auto defaultFov = getFov();
+    const auto scaleX = (fov.LeftTan + fov.RightTan) / (defaultFov.LeftTan + defaultFov.RightTan) * pixelsPerDisplayPixel;
+    const auto scaleY = (fov.UpTan + fov.DownTan) / (defaultFov.UpTan + defaultFov.DownTan) * pixelsPerDisplayPixel;
+    return {
+      static_cast<int>(std::ceil(createInfo_.eyeWidth * scaleX)),
+      static_cast<int>(std::ceil(createInfo_.eyeHeight * scaleY)),
+    };
+  }
+
+  ovrEyeRenderDesc getRenderDesc(ovrEyeType eye, const ovrFovPort& fov) override
+  {
+    ovrEyeRenderDesc renderDesc = {};
+    renderDesc.Eye = eye;
+    renderDesc.Fov = fov;
+    renderDesc.DistortedViewport = { { 0, 0 }, { static_cast<int>(createInfo_.eyeWidth), static_cast<int>(createInfo_.eyeHeight) } };
+    renderDesc.PixelsPerTanAngleAtCenter = {
+      createInfo_.eyeWidth / (fov.LeftTan + fov.RightTan),
+      createInfo_.eyeHeight / (fov.UpTan + fov.DownTan),
+    };
+    renderDesc.HmdToEyePose.Orientation = { 0.f, 0.f, 0.f, 1.f };
+    renderDesc.HmdToEyePose.Position = { (eye == ovrEye_Left ? -0.5f : 0.5f) * createInfo_.ipd, 0.f, 0.f };
+    return renderDesc;
+  }
+
+  ovrMatrix4f getProjection(const ovrFovPort& fov, float near, float far) override
+  {
+    // Right-handed, depth in [0, 1], same as ovrMatrix4f_Projection with ovrProjection_None
+    const auto scaleX = 2.f / (fov.LeftTan + fov.RightTan);
+    const auto offsetX = (fov.LeftTan - fov.RightTan) * scaleX * 0.5f;
+    const auto scaleY = 2.f / (fov.UpTan + fov.DownTan);
+    const auto offsetY = (fov.UpTan - fov.DownTan) * scaleY * 0.5f;
+
+    ovrMatrix4f projection = {};
+    projection.M[0][0] = scaleX;
+    projection.M[0][2] = -offsetX;
+    projection.M[1][1] = scaleY;
+    projection.M[1][2] = offsetY;
+    projection.M[2][2] = far / (near - far);
+    projection.M[2][3] = (far * near) / (near - far);
+    projection.M[3][2] = -1.f;
+    return projection;
+  }
+
+  ovrTimewarpProjectionDesc getTimewarpProjectionDesc(const ovrMatrix4f& projection) override
+  {
+    ovrTimewarpProjectionDesc desc;
+    desc.Projection22 = projection.M[2][2];
+    desc.Projection23 = projection.M[2][3];
+    desc.Projection32 = projection.M[3][2];
+    return desc;
+  }
+
+  void waitToBeginFrame(int64_t frameIndex) override
+  {
+    // One frame per vsync. If the application is late, start right away on the most recent vsync
+    const auto currentVsync = static_cast<int64_t>(std::floor(now() / period()));
+
+    int64_t vsyncIndex;
+    {
+      std::lock_guard<std::mutex> guard{ mutex_ };
+      vsyncIndex_ = std::max(vsyncIndex_ + 1, currentVsync);
+      vsyncIndex = vsyncIndex_;
+    }
+
+    std::this_thread::sleep_until(startTime_ + std::chrono::duration_cast<Clock::duration>(Duration(vsyncIndex * period())));
+
+    std::lock_guard<std::mutex> guard{ mutex_ };
+    frameIndex_ = frameIndex;
+    frameVsyncIndex_ = vsyncIndex + 1;
+  }
+
+  void beginFrame(int64_t frameIndex) override
+  {
+    std::lock_guard<std::mutex> guard{ mutex_ };
+    beginFrameTime_ = now();
+  }
+
+  double getPredictedDisplayTime(int64_t frameIndex) override
+  {
+    std::lock_guard<std::mutex> guard{ mutex_ };
+    return (frameVsyncIndex_ + (frameIndex - frameIndex_)) * period();
+  }
+
+  void getEyePoses(int64_t frameIndex, const ovrPosef hmdToEyePoses[ovrEye_Count], ovrPosef eyePoses[ovrEye_Count], double* sensorSampleTime) override
+  {
+    const auto headPose = getHeadPose(getPredictedDisplayTime(frameIndex));
+    for (auto eye : { ovrEye_Left, ovrEye_Right })
+      eyePoses[eye] = transform(headPose, hmdToEyePoses[eye]);
+
+    const auto sampleTime = now();
+    {
+      std::lock_guard<std::mutex> guard{ mutex_ };
+      sensorSampleTime_ = sampleTime;
+    }
+
+    if (sensorSampleTime)
+      *sensorSampleTime = sampleTime;
+  }
+
+  void endFrame(int64_t frameIndex, ovrLayerHeader const* const* layers, unsigned int layerCount) override
+  {
+    if (layerCount > 0 && layers == nullptr)
+      throw std::runtime_error("Mock backend: null layer list");
+
+    std::lock_guard<std::mutex> guard{ mutex_ };
+
+    const auto endFrameTime = now();
+    const auto displayTime = frameVsyncIndex_ * period();
+
+    // The frame is dropped if it was submitted after its display vsync
+    if (endFrameTime > displayTime)
+      droppedFrameCount_++;
+
+    ovrPerfStatsPerCompositorFrame frameStats = {};
+    frameStats.HmdVsyncIndex = static_cast<int>(frameVsyncIndex_);
+    frameStats.AppFrameIndex = static_cast<int>(frameIndex);
+    frameStats.AppDroppedFrameCount = droppedFrameCount_;
+    frameStats.AppMotionToPhotonLatency = static_cast<float>(displayTime - sensorSampleTime_);
+    frameStats.AppCpuElapsedTime = static_cast<float>(endFrameTime - beginFrameTime_);
+    frameStats.CompositorFrameIndex = static_cast<int>(frameVsyncIndex_);
+    frameStats.CompositorGpuEndToVsyncElapsedTime = static_cast<float>(displayTime - endFrameTime);
+
+    // Most recent frame first
+    if (perfStats_.FrameStatsCount == ovrMaxProvidedFrameStats)
+      perfStats_.AnyFrameStatsDropped = ovrTrue;
+    else
+      perfStats_.FrameStatsCount++;
+
+    for (int i = perfStats_.FrameStatsCount - 1; i > 0; i--)
+      perfStats_.FrameStats[i] = perfStats_.FrameStats[i - 1];
+    perfStats_.FrameStats[0] = frameStats;
+  }
+
+  ovrTextureSwapChain createTextureSwapChain(vk::Device device, const ovrTextureSwapChainDesc& desc) override
+  {
+    if (!physicalDevice_)
+      throw std::runtime_error("Mock backend: getPhysicalDevice() must be called before creating swapchains");
+
+    const auto isDepth = (desc.BindFlags & ovrTextureBind_DX_DepthStencil) != 0;
+    const auto usage = isDepth
+      ? vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst
+      : vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+
+    vk::ImageCreateInfo imageCreateInfo;
+    imageCreateInfo
+      .setImageType(vk::ImageType::e2D)
+      .setFormat(getVkFormat(desc.Format))
+      .setExtent({ static_cast<uint32_t>(desc.Width), static_cast<uint32_t>(desc.Height), 1u })
+      .setMipLevels(desc.MipLevels)
+      .setArrayLayers(desc.ArraySize)
+      .setSamples(static_cast<vk::SampleCountFlagBits>(desc.SampleCount))
+      .setTiling(vk::ImageTiling::eOptimal)
+      .setUsage(usage)
+      .setSharingMode(vk::SharingMode::eExclusive)
+      .setInitialLayout(vk::ImageLayout::eUndefined);
+
+    const auto memoryProperties = physicalDevice_.getMemoryProperties();
+
+    auto swapchain = new ovrTextureSwapChainData;
+    swapchain->device = device;
+    for (int i = 0; i < createInfo_.swapchainLength; i++)
+    {
+      const auto image = device.createImage(imageCreateInfo);
+      const auto requirements = device.getImageMemoryRequirements(image);
+
+      // Prefer device local memory
+      uint32_t memoryTypeIndex = UINT32_MAX;
+      for (uint32_t j = 0; j < memoryProperties.memoryTypeCount; j++)
+      {
+        if (!(requirements.memoryTypeBits & (1u << j)))
+          continue;
+
+        if (memoryTypeIndex == UINT32_MAX ||
+          (memoryProperties.memoryTypes[j].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal))
+        {
+          memoryTypeIndex = j;
+          if (memoryProperties.memoryTypes[j].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal)
+            break;
+        }
+      }
+
+      vk::MemoryAllocateInfo memoryAllocateInfo;
+      memoryAllocateInfo
+        .setAllocationSize(requirements.size)
+        .setMemoryTypeIndex(memoryTypeIndex);
+      const auto memory = device.allocateMemory(memoryAllocateInfo);
+      device.bindImageMemory(image, memory, 0);
+
+      swapchain->images.push_back(image);
+      swapchain->memories.push_back(memory);
+    }
+
+    return swapchain;
+  }
+
+  int getTextureSwapChainLength(ovrTextureSwapChain swapchain) override
+  {
+    return static_cast<int>(swapchain->images.size());
+  }
+
+  vk::Image getTextureSwapChainImage(ovrTextureSwapChain swapchain, int index) override
+  {
+    return swapchain->images[index];
+  }
+
+  int getTextureSwapChainCurrentIndex(ovrTextureSwapChain swapchain) override
+  {
+    return swapchain->currentIndex;
+  }
+
+  void commitTextureSwapChain(ovrTextureSwapChain swapchain) override
+  {
+    swapchain->currentIndex = (swapchain->currentIndex + 1) % static_cast<int>(swapchain->images.size());
+  }
+
+  void destroyTextureSwapChain(ovrTextureSwapChain swapchain) override
+  {
+    if (swapchain == nullptr)
+      return;
+
+    for (auto image : swapchain->images)
+      swapchain->device.destroyImage(image);
+
+    for (auto memory : swapchain->memories)
+      swapchain->device.freeMemory(memory);
+
+    delete swapchain;
+  }
+
+  // No compositor, so mirrors fall back to blitting the eye images
+  ovrMirrorTexture createMirrorTexture(vk::Device device, const ovrMirrorTextureDesc& desc) override
+  {
+    return nullptr;
+  }
+
+  vk::Image getMirrorTextureImage(ovrMirrorTexture mirrorTexture) override
+  {
+    throw std::runtime_error("Mock backend: no mirror texture");
+  }
+
+  void destroyMirrorTexture(ovrMirrorTexture mirrorTexture) override
+  {
+  }
+
+private:
+  double now() const
+  {
+    return Duration(Clock::now() - startTime_).count();
+  }
+
+  double period() const
+  {
+    return 1. / createInfo_.refreshRate;
+  }
+
+  ovrFovPort getFov() const
+  {
+    ovrFovPort fov;
+    fov.UpTan = 1.2f;
+    fov.DownTan = 1.2f;
+    fov.LeftTan = 1.f;
+    fov.RightTan = 1.f;
+    return fov;
+  }
+
+  ovrPosef getHeadPose(double time) const
+  {
+    // Slow yaw oscillation around the standing position
+    constexpr double pi = 3.141592653589793;
+    constexpr double frequency = 0.1;
+    const auto yaw = createInfo_.headYawAmplitude * std::sin(2. * pi * frequency * time);
+
+    ovrPosef pose;
+    pose.Orientation = { 0.f, static_cast<float>(std::sin(yaw / 2.)), 0.f, static_cast<float>(std::cos(yaw / 2.)) };
+    pose.Position = { 0.f, createInfo_.headHeight, 0.f };
+    return pose;
+  }
+
+  const MockBackendCreateInfo createInfo_;
+
+  vk::PhysicalDevice physicalDevice_;
+
+  // Frame timing
+  std::mutex mutex_;
+  Clock::time_point startTime_ = Clock::now();
+  int64_t vsyncIndex_ = 0;
+  int64_t frameIndex_ = 0;
+  int64_t frameVsyncIndex_ = 0;
+  double beginFrameTime_ = 0.;
+  double sensorSampleTime_ = 0.;
+  int droppedFrameCount_ = 0;
+  ovrPerfStats perfStats_{};
+};
+}
+
+std::shared_ptr<Backend> createMockBackend(const MockBackendCreateInfo& createInfo)
+{
+  return std::make_shared<MockBackend>(createInfo);
+}
+}
@@ -0,0 +1,268 @@
+#include <vkovr/backend.h>
+
+#ifndef VKOVR_NO_RUNTIME
+#include <OVR_CAPI.h>
+#include <OVR_CAPI_Vk.h>
+#include <Extras/OVR_CAPI_Util.h>
+#endif
+
+namespace vkovr
+{
+#ifdef VKOVR_NO_RUNTIME
+std::shared_ptr<Backend> createOvrBackend()
+{
+  throw std::runtime_error("Failed to create LibOVR backend, built with VKOVR_NO_RUNTIME");
+}
+#else
+namespace
+{
+std::vector<std::string> splitExtensionNames(const char* extensionNames)
+{
+  std::vector<std::string> extensions = { "" };
+  for (int i = 0; extensionNames[i] != 0; i++)
+  {
+    if (extensionNames[i] == ' ')
+      extensions.emplace_back();
+    else
+      extensions.back().push_back(extensionNames[i]);
+  }
+  return extensions;
+}
+
+class OvrBackend : public Backend
+{
+public:
+  OvrBackend() = default;
+  ~OvrBackend() override = default;
+
+  bool detect(int timeoutMilliseconds) override
+  {
+    const auto result = ovr_Detect(timeoutMilliseconds);
+    return result.IsOculusServiceRunning && result.IsOculusHMDConnected;
+  }
+
+  void create() override
+  {
+    if (!OVR_SUCCESS(ovr_Create(&session_, &luid_)))
+      throw std::runtime_error("Failed to create ovr session");
+
+    // FloorLevel will give tracking poses where the floor height is 0
+    if (!OVR_SUCCESS(ovr_SetTrackingOriginType(session_, ovrTrackingOrigin_FloorLevel)))
+      throw std::runtime_error("Failed to set tracking origin type: floor");
+  }
+
+  void destroy() override
+  {
+    ovr_Destroy(session_);
+    session_ = nullptr;
+  }
+
+  ovrSession getSession() const override
+  {
+    return session_;
+  }
+
+  ovrHmdDesc getHmdDesc() override
+  {
+    return ovr_GetHmdDesc(session_);
+  }
+
+  std::vector<std::string> getInstanceExtensions() override
+  {
+    char extensionNames[4096];
+    uint32_t extensionNamesSize = sizeof(extensionNames);
+
+    if (!OVR_SUCCESS(ovr_GetInstanceExtensionsVk(luid_, extensionNames, &extensionNamesSize)))
+      return {};
+
+    return splitExtensionNames(extensionNames);
+  }
+
+  std::vector<std::string> getDeviceExtensions() override
+  {
+    char extensionNames[4096];
+    uint32_t extensionNamesSize = sizeof(extensionNames);
+
+    if (!OVR_SUCCESS(ovr_GetDeviceExtensionsVk(luid_, extensionNames, &extensionNamesSize)))
+      throw std::runtime_error("Failed to get device extensions, calling ovr_GetDeviceExtensionsVk()");
+
+    return splitExtensionNames(extensionNames);
+  }
+
+  vk::PhysicalDevice getPhysicalDevice(vk::Instance instance) override
+  {
+    VkPhysicalDevice physicalDevice;
+    if (!OVR_SUCCESS(ovr_GetSessionPhysicalDeviceVk(session_, luid_, instance, &physicalDevice)))
+      throw std::runtime_error("Failed to get physical device, calling ovr_GetSessionPhysicalDeviceVk()");
+    return physicalDevice;
+  }
+
+  void setSynchronizationQueue(vk::Queue queue) override
+  {
+    ovr_SetSynchronizationQueueVk(session_, queue);
+  }
+
+  double getTimeInSeconds() override
+  {
+    return ovr_GetTimeInSeconds();
+  }
+
+  ovrSessionStatus getStatus() override
+  {
+    ovrSessionStatus sessionStatus;
+    if (!OVR_SUCCESS(ovr_GetSessionStatus(session_, &sessionStatus)))
+      throw std::runtime_error("Failed to get session status");
+    return sessionStatus;
+  }
+
+  ovrInputState getInputState() override
+  {
+    ovrInputState inputState;
+    if (!OVR_SUCCESS(ovr_GetInputState(session_, ovrControllerType_Active, &inputState)))
+      throw std::runtime_error("Failed to get input state");
+    return inputState;
+  }
+
+  ovrTrackingState getTrackingState(double absTime) override
+  {
+    return ovr_GetTrackingState(session_, absTime, false);
+  }
+
+  ovrPerfStats getPerfStats() override
+  {
+    ovrPerfStats perfStats;
+    if (!OVR_SUCCESS(ovr_GetPerfStats(session_, &perfStats)))
+      throw std::runtime_error("Failed to get perf stats");
+    return perfStats;
+  }
+
+  void recenter() override
+  {
+    if (!OVR_SUCCESS(ovr_RecenterTrackingOrigin(session_)))
+      throw std::runtime_error("Failed to recenter tracking origin");
+  }
+
+  ovrSizei getFovTextureSize(ovrEyeType eye, const ovrFovPort& fov, float pixelsPerDisplayPixel) override
+  {
+    return ovr_GetFovTextureSize(session_, eye, fov, pixelsPerDisplayPixel);
+  }
+
+  ovrEyeRenderDesc getRenderDesc(ovrEyeType eye, const ovrFovPort& fov) override
+  {
+    return ovr_GetRenderDesc(session_, eye, fov);
+  }
+
+  ovrMatrix4f getProjection(const ovrFovPort& fov, float near, float far) override
+  {
+    return ovrMatrix4f_Projection(fov, near, far, ovrProjection_None);
+  }
+
+  ovrTimewarpProjectionDesc getTimewarpProjectionDesc(const ovrMatrix4f& projection) override
+  {
+    return ovrTimewarpProjectionDesc_FromProjection(projection, ovrProjection_None);
+  }
+
+  void waitToBeginFrame(int64_t frameIndex) override
+  {
+    if (!OVR_SUCCESS(ovr_WaitToBeginFrame(session_, frameIndex)))
+      throw std::runtime_error("Failed to wait for begin ovr frame");
+  }
+
+  void beginFrame(int64_t frameIndex) override
+  {
+    if (!OVR_SUCCESS(ovr_BeginFrame(session_, frameIndex)))
+      throw std::runtime_error("Failed to begin ovr frame");
+  }
+
+  double getPredictedDisplayTime(int64_t frameIndex) override
+  {
+    return ovr_GetPredictedDisplayTime(session_, frameIndex);
+  }
+
+  void getEyePoses(int64_t frameIndex, const ovrPosef hmdToEyePoses[ovrEye_Count], ovrPosef eyePoses[ovrEye_Count], double* sensorSampleTime) override
+  {
+    ovr_GetEyePoses(session_, frameIndex, ovrTrue, hmdToEyePoses, eyePoses, sensorSampleTime);
+  }
+
+  void endFrame(int64_t frameIndex, ovrLayerHeader const* const* layers, unsigned int layerCount) override
+  {
+    if (!OVR_SUCCESS(ovr_EndFrame(session_, frameIndex, nullptr, layers, layerCount)))
+      throw std::runtime_error("Failed to submit ovr frame");
+  }
+
+  ovrTextureSwapChain createTextureSwapChain(vk::Device device, const ovrTextureSwapChainDesc& desc) override
+  {
+    ovrTextureSwapChain swapchain;
+    if (!OVR_SUCCESS(ovr_CreateTextureSwapChainVk(session_, device, &desc, &swapchain)))
+      throw std::runtime_error("Failed to create ovr swapchain");
+    return swapchain;
+  }
+
+  int getTextureSwapChainLength(ovrTextureSwapChain swapchain) override
+  {
+    int length;
+    if (!OVR_SUCCESS(ovr_GetTextureSwapChainLength(session_, swapchain, &length)))
+      throw std::runtime_error("Failed to get swapchain length");
+    return length;
+  }
+
+  vk::Image getTextureSwapChainImage(ovrTextureSwapChain swapchain, int index) override
+  {
+    VkImage image;
+    if (!OVR_SUCCESS(ovr_GetTextureSwapChainBufferVk(session_, swapchain, index, &image)))
+      throw std::runtime_error("Failed to get swapchain buffer, calling ovr_GetTextureSwapChainBufferVk()");
+    return image;
+  }
+
+  int getTextureSwapChainCurrentIndex(ovrTextureSwapChain swapchain) override
+  {
+    int index;
+    if (!OVR_SUCCESS(ovr_GetTextureSwapChainCurrentIndex(session_, swapchain, &index)))
+      throw std::runtime_error("Failed to get texture swapchain current index");
+    return index;
+  }
+
+  void commitTextureSwapChain(ovrTextureSwapChain swapchain) override
+  {
+    if (!OVR_SUCCESS(ovr_CommitTextureSwapChain(session_, swapchain)))
+      throw std::runtime_error("Failed to commit ovr swapchain");
+  }
+
+  void destroyTextureSwapChain(ovrTextureSwapChain swapchain) override
+  {
+    ovr_DestroyTextureSwapChain(session_, swapchain);
+  }
+
+  ovrMirrorTexture createMirrorTexture(vk::Device device, const ovrMirrorTextureDesc& desc) override
+  {
+    ovrMirrorTexture mirrorTexture;
+    if (!OVR_SUCCESS(ovr_CreateMirrorTextureWithOptionsVk(session_, device, &desc, &mirrorTexture)))
+      throw std::runtime_error("Failed to create mirror texture, calling ovr_CreateMirrorTextureWithOptionsVk()");
+    return mirrorTexture;
+  }
+
+  vk::Image getMirrorTextureImage(ovrMirrorTexture mirrorTexture) override
+  {
+    VkImage image;
+    if (!OVR_SUCCESS(ovr_GetMirrorTextureBufferVk(session_, mirrorTexture, &image)))
+      throw std::runtime_error("Failed to get mirror texture buffer, calling ovr_GetMirrorTextureBufferVk()");
+    return image;
+  }
+
+  void destroyMirrorTexture(ovrMirrorTexture mirrorTexture) override
+  {
+    ovr_DestroyMirrorTexture(session_, mirrorTexture);
+  }
+
+private:
+  ovrSession session_ = nullptr;
+  ovrGraphicsLuid luid_{};
+};
+}
+
+std::shared_ptr<Backend> createOvrBackend()
+{
+  return std::make_shared<OvrBackend>();
+}
+#endif
+}
@@ -0,0 +1,269 @@
+#include <vkovr/pose_stream.h>
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include <vkovr/backend.h>
+
+namespace vkovr
+{
+namespace
+{
+ovrVector3f lerp(const ovrVector3f& a, const ovrVector3f& b, float t)
+{
+  return {
+    a.x + (b.x - a.x) * t,
+    a.y + (b.y - a.y) * t,
+    a.z + (b.z - a.z) * t,
+  };
+}
+
+// Normalized linear interpolation along the shorter arc, close to slerp between nearby samples
+ovrQuatf nlerp(const ovrQuatf& a, const ovrQuatf& b, float t)
+{
+  const auto dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+  const auto s = dot < 0.f ? -t : t;
+
+  ovrQuatf q{
+    a.x * (1.f - t) + b.x * s,
+    a.y * (1.f - t) + b.y * s,
+    a.z * (1.f - t) + b.z * s,
+    a.w * (1.f - t) + b.w * s,
+  };
+  const auto length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+  q.x /= length;
+  q.y /= length;
+  q.z /= length;
+  q.w /= length;
+  return q;
+}
+
+ovrPoseStatef interpolate(const ovrPoseStatef& a, const ovrPoseStatef& b, float t, double time)
+{
+  ovrPoseStatef result = a;
+  result.ThePose.Orientation = nlerp(a.ThePose.Orientation, b.ThePose.Orientation, t);
+  result.ThePose.Position = lerp(a.ThePose.Position, b.ThePose.Position, t);
+  result.AngularVelocity = lerp(a.AngularVelocity, b.AngularVelocity, t);
+  result.LinearVelocity = lerp(a.LinearVelocity, b.LinearVelocity, t);
+  result.TimeInSeconds = time;
+  return result;
+}
+
+// Constant velocities, angular velocity in tracking origin space
+ovrPoseStatef extrapolate(const ovrPoseStatef& a, float dt, double time)
+{
+  ovrPoseStatef result = a;
+
+  const auto& v = a.LinearVelocity;
+  result.ThePose.Position = { a.ThePose.Position.x + v.x * dt, a.ThePose.Position.y + v.y * dt, a.ThePose.Position.z + v.z * dt };
+
+  const auto& w = a.AngularVelocity;
+  const auto speed = std::sqrt(w.x * w.x + w.y * w.y + w.z * w.z);
+  if (speed > 0.f)
+  {
+    const auto halfAngle = speed * dt / 2.f;
+    const auto s = std::sin(halfAngle) / speed;
+    const ovrQuatf d{ w.x * s, w.y * s, w.z * s, std::cos(halfAngle) };
+    const auto& q = a.ThePose.Orientation;
+    result.ThePose.Orientation = {
+      d.w * q.x + d.x * q.w + d.y * q.z - d.z * q.y,
+      d.w * q.y - d.x * q.z + d.y * q.w + d.z * q.x,
+      d.w * q.z + d.x * q.y - d.y * q.x + d.z * q.w,
+      d.w * q.w - d.x * q.x - d.y * q.y - d.z * q.z,
+    };
+  }
+
+  result.TimeInSeconds = time;
+  return result;
+}
+}
+
+class PoseStream::Impl
+{
+public:
+  explicit Impl(uint32_t capacity)
+    : slots_(std::max(capacity, 2u))
+  {
+  }
+
+  ~Impl()
+  {
+    stop();
+  }
+
+  void start()
+  {
+    thread_ = std::thread([this] { loop(); });
+  }
+
+  void stop()
+  {
+    shouldTerminate_ = true;
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  bool getLatestSample(PoseSample& sample) const
+  {
+    const auto count = count_.load(std::memory_order_acquire);
+    return count > 0 && read(count - 1, sample);
+  }
+
+  bool getSample(double time, PoseSample& sample) const
+  {
+    const auto count = count_.load(std::memory_order_acquire);
+
+    // Walk back from the latest sample to the first one not after the time
+    PoseSample newer;
+    bool hasNewer = false;
+    for (uint64_t i = count; i > 0 && count - i < slots_.size(); i--)
+    {
+      PoseSample older;
+      if (!read(i - 1, older))
+        break;
+
+      if (older.time <= time)
+      {
+        sample = older;
+        if (!hasNewer)
+        {
+          const auto dt = static_cast<float>(std::min(time - older.time, maxExtrapolation_));
+          const auto sampleTime = older.time + dt;
+          sample.time = sampleTime;
+          sample.headPose = extrapolate(older.headPose, dt, sampleTime);
+          for (auto hand : { ovrHand_Left, ovrHand_Right })
+            sample.handPoses[hand] = extrapolate(older.handPoses[hand], dt, sampleTime);
+        }
+        else if (newer.time > older.time)
+        {
+          const auto t = static_cast<float>((time - older.time) / (newer.time - older.time));
+          sample.time = time;
+          sample.headPose = interpolate(older.headPose, newer.headPose, t, time);
+          for (auto hand : { ovrHand_Left, ovrHand_Right })
+            sample.handPoses[hand] = interpolate(older.handPoses[hand], newer.handPoses[hand], t, time);
+        }
+        return true;
+      }
+
+      newer = older;
+      hasNewer = true;
+    }
+
+    // Before the history kept, the oldest sample read
+    if (hasNewer)
+      sample = newer;
+    return hasNewer;
+  }
+
+  std::shared_ptr<Backend> backend_;
+  double frequency_ = 500.;
+  double maxExtrapolation_ = 0.05;
+
+private:
+  // Written by the sampling thread only. The version is odd while the sample is written
+  struct Slot
+  {
+    std::atomic<uint64_t> version{ 0 };
+    PoseSample sample;
+  };
+
+  void loop()
+  {
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1. / frequency_));
+
+    auto nextTime = Clock::now();
+    while (!shouldTerminate_)
+    {
+      PoseSample sample;
+      sample.time = backend_->getTimeInSeconds();
+
+      const auto trackingState = backend_->getTrackingState(sample.time);
+      sample.headPose = trackingState.HeadPose;
+      sample.statusFlags = trackingState.StatusFlags;
+      for (auto hand : { ovrHand_Left, ovrHand_Right })
+      {
+        sample.handPoses[hand] = trackingState.HandPoses[hand];
+        sample.handStatusFlags[hand] = trackingState.HandStatusFlags[hand];
+      }
+      sample.inputState = backend_->getInputState();
+
+      write(sample);
+
+      // Skip periods missed rather than sampling in a burst
+      nextTime = std::max(nextTime + period, Clock::now());
+      std::this_thread::sleep_until(nextTime);
+    }
+  }
+
+  void write(const PoseSample& sample)
+  {
+    const auto index = count_.load(std::memory_order_relaxed);
+    auto& slot = slots_[index % slots_.size()];
+
+    const auto version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = sample;
+    slot.version.store(version + 2, std::memory_order_release);
+
+    count_.store(index + 1, std::memory_order_release);
+  }
+
+  // False if the slot was overwritten by a later sample, while reading or before
+  bool read(uint64_t index, PoseSample& sample) const
+  {
+    const auto& slot = slots_[index % slots_.size()];
+    const auto expectedVersion = 2 * (index / slots_.size() + 1);
+
+    if (slot.version.load(std::memory_order_acquire) != expectedVersion)
+      return false;
+    sample = slot.sample;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.version.load(std::memory_order_relaxed) == expectedVersion;
+  }
+
+  std::vector<Slot> slots_;
+  std::atomic<uint64_t> count_{ 0 };
+  std::thread thread_;
+  std::atomic_bool shouldTerminate_ = false;
+};
+
+PoseStream::PoseStream()
+{
+}
+
+PoseStream::~PoseStream()
+{
+}
+
+void PoseStream::start(std::shared_ptr<Backend> backend, const PoseStreamCreateInfo& createInfo)
+{
+  impl_ = std::make_shared<Impl>(createInfo.capacity);
+  impl_->backend_ = backend;
+  impl_->frequency_ = createInfo.frequency;
+  impl_->maxExtrapolation_ = createInfo.maxExtrapolation;
+  impl_->start();
+}
+
+bool PoseStream::getLatestSample(PoseSample& sample) const
+{
+  return impl_ && impl_->getLatestSample(sample);
+}
+
+bool PoseStream::getSample(double time, PoseSample& sample) const
+{
+  return impl_ && impl_->getSample(time, sample);
+}
+
+void PoseStream::destroy()
+{
+  if (impl_)
+    impl_->stop();
+  impl_ = nullptr;
+}
+}
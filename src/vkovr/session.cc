@@ -1,11 +1,13 @@
 #include <vkovr/session.h>
 
-#include <iostream>
+#include <algorithm>
 
 #include <OVR_CAPI.h>
 #include <OVR_CAPI_Vk.h>
 
 #include <vkovr/swapchain.h>
+#include <vkovr/mirror.h>
+#include <vkovr/pose_stream.h>
 
 namespace vkovr
 {
@@ -17,15 +19,15 @@ Session::~Session() = default;
 
 Session createSession(const SessionCreateInfo& createInfo)
 {
+  auto backend = createInfo.backend;
+  if (backend == nullptr)
+    backend = createOvrBackend();
+
   // Populate session info
   Session session;
-  if (!OVR_SUCCESS(ovr_Create(&session.session_, &session.luid_)))
-    throw std::runtime_error("Failed to create ovr session");
-  session.hmdDesc_ = ovr_GetHmdDesc(session.session_);
-
-  // FloorLevel will give tracking poses where the floor height is 0
-  if (!OVR_SUCCESS(ovr_SetTrackingOriginType(session.session_, ovrTrackingOrigin_FloorLevel)))
-    throw std::runtime_error("Failed to set tracking origin type: floor");
+  backend->create();
+  session.backend_ = backend;
+  session.hmdDesc_ = backend->getHmdDesc();
 
   return session;
 }
@@ -34,11 +36,27 @@ Swapchain Session::createSwapchain(const SwapchainCreateInfo& createInfo)
 {
   const auto eye = createInfo.eye;
   const auto device = createInfo.device;
+  const auto pixelDensity = createInfo.pixelDensity;
+  const auto depth = createInfo.depth;
 
-  const auto ovrExtent = ovr_GetFovTextureSize(session_, eye, hmdDesc_.DefaultEyeFov[eye], 1);
-  const auto extent = vk::Extent2D(ovrExtent.w, ovrExtent.h);
+  // Quad or cylinder layer swapchain
+  const auto layerSwapchain = createInfo.width > 0 && createInfo.height > 0;
+
+  vk::Extent2D extent;
+  ovrVector2f lensCenter{ 0.5f, 0.5f };
+  if (layerSwapchain)
+    extent = vk::Extent2D(createInfo.width, createInfo.height);
+  else
+  {
+    const auto ovrExtent = backend_->getFovTextureSize(eye, hmdDesc_.DefaultEyeFov[eye], pixelDensity);
+    extent = vk::Extent2D(ovrExtent.w, ovrExtent.h);
 
-  // Color
+    // Fov tangents are asymmetric, so the optical axis is off the image center
+    const auto& fov = hmdDesc_.DefaultEyeFov[eye];
+    lensCenter = { fov.LeftTan / (fov.LeftTan + fov.RightTan), fov.UpTan / (fov.UpTan + fov.DownTan) };
+  }
+
+  // Color. The runtime only accepts a single array layer
   ovrTextureSwapChainDesc colorDesc = {};
   colorDesc.Type = ovrTexture_2D;
   colorDesc.ArraySize = 1;
@@ -51,52 +69,38 @@ Swapchain Session::createSwapchain(const SwapchainCreateInfo& createInfo)
   colorDesc.BindFlags = ovrTextureBind_DX_RenderTarget;
   colorDesc.StaticImage = ovrFalse;
 
-  ovrTextureSwapChain colorSwapchain;
-  if (!OVR_SUCCESS(ovr_CreateTextureSwapChainVk(session_, device, &colorDesc, &colorSwapchain)))
-    throw std::runtime_error("Failed to create ovr color swapchain");
+  const auto colorSwapchain = backend_->createTextureSwapChain(device, colorDesc);
 
   // Depth
-  ovrTextureSwapChainDesc depthDesc = {};
-  depthDesc.Type = ovrTexture_2D;
-  depthDesc.ArraySize = 1;
-  depthDesc.Format = OVR_FORMAT_D24_UNORM_S8_UINT;
-  depthDesc.Width = extent.width;
-  depthDesc.Height = extent.height;
-  depthDesc.MipLevels = 1;
-  depthDesc.SampleCount = 1;
-  depthDesc.MiscFlags = ovrTextureMisc_DX_Typeless;
-  depthDesc.BindFlags = ovrTextureBind_DX_DepthStencil;
-  depthDesc.StaticImage = ovrFalse;
-
-  ovrTextureSwapChain depthSwapchain;
-  if (!OVR_SUCCESS(ovr_CreateTextureSwapChainVk(session_, device, &depthDesc, &depthSwapchain)))
-    throw std::runtime_error("Failed to create ovr depth swapchain");
-
-  int colorImageCount;
-  if (!OVR_SUCCESS(ovr_GetTextureSwapChainLength(session_, colorSwapchain, &colorImageCount)))
-    throw std::runtime_error("Failed to get color swapchain length");
-
-  int depthImageCount;
-  if (!OVR_SUCCESS(ovr_GetTextureSwapChainLength(session_, depthSwapchain, &depthImageCount)))
-    throw std::runtime_error("Failed to get depth swapchain length");
-
-  if (colorImageCount != depthImageCount)
+  ovrTextureSwapChain depthSwapchain = nullptr;
+  if (depth)
+  {
+    ovrTextureSwapChainDesc depthDesc = {};
+    depthDesc.Type = ovrTexture_2D;
+    depthDesc.ArraySize = 1;
+    depthDesc.Format = OVR_FORMAT_D24_UNORM_S8_UINT;
+    depthDesc.Width = extent.width;
+    depthDesc.Height = extent.height;
+    depthDesc.MipLevels = 1;
+    depthDesc.SampleCount = 1;
+    depthDesc.MiscFlags = ovrTextureMisc_DX_Typeless;
+    depthDesc.BindFlags = ovrTextureBind_DX_DepthStencil;
+    depthDesc.StaticImage = ovrFalse;
+
+    depthSwapchain = backend_->createTextureSwapChain(device, depthDesc);
+  }
+
+  const auto colorImageCount = backend_->getTextureSwapChainLength(colorSwapchain);
+  if (depth && colorImageCount != backend_->getTextureSwapChainLength(depthSwapchain))
     throw std::runtime_error("Assert: colorImageCount != depthImageCount");
 
   std::vector<vk::Image> colorImages;
   std::vector<vk::Image> depthImages;
   for (int i = 0; i < colorImageCount; i++)
   {
-    VkImage colorImage;
-    if (!OVR_SUCCESS(ovr_GetTextureSwapChainBufferVk(session_, colorSwapchain, i, &colorImage)))
-      throw std::runtime_error("Failed to get color swapchain buffer, calling ovr_GetTextureSwapChainBufferVk()");
-
-    VkImage depthImage;
-    if (!OVR_SUCCESS(ovr_GetTextureSwapChainBufferVk(session_, depthSwapchain, i, &depthImage)))
-      throw std::runtime_error("Failed to get depth swapchain buffer, calling ovr_GetTextureSwapChainBufferVk()");
-
-    colorImages.push_back(colorImage);
-    depthImages.push_back(depthImage);
+    colorImages.push_back(backend_->getTextureSwapChainImage(colorSwapchain, i));
+    if (depth)
+      depthImages.push_back(backend_->getTextureSwapChainImage(depthSwapchain, i));
   }
 
   std::vector<vk::ImageView> colorImageViews;
@@ -110,23 +114,24 @@ Swapchain Session::createSwapchain(const SwapchainCreateInfo& createInfo)
       .setFormat(vk::Format::eB8G8R8A8Srgb)
       .setComponents({})
       .setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
-    const auto colorImageView = device.createImageView(imageViewCreateInfo);
+    colorImageViews.push_back(device.createImageView(imageViewCreateInfo));
 
     // Depth
-    imageViewCreateInfo
-      .setImage(depthImages[i])
-      .setFormat(vk::Format::eD24UnormS8Uint)
-      .setSubresourceRange({ vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 });
-    const auto depthImageView = device.createImageView(imageViewCreateInfo);
-
-    colorImageViews.push_back(colorImageView);
-    depthImageViews.push_back(depthImageView);
+    if (depth)
+    {
+      imageViewCreateInfo
+        .setImage(depthImages[i])
+        .setFormat(vk::Format::eD24UnormS8Uint)
+        .setSubresourceRange({ vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 });
+      depthImageViews.push_back(device.createImageView(imageViewCreateInfo));
+    }
   }
 
   Swapchain swapchain;
   swapchain.session_ = *this;
   swapchain.device_ = device;
   swapchain.extent_ = extent;
+  swapchain.lensCenter_ = lensCenter;
   swapchain.colorSwapchain_ = colorSwapchain;
   swapchain.depthSwapchain_ = depthSwapchain;
   swapchain.colorImages_ = colorImages;
@@ -136,129 +141,128 @@ Swapchain Session::createSwapchain(const SwapchainCreateInfo& createInfo)
   return swapchain;
 }
 
+Mirror Session::createMirror(const MirrorCreateInfo& createInfo)
+{
+  ovrMirrorTextureDesc desc = {};
+  desc.Format = OVR_FORMAT_B8G8R8A8_UNORM_SRGB;
+  desc.Width = createInfo.width;
+  desc.Height = createInfo.height;
+  desc.MiscFlags = ovrTextureMisc_None;
+  desc.MirrorOptions = ovrMirrorOption_Default;
+
+  const auto mirrorTexture = backend_->createMirrorTexture(createInfo.device, desc);
+
+  Mirror mirror;
+  mirror.session_ = *this;
+  mirror.extent_ = vk::Extent2D{ createInfo.width, createInfo.height };
+  mirror.mirrorTexture_ = mirrorTexture;
+  if (mirrorTexture)
+    mirror.image_ = backend_->getMirrorTextureImage(mirrorTexture);
+  return mirror;
+}
+
+PoseStream Session::createPoseStream(const PoseStreamCreateInfo& createInfo)
+{
+  PoseStream poseStream;
+  poseStream.start(backend_, createInfo);
+  return poseStream;
+}
+
 bool Session::opened()
 {
-  return session_ != nullptr;
+  return backend_ != nullptr;
 }
 
 ovrSessionStatus Session::getStatus() const
 {
-  ovrSessionStatus sessionStatus;
-  if (!OVR_SUCCESS(ovr_GetSessionStatus(session_, &sessionStatus)))
-    throw std::runtime_error("Failed to get session status");
-  return sessionStatus;
+  return backend_->getStatus();
 }
 
 ovrInputState Session::getInputState() const
 {
-  ovrInputState inputState;
-  if (!OVR_SUCCESS(ovr_GetInputState(session_, ovrControllerType_Active, &inputState)))
-    throw std::runtime_error("Failed to get input state");
-  return inputState;
+  return backend_->getInputState();
 }
 
-std::vector<std::string> Session::getInstanceExtensions()
+ovrPerfStats Session::getPerfStats() const
 {
-  char extensionNames[4096];
-  uint32_t extensionNamesSize = sizeof(extensionNames);
-
-  if (!OVR_SUCCESS(ovr_GetInstanceExtensionsVk(luid_, extensionNames, &extensionNamesSize)))
-    return {};
-
-  std::vector<std::string> extensions = { "" };
-  for (int i = 0; extensionNames[i] != 0; i++)
-  {
-    if (extensionNames[i] == ' ')
-      extensions.emplace_back();
-    else
-      extensions.back().push_back(extensionNames[i]);
-  }
+  return backend_->getPerfStats();
+}
 
-  return extensions;
+std::vector<std::string> Session::getInstanceExtensions()
+{
+  return backend_->getInstanceExtensions();
 }
 
 vk::PhysicalDevice Session::getPhysicalDevice(vk::Instance instance)
 {
-  VkPhysicalDevice physicalDevice;
-  if (!OVR_SUCCESS(ovr_GetSessionPhysicalDeviceVk(session_, luid_, instance, &physicalDevice)))
-    throw std::runtime_error("Failed to get physical device, calling ovr_GetSessionPhysicalDeviceVk()");
-  return physicalDevice;
+  return backend_->getPhysicalDevice(instance);
 }
 
 std::vector<std::string> Session::getDeviceExtensions()
 {
-  char extensionNames[4096];
-  uint32_t extensionNamesSize = sizeof(extensionNames);
-
-  if (!OVR_SUCCESS(ovr_GetDeviceExtensionsVk(luid_, extensionNames, &extensionNamesSize)))
-    throw std::runtime_error("Failed to get device extensions, calling ovr_GetDeviceExtensionsVk()");
-
-  std::vector<std::string> extensions = { "" };
-  for (int i = 0; extensionNames[i] != 0; i++)
-  {
-    if (extensionNames[i] == ' ')
-      extensions.emplace_back();
-    else
-      extensions.back().push_back(extensionNames[i]);
-  }
-
-  return extensions;
+  return backend_->getDeviceExtensions();
 }
 
 void Session::synchronizeWithQueue(vk::Queue queue)
 {
-  ovr_SetSynchronizationQueueVk(session_, queue);
+  backend_->setSynchronizationQueue(queue);
 }
 
-std::vector<ovrPosef> Session::getEyePoses()
+std::array<ovrPosef, ovrEye_Count> Session::getEyePoses() const
 {
   return eyeRenderPoses_;
 }
 
-void Session::getTouchPoses()
-{
-  const auto trackingState = ovr_GetTrackingState(session_, hmdFrameTiming_, false);
-  const auto& p = trackingState.HandPoses[ovrHand_Left].ThePose.Position;
-
-  const auto input = getInputState();
-  std::cout << std::boolalpha << static_cast<bool>(input.ControllerType & ovrControllerType_LTouch) << ' '
-    << p.x << ' ' << p.y << ' ' << p.z << std::endl;
-}
-
 ovrMatrix4f Session::getEyeProjection(ovrEyeType eye, float near, float far)
 {
-  auto projection = ovrMatrix4f_Projection(hmdDesc_.DefaultEyeFov[eye], near, far, ovrProjection_None);
-  posTimewarpProjectionDesc_ = ovrTimewarpProjectionDesc_FromProjection(projection, ovrProjection_None);
+  auto projection = backend_->getProjection(hmdDesc_.DefaultEyeFov[eye], near, far);
+  posTimewarpProjectionDesc_ = backend_->getTimewarpProjectionDesc(projection);
   return projection;
 }
 
-void Session::beginFrame()
+void Session::waitFrame()
 {
   frameIndex_++;
+  backend_->waitToBeginFrame(frameIndex_);
+  frameWaited_ = true;
+}
 
-  if (!OVR_SUCCESS(ovr_WaitToBeginFrame(session_, frameIndex_)))
-    throw std::runtime_error("Failed to wait for begin ovr frame");
+void Session::beginFrame()
+{
+  if (!frameWaited_)
+    waitFrame();
+  frameWaited_ = false;
 
-  if (!OVR_SUCCESS(ovr_BeginFrame(session_, frameIndex_)))
-    throw std::runtime_error("Failed to begin ovr frame");
+  backend_->beginFrame(frameIndex_);
 
-  hmdFrameTiming_ = ovr_GetPredictedDisplayTime(session_, frameIndex_);
+  hmdFrameTiming_ = backend_->getPredictedDisplayTime(frameIndex_);
 
   ovrEyeRenderDesc eyeRenderDescs[ovrEye_Count];
   for (auto eye : { ovrEye_Left, ovrEye_Right })
-    eyeRenderDescs[eye] = ovr_GetRenderDesc(session_, eye, hmdDesc_.DefaultEyeFov[eye]);
+    eyeRenderDescs[eye] = backend_->getRenderDesc(eye, hmdDesc_.DefaultEyeFov[eye]);
 
-  ovrPosef hmdToEyePoses[ovrEye_Count] = {
-    eyeRenderDescs[ovrEye_Left].HmdToEyePose,
-    eyeRenderDescs[ovrEye_Right].HmdToEyePose
-  };
-  std::vector<ovrPosef> eyeRenderPoses(ovrEye_Count);
-  ovr_GetEyePoses(session_, frameIndex_, ovrTrue, hmdToEyePoses, &eyeRenderPoses[0], &sensorSampleTime_);
+  for (auto eye : { ovrEye_Left, ovrEye_Right })
+    hmdToEyePoses_[eye] = eyeRenderDescs[eye].HmdToEyePose;
 
-  eyeRenderPoses_ = eyeRenderPoses;
+  backend_->getEyePoses(frameIndex_, hmdToEyePoses_, eyeRenderPoses_.data(), &sensorSampleTime_);
 }
 
-void Session::endFrame(const std::vector<Swapchain>& swapchains)
+std::array<ovrPosef, ovrEye_Count> Session::latchEyePoses()
+{
+  backend_->getEyePoses(frameIndex_, hmdToEyePoses_, eyeRenderPoses_.data(), &sensorSampleTime_);
+  return eyeRenderPoses_;
+}
+
+void Session::setLayers(const std::vector<Layer>& layers)
+{
+  // The eye layer is submitted first
+  if (layers.size() >= ovrMaxLayerCount)
+    throw std::runtime_error("Failed to set layers, exceeding max layer count");
+
+  layers_ = layers;
+}
+
+void Session::endFrame(const std::vector<Swapchain>& swapchains, float viewportScale)
 {
   ovrLayerEyeFovDepth ld = {};
   ld.Header.Type = ovrLayerType_EyeFovDepth;
@@ -268,28 +272,81 @@ void Session::endFrame(const std::vector<Swapchain>& swapchains)
 
   for (auto eye : { ovrEye_Left, ovrEye_Right })
   {
-    const auto& extent = swapchains[eye].getExtent();
-    ld.ColorTexture[eye] = swapchains[eye].getColorSwapchain();
-    ld.DepthTexture[eye] = swapchains[eye].getDepthSwapchain();
+    const auto& swapchain = swapchains[eye];
+
+    const auto extent = swapchain.getViewportExtent(viewportScale);
+    ld.ColorTexture[eye] = swapchain.getColorSwapchain();
+    ld.DepthTexture[eye] = swapchain.getDepthSwapchain();
     ld.Viewport[eye] = { 0, 0, static_cast<int>(extent.width), static_cast<int>(extent.height) };
     ld.Fov[eye] = hmdDesc_.DefaultEyeFov[eye];
     ld.RenderPose[eye] = eyeRenderPoses_[eye];
   }
 
-  ovrLayerHeader* layers = &ld.Header;
-  if (!OVR_SUCCESS(ovr_EndFrame(session_, frameIndex_, nullptr, &layers, 1)))
-    throw std::runtime_error("Failed to submit ovr frame");
+  // ovrLayerEyeFov is a prefix of ovrLayerEyeFovDepth. Without depth the compositor reprojects rotation only
+  if (!ld.DepthTexture[ovrEye_Left])
+    ld.Header.Type = ovrLayerType_EyeFov;
+
+  // Fixed arrays, so that a frame does not allocate
+  std::array<ovrLayerQuad, ovrMaxLayerCount> quads;
+  std::array<ovrLayerCylinder, ovrMaxLayerCount> cylinders;
+  std::array<ovrLayerHeader*, ovrMaxLayerCount> layers;
+  uint32_t quadCount = 0;
+  uint32_t cylinderCount = 0;
+  uint32_t layerCount = 0;
+
+  layers[layerCount++] = &ld.Header;
+  for (const auto& layer : layers_)
+  {
+    const auto& swapchain = *layer.pSwapchain;
+    const auto& extent = swapchain.getExtent();
+    const ovrRecti viewport{ { 0, 0 }, { static_cast<int>(extent.width), static_cast<int>(extent.height) } };
+    const unsigned flags = ovrLayerFlag_HighQuality | (layer.headLocked ? ovrLayerFlag_HeadLocked : 0);
+
+    switch (layer.type)
+    {
+    case LayerType::Quad:
+    {
+      auto& quad = quads[quadCount++];
+      quad = {};
+      quad.Header.Type = ovrLayerType_Quad;
+      quad.Header.Flags = flags;
+      quad.ColorTexture = swapchain.getColorSwapchain();
+      quad.Viewport = viewport;
+      quad.QuadPoseCenter = layer.pose;
+      quad.QuadSize = layer.quadSize;
+      layers[layerCount++] = &quad.Header;
+      break;
+    }
+
+    case LayerType::Cylinder:
+    {
+      auto& cylinder = cylinders[cylinderCount++];
+      cylinder = {};
+      cylinder.Header.Type = ovrLayerType_Cylinder;
+      cylinder.Header.Flags = flags;
+      cylinder.ColorTexture = swapchain.getColorSwapchain();
+      cylinder.Viewport = viewport;
+      cylinder.CylinderPoseCenter = layer.pose;
+      cylinder.CylinderRadius = layer.cylinderRadius;
+      cylinder.CylinderAngle = layer.cylinderAngle;
+      cylinder.CylinderAspectRatio = layer.cylinderAspectRatio;
+      layers[layerCount++] = &cylinder.Header;
+      break;
+    }
+    }
+  }
+
+  backend_->endFrame(frameIndex_, layers.data(), layerCount);
 }
 
 void Session::recenter()
 {
-  if (!OVR_SUCCESS(ovr_RecenterTrackingOrigin(session_)))
-    throw std::runtime_error("Failed to recenter tracking origin");
+  backend_->recenter();
 }
 
 void Session::destroy()
 {
-  ovr_Destroy(session_);
-  session_ = nullptr;
+  backend_->destroy();
+  backend_ = nullptr;
 }
 }
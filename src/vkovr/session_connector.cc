@@ -0,0 +1,142 @@
+#include <vkovr/session_connector.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace vkovr
+{
+class SessionConnector::Impl
+{
+public:
+  Impl() = default;
+
+  ~Impl()
+  {
+    stop();
+  }
+
+  std::future<Session> connect()
+  {
+    std::lock_guard<std::mutex> guard{ mutex_ };
+    if (pending_)
+      throw std::runtime_error("Failed to connect session: a connection is pending");
+
+    pending_ = true;
+    promise_ = std::promise<Session>();
+    auto future = promise_.get_future();
+    condition_.notify_one();
+    return future;
+  }
+
+  void start()
+  {
+    thread_ = std::thread([this] { loop(); });
+  }
+
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> guard{ mutex_ };
+      if (shouldTerminate_)
+        return;
+      shouldTerminate_ = true;
+    }
+    condition_.notify_one();
+
+    if (thread_.joinable())
+      thread_.join();
+
+    if (pending_)
+      promise_.set_exception(std::make_exception_ptr(std::runtime_error("Failed to connect session: connector destroyed")));
+    pending_ = false;
+  }
+
+  std::shared_ptr<Backend> backend_;
+  std::chrono::milliseconds retryInterval_{ 100 };
+
+private:
+  void loop()
+  {
+    std::unique_lock<std::mutex> lock{ mutex_ };
+    while (true)
+    {
+      condition_.wait(lock, [this] { return shouldTerminate_ || pending_; });
+      if (shouldTerminate_)
+        break;
+
+      // The runtime calls block for up to a second on failure, without the lock
+      lock.unlock();
+      Session session;
+      bool created = false;
+      if (backend_->detect(0))
+      {
+        try
+        {
+          SessionCreateInfo sessionCreateInfo;
+          sessionCreateInfo.backend = backend_;
+          session = createSession(sessionCreateInfo);
+          created = true;
+        }
+        catch (const std::exception&)
+        {
+        }
+      }
+      lock.lock();
+
+      if (created)
+      {
+        if (shouldTerminate_)
+        {
+          session.destroy();
+          break;
+        }
+
+        promise_.set_value(session);
+        pending_ = false;
+      }
+      else
+        condition_.wait_for(lock, retryInterval_, [this] { return shouldTerminate_; });
+    }
+  }
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool shouldTerminate_ = false;
+  bool pending_ = false;
+  std::promise<Session> promise_;
+};
+
+SessionConnector createSessionConnector(const SessionConnectorCreateInfo& createInfo)
+{
+  auto impl = std::make_shared<SessionConnector::Impl>();
+  impl->backend_ = createInfo.backend != nullptr ? createInfo.backend : createOvrBackend();
+  impl->retryInterval_ = createInfo.retryInterval;
+  impl->start();
+
+  SessionConnector connector;
+  connector.impl_ = impl;
+  return connector;
+}
+
+SessionConnector::SessionConnector()
+{
+}
+
+SessionConnector::~SessionConnector()
+{
+}
+
+std::future<Session> SessionConnector::connect()
+{
+  return impl_->connect();
+}
+
+void SessionConnector::destroy()
+{
+  if (impl_)
+    impl_->stop();
+  impl_ = nullptr;
+}
+}
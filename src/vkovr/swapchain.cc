@@ -1,6 +1,7 @@
 #include <vkovr/swapchain.h>
 
 #include <iostream>
+#include <algorithm>
 
 namespace vkovr
 {
@@ -12,27 +13,38 @@ Swapchain::~Swapchain()
 {
 }
 
-int Swapchain::acquireNextImageIndex()
+vk::Extent2D Swapchain::getViewportExtent(float viewportScale) const
 {
-  int index;
-  if (!OVR_SUCCESS(ovr_GetTextureSwapChainCurrentIndex(session_, colorSwapchain_, &index)))
-    throw std::runtime_error("Failed to get texture swapchain current index");
-  return index;
+  const auto scale = std::clamp(viewportScale, 0.f, 1.f);
+  return vk::Extent2D{
+    std::max(static_cast<uint32_t>(extent_.width * scale), 1u),
+    std::max(static_cast<uint32_t>(extent_.height * scale), 1u),
+  };
 }
 
-void Swapchain::commit()
+int Swapchain::acquireNextImageIndex() const
 {
-  if (!OVR_SUCCESS(ovr_CommitTextureSwapChain(session_, colorSwapchain_)))
-    throw std::runtime_error("Failed to commit ovr color swapchain");
+  return session_.getBackend()->getTextureSwapChainCurrentIndex(colorSwapchain_);
+}
 
-  if (!OVR_SUCCESS(ovr_CommitTextureSwapChain(session_, depthSwapchain_)))
-    throw std::runtime_error("Failed to commit ovr depth swapchain");
+void Swapchain::commit()
+{
+  const auto& backend = session_.getBackend();
+  backend->commitTextureSwapChain(colorSwapchain_);
+  if (depthSwapchain_)
+    backend->commitTextureSwapChain(depthSwapchain_);
 }
 
 void Swapchain::destroy()
 {
-  ovr_DestroyTextureSwapChain(session_, colorSwapchain_);
-  ovr_DestroyTextureSwapChain(session_, depthSwapchain_);
+  // Never created, or destroyed already
+  if (!colorSwapchain_)
+    return;
+
+  const auto& backend = session_.getBackend();
+  backend->destroyTextureSwapChain(colorSwapchain_);
+  if (depthSwapchain_)
+    backend->destroyTextureSwapChain(depthSwapchain_);
 
   for (auto imageView : colorImageViews_)
     device_.destroyImageView(imageView);
@@ -2,17 +2,36 @@
 
 namespace vkovr
 {
-void initialize()
+namespace
 {
+bool runtimeInitialized = false;
+}
+
+void initialize(const InitializeInfo& initializeInfo)
+{
+  if (initializeInfo.headless)
+    return;
+
+#ifdef VKOVR_NO_RUNTIME
+  throw std::runtime_error("Failed to initialize libOVR, built with VKOVR_NO_RUNTIME");
+#else
   // Initializes LibOVR, and the Rift
   ovrInitParams initParams = { ovrInit_RequestVersion | ovrInit_FocusAware, OVR_MINOR_VERSION, NULL, 0, 0 };
   auto result = ovr_Initialize(&initParams);
   if (!OVR_SUCCESS(result))
     throw std::runtime_error("Failed to initialize libOVR");
+
+  runtimeInitialized = true;
+#endif
 }
 
 void terminate()
 {
-  ovr_Shutdown();
+#ifndef VKOVR_NO_RUNTIME
+  if (runtimeInitialized)
+    ovr_Shutdown();
+#endif
+
+  runtimeInitialized = false;
 }
 }